@@ -0,0 +1,40 @@
+#version 330
+
+// Input vertex attributes
+in vec3 vertexPosition;
+
+// Istanza compatta (vedi RockInstance in environment.hpp)
+in vec3 instancePosition;
+in float instanceRotation; // yaw 8 bit | tilt X 4 bit | tilt Z 4 bit
+in float instanceScale;
+
+const float ROCK_Y_SQUASH = 0.6;
+const float ROCK_MAX_TILT = 0.261799388; // 15 gradi
+
+// T * Rz * Ry * Rx * S, come rockInstanceMatrix() sulla CPU
+mat4 rockInstanceMatrix()
+{
+    float yaw = floor(instanceRotation / 256.0) * (6.283185307 / 256.0);
+    float tiltX = floor(mod(instanceRotation, 256.0) / 16.0) * (ROCK_MAX_TILT / 15.0);
+    float tiltZ = mod(instanceRotation, 16.0) * (ROCK_MAX_TILT / 15.0);
+
+    float cx = cos(tiltX), sx = sin(tiltX);
+    float cy = cos(yaw), sy = sin(yaw);
+    float cz = cos(tiltZ), sz = sin(tiltZ);
+    mat3 rx = mat3(1.0, 0.0, 0.0, 0.0, cx, sx, 0.0, -sx, cx);
+    mat3 ry = mat3(cy, 0.0, -sy, 0.0, 1.0, 0.0, sy, 0.0, cy);
+    mat3 rz = mat3(cz, sz, 0.0, -sz, cz, 0.0, 0.0, 0.0, 1.0);
+    mat3 m = rz * ry * rx * mat3(instanceScale, 0.0, 0.0,
+                                 0.0, instanceScale * ROCK_Y_SQUASH, 0.0,
+                                 0.0, 0.0, instanceScale);
+    return mat4(vec4(m[0], 0.0), vec4(m[1], 0.0), vec4(m[2], 0.0),
+                vec4(instancePosition, 1.0));
+}
+
+// Uniforms
+uniform mat4 mvp;
+
+void main()
+{
+    gl_Position = mvp * rockInstanceMatrix() * vec4(vertexPosition, 1.0);
+}
@@ -1,15 +1,22 @@
 #include "structure.h"
+#include "../camera/occlusion.h"
+#include "../map/map.h"
+#include "../resources/mesh_lod.h"
 #include "imgui.h"
+#include <cstring>
 #include <raymath.h>
 
 namespace moiras {
 
 Shader Structure::sharedShader = {0};
+unsigned int Structure::s_revision = 0;
 
 Structure::Structure()
     : GameObject("Structure"), eulerRot({0.0f, 0.0f, 0.0f}),
       rotation(QuaternionIdentity()), scale(1.0f), isPlaced(false),
-      bounds({0}) {}
+      bounds({0}) {
+  typeMask |= TypeMask;
+}
 
 Structure::~Structure() {
   // ModelInstance destructor handles cleanup automatically
@@ -35,25 +42,54 @@ Structure &Structure::operator=(Structure &&other) noexcept {
   return *this;
 }
 
-void Structure::update() { GameObject::update(); }
+void Structure::update() {
+  TransformKey key = getTransformKey();
+  if (isVisible != m_lastVisible ||
+      memcmp(&key, &m_lastKey, sizeof(key)) != 0) {
+    m_lastKey = key;
+    m_lastVisible = isVisible;
+    s_revision++;
+  }
+  GameObject::update();
+}
 
-void Structure::draw() {
-  if (!isVisible || !modelInstance.isValid())
-    return;
+GameObject::TransformKey Structure::getTransformKey() const {
+  return {position, {rotation.x, rotation.y, rotation.z, rotation.w},
+          {scale, scale, scale}};
+}
 
-  // Calcola la matrice di trasformazione usando il quaternione (include la normale del terreno)
+Matrix Structure::buildLocalMatrix() const {
   Matrix matScale = MatrixScale(scale, scale, scale);
   Matrix matRotation = QuaternionToMatrix(rotation);
   Matrix matTranslation = MatrixTranslate(position.x, position.y, position.z);
+  return MatrixMultiply(MatrixMultiply(matScale, matRotation), matTranslation);
+}
+
+void Structure::draw() {
+  if (!isVisible || !modelInstance.isValid())
+    return;
 
-  Matrix transform =
-      MatrixMultiply(MatrixMultiply(matScale, matRotation), matTranslation);
+  // Matrice in cache, ricalcolata solo quando cambia il transform
+  const Matrix &transform = getWorldMatrix();
+  if (!OcclusionCuller::getInstance().isVisible(modelInstance.getBoundingBox(), transform))
+    return;
+
+  // LOD dalla dimensione a schermo della sfera di bounding
+  currentLod = 0;
+  int lodCount = modelInstance.lodCount();
+  if (lodCount > 1) {
+    BoundingBox box = modelInstance.getBoundingBox();
+    Vector3 center = Vector3Transform(
+        Vector3Scale(Vector3Add(box.min, box.max), 0.5f), transform);
+    float size = LodView::fromCurrentMatrices().screenSize(center, getBoundingRadius());
+    currentLod = selectMeshLod(size, lodCount);
+  }
 
   // Draw each mesh with its material
   for (int i = 0; i < modelInstance.meshCount(); i++) {
     int materialIndex = modelInstance.meshMaterial()[i];
     Material material = modelInstance.materials()[materialIndex];
-    DrawMesh(modelInstance.meshes()[i], material, transform);
+    DrawMesh(modelInstance.lodMesh(i, currentLod), material, transform);
   }
 }
 // GameObject::draw();
@@ -65,6 +101,7 @@ void Structure::gui() {
     ImGui::DragFloat("Scale", &scale, 0.01f, 0.01f, 10.0f);
     ImGui::Checkbox("Visible", &isVisible);
     ImGui::Text("Model: %s", modelPath.c_str());
+    ImGui::Text("LOD: %d / %d", currentLod, modelInstance.lodCount() - 1);
     ImGui::TreePop();
   }
 
@@ -74,7 +111,7 @@ void Structure::gui() {
 void Structure::loadModel(ModelManager &manager, const std::string &path) {
   unloadModel();
   modelPath = path;
-  modelInstance = manager.acquire(path);
+  modelInstance = manager.acquire(path, true);
 
   if (modelInstance.isValid()) {
     // Applica shader condiviso se disponibile
@@ -92,26 +129,11 @@ void Structure::unloadModel() {
   modelInstance = ModelInstance(); // Release via move assignment
 }
 
-void Structure::snapToGround(const Model &ground) {
-  // Raycast verso il basso per trovare il terreno
-  Ray ray;
-  ray.position = {position.x, position.y + 1000.0f, position.z};
-  ray.direction = {0.0f, -1.0f, 0.0f};
-
-  RayCollision collision = {0};
-  collision.hit = false;
-  collision.distance = FLT_MAX;
-
-  for (int m = 0; m < ground.meshCount; m++) {
-    RayCollision meshHitInfo =
-        GetRayCollisionMesh(ray, ground.meshes[m], ground.transform);
-    if (meshHitInfo.hit && meshHitInfo.distance < collision.distance) {
-      collision = meshHitInfo;
-    }
-  }
-
-  if (collision.hit) {
-    position.y = collision.point.y;
+void Structure::snapToGround(const Map &ground) {
+  // Altezza del terreno dalla heightfield della mappa
+  float groundY;
+  if (ground.getGroundHeight(position.x, position.z, groundY)) {
+    position.y = groundY;
     updateBounds();
   }
 }
@@ -7,9 +7,13 @@
 
 namespace moiras {
 
+class Map;
+
 // Rappresenta una struttura piazzata nel mondo
 class Structure : public GameObject {
 public:
+    static constexpr unsigned int TypeMask = OBJECT_STRUCTURE;
+
     ModelInstance modelInstance;
     Vector3 eulerRot;
     Quaternion rotation;
@@ -23,6 +27,9 @@ public:
     // NavMesh obstacle ID (0 = not registered)
     unsigned int navMeshObstacleId = 0;
 
+    // LOD usato nell'ultimo draw (scelto dalla dimensione a schermo)
+    int currentLod = 0;
+
     Structure();
     ~Structure();
 
@@ -38,10 +45,16 @@ public:
     void draw() override;
     void gui() override;
 
+    // Rotazione dal quaternione (include la normale del terreno)
+    TransformKey getTransformKey() const override;
+    Matrix buildLocalMatrix() const override;
+
     void loadModel(ModelManager& manager, const std::string& path);
     void unloadModel();
-    void snapToGround(const Model& ground);
+    void snapToGround(const Map& ground);
     void updateBounds();
+    // Raggio world della sfera di bounding del modello (scelta del LOD)
+    float getBoundingRadius() const { return modelInstance.getBoundingRadius() * scale; }
 
     // Applica lo shader a tutti i materiali
     void applyShader(Shader shader);
@@ -52,6 +65,16 @@ public:
 
     // Check if model is loaded
     bool hasModel() const { return modelInstance.isValid(); }
+
+    // Cambia quando una struttura qualsiasi viene spostata, ruotata,
+    // scalata o nascosta (gui, script): invalida le ombre statiche in cache
+    static unsigned int getRevision() { return s_revision; }
+
+private:
+    static unsigned int s_revision;
+    // Trasformazione e visibilita' viste all'ultimo update
+    TransformKey m_lastKey = {};
+    bool m_lastVisible = false;
 };
 
 } // namespace moiras
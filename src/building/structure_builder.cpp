@@ -344,16 +344,7 @@ void StructureBuilder::updatePreviewPosition() {
     return;
 
   Ray ray = GetScreenToWorldRay(GetMousePosition(), *m_camera);
-  RayCollision closest = {0};
-  closest.distance = FLT_MAX;
-
-  for (int m = 0; m < m_map->model.meshCount; m++) {
-    RayCollision meshHitInfo = GetRayCollisionMesh(ray, m_map->model.meshes[m],
-                                                   m_map->model.transform);
-    if (meshHitInfo.hit && meshHitInfo.distance < closest.distance) {
-      closest = meshHitInfo;
-    }
-  }
+  RayCollision closest = m_map->raycaster.raycast(ray);
 
   if (closest.hit) {
     m_previewPosition = closest.point;
@@ -1,5 +1,6 @@
 #include "camera.h"
 #include "../input/input_manager.h"
+#include "../game/object_registry.h"
 #include "../map/map.h"
 #include <limits>
 #include <raylib.h>
@@ -85,18 +86,10 @@ void GameCamera::cameraControl() {
 
       RayCollision meshHit = {0};
       meshHit.hit = false;
-      meshHit.distance = std::numeric_limits<float>::max();
 
-      auto mapObj = getParent()->getChildOfType<Map>();
+      auto mapObj = ObjectRegistry::getInstance().getFirst<Map>();
       if (mapObj) {
-        const Model& model = mapObj->model;  // Reference to avoid VRAM copy
-        for (int m = 0; m < model.meshCount; m++) {
-          auto hitInfo =
-              GetRayCollisionMesh(centerRay, model.meshes[m], model.transform);
-          if (hitInfo.hit && hitInfo.distance < meshHit.distance) {
-            meshHit = hitInfo;
-          }
-        }
+        meshHit = mapObj->raycaster.raycast(centerRay);
       }
 
       if (meshHit.hit) {
@@ -159,21 +152,11 @@ void GameCamera::cameraControl() {
     {
       RayCollision meshHit = {0};
       meshHit.hit = false;
-      meshHit.distance = std::numeric_limits<float>::max();
 
-      auto mapObj = getParent()->getChildOfType<Map>();
+      auto mapObj = ObjectRegistry::getInstance().getFirst<Map>();
       if (mapObj)
       {
-        const Model& model = mapObj->model;  // Reference to avoid VRAM copy
-        for (int m = 0; m < model.meshCount; m++)
-        {
-          auto hitInfo =
-              GetRayCollisionMesh(centerRay, model.meshes[m], model.transform);
-          if (hitInfo.hit && hitInfo.distance < meshHit.distance)
-          {
-            meshHit = hitInfo;
-          }
-        }
+        meshHit = mapObj->raycaster.raycast(centerRay);
       }
 
       if (meshHit.hit)
@@ -240,16 +223,10 @@ void GameCamera::cameraControl() {
 
   RayCollision collision = {0};
   collision.hit = false;
-  collision.distance = std::numeric_limits<float>::max();
-
-  const auto& model = getParent()->getChildOfType<Map>()->model;  // Reference to avoid VRAM copy
-  for (int m = 0; m < model.meshCount; m++) {
-    auto hitInfo = GetRayCollisionMesh(ray, model.meshes[m], model.transform);
-    if (hitInfo.hit) {
-      if (hitInfo.distance < collision.distance) {
-        collision = hitInfo;
-      }
-    }
+
+  auto groundMap = ObjectRegistry::getInstance().getFirst<Map>();
+  if (groundMap) {
+    collision = groundMap->raycaster.raycast(ray);
   }
 
   if (collision.hit) {
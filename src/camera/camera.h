@@ -14,6 +14,8 @@ private:
   int updateMode = 1; // AGGIUNTO: inizializzato a 1 per UpdateCameraPro
 
 public:
+  static constexpr unsigned int TypeMask = OBJECT_CAMERA;
+
   int mode;
   bool isRotating;
 
@@ -28,6 +30,7 @@ public:
 
   GameCamera(Vector3 position, Vector3 target, Vector3 up, float fovy,
              int projection, int mode) {
+    typeMask |= TypeMask;
     rcamera = {0};
     this->mode = mode;
     this->position = position;
@@ -44,6 +47,7 @@ public:
   }
 
   GameCamera(const std::string &name) : GameObject(name) {
+    typeMask |= TypeMask;
     rcamera = {0};
     mode = CAMERA_FREE;
     rcamera.position = (Vector3){0.0f, 2.0f, 4.0f};
@@ -55,6 +59,7 @@ public:
   }
 
   GameCamera() {
+    typeMask |= TypeMask;
     rcamera = {0};
     mode = CAMERA_FREE;
     rcamera.position = (Vector3){0.0f, 2.0f, 4.0f};
@@ -0,0 +1,52 @@
+#include "frustum.h"
+#include <cmath>
+#include <raymath.h>
+#include <rlgl.h>
+
+namespace moiras {
+
+static Vector4 normalizePlane(float a, float b, float c, float d) {
+  float len = sqrtf(a * a + b * b + c * c);
+  if (len <= 0.0f)
+    return {a, b, c, d};
+  float inv = 1.0f / len;
+  return {a * inv, b * inv, c * inv, d * inv};
+}
+
+Frustum Frustum::fromMatrix(const Matrix &m) {
+  // Righe della matrice clip = m * v (raylib e' column-major)
+  Frustum f;
+  f.planes[0] = normalizePlane(m.m3 + m.m0, m.m7 + m.m4, m.m11 + m.m8, m.m15 + m.m12);  // left
+  f.planes[1] = normalizePlane(m.m3 - m.m0, m.m7 - m.m4, m.m11 - m.m8, m.m15 - m.m12);  // right
+  f.planes[2] = normalizePlane(m.m3 + m.m1, m.m7 + m.m5, m.m11 + m.m9, m.m15 + m.m13);  // bottom
+  f.planes[3] = normalizePlane(m.m3 - m.m1, m.m7 - m.m5, m.m11 - m.m9, m.m15 - m.m13);  // top
+  f.planes[4] = normalizePlane(m.m3 + m.m2, m.m7 + m.m6, m.m11 + m.m10, m.m15 + m.m14); // near
+  f.planes[5] = normalizePlane(m.m3 - m.m2, m.m7 - m.m6, m.m11 - m.m10, m.m15 - m.m14); // far
+  return f;
+}
+
+Frustum Frustum::fromCurrentMatrices() {
+  return fromMatrix(MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection()));
+}
+
+bool Frustum::intersectsBox(const BoundingBox &box) const {
+  for (const Vector4 &p : planes) {
+    // Vertice del box piu' avanti lungo la normale
+    float x = p.x >= 0.0f ? box.max.x : box.min.x;
+    float y = p.y >= 0.0f ? box.max.y : box.min.y;
+    float z = p.z >= 0.0f ? box.max.z : box.min.z;
+    if (p.x * x + p.y * y + p.z * z + p.w < 0.0f)
+      return false;
+  }
+  return true;
+}
+
+bool Frustum::intersectsSphere(Vector3 center, float radius) const {
+  for (const Vector4 &p : planes) {
+    if (p.x * center.x + p.y * center.y + p.z * center.z + p.w < -radius)
+      return false;
+  }
+  return true;
+}
+
+} // namespace moiras
@@ -0,0 +1,19 @@
+#pragma once
+#include <raylib.h>
+
+namespace moiras {
+
+// Sei piani del frustum (normali verso l'interno, ax + by + cz + d >= 0 per
+// i punti dentro) estratti da una matrice view * projection.
+struct Frustum {
+  Vector4 planes[6];
+
+  static Frustum fromMatrix(const Matrix &viewProjection);
+  // Frustum della camera attiva in rlgl (dentro BeginMode3D)
+  static Frustum fromCurrentMatrices();
+
+  bool intersectsBox(const BoundingBox &box) const;
+  bool intersectsSphere(Vector3 center, float radius) const;
+};
+
+} // namespace moiras
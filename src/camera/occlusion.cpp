@@ -0,0 +1,440 @@
+#include "occlusion.h"
+#include "../jobs/job_system.h"
+#include "../map/terrain_heightfield.h"
+#include "../profiler/profiler.h"
+#include "frustum.h"
+#include "imgui.h"
+#include <algorithm>
+#include <cmath>
+#include <raymath.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace moiras {
+
+// Righe per job di rasterizzazione
+static const int BAND_HEIGHT = 16;
+static const int BAND_COUNT = (OcclusionCuller::HEIGHT + BAND_HEIGHT - 1) / BAND_HEIGHT;
+// Lato massimo della griglia del terreno, in celle
+static const int MAX_TERRAIN_CELLS = 128;
+// Celle per lato di un chunk del terreno (frustum culling degli occluder)
+static const int TERRAIN_CHUNK_CELLS = 16;
+// Guard band: i triangoli vengono tagliati a |x|, |y| <= GUARD_BAND * w
+// per tenere le edge function in un range in cui i float sono esatti
+static const float GUARD_BAND = 2.0f;
+// Margine relativo su 1/w nel test dei box
+static const float DEPTH_EPSILON = 1e-3f;
+
+static Vector4 transformPoint(const Matrix &m, Vector3 p) {
+  return {m.m0 * p.x + m.m4 * p.y + m.m8 * p.z + m.m12,
+          m.m1 * p.x + m.m5 * p.y + m.m9 * p.z + m.m13,
+          m.m2 * p.x + m.m6 * p.y + m.m10 * p.z + m.m14,
+          m.m3 * p.x + m.m7 * p.y + m.m11 * p.z + m.m15};
+}
+
+// Piani di taglio in clip space (dot >= 0 dentro): near e guard band
+static const Vector4 CLIP_PLANES[5] = {
+    {0.0f, 0.0f, 1.0f, 1.0f},          // z + w >= 0
+    {-1.0f, 0.0f, 0.0f, GUARD_BAND},   // x <= G * w
+    {1.0f, 0.0f, 0.0f, GUARD_BAND},    // x >= -G * w
+    {0.0f, -1.0f, 0.0f, GUARD_BAND},   // y <= G * w
+    {0.0f, 1.0f, 0.0f, GUARD_BAND},    // y >= -G * w
+};
+
+static float planeDistance(const Vector4 &plane, const Vector4 &v) {
+  return plane.x * v.x + plane.y * v.y + plane.z * v.z + plane.w * v.w;
+}
+
+void OcclusionCuller::buildTerrainOccluder(const TerrainHeightfield &heightfield,
+                                           float cellSize, float heightBias) {
+  m_terrain.clear();
+  if (!heightfield.isBuilt())
+    return;
+  PROFILE_SCOPE("OcclusionCuller::buildTerrainOccluder");
+
+  const float fine = heightfield.getCellSize();
+  const float originX = heightfield.getOriginX();
+  const float originZ = heightfield.getOriginZ();
+  const float extentX = (heightfield.getWidth() - 1) * fine;
+  const float extentZ = (heightfield.getDepth() - 1) * fine;
+  cellSize = std::max({cellSize, fine, extentX / MAX_TERRAIN_CELLS,
+                       extentZ / MAX_TERRAIN_CELLS});
+  const int cellsX = std::max(1, (int)ceilf(extentX / cellSize));
+  const int cellsZ = std::max(1, (int)ceilf(extentZ / cellSize));
+
+  // Minimo dell'heightfield in ogni cella, campionato sui punti della
+  // griglia fine (compresi i bordi: il bilineare sta tra i campioni).
+  // INFINITY = la cella contiene punti senza terreno.
+  std::vector<float> cellMin(cellsX * cellsZ, INFINITY);
+  const int steps = std::max(1, (int)ceilf(cellSize / fine));
+  JobSystem::getInstance().parallel_for(cellsZ, 1, [&](int begin, int end) {
+    for (int cz = begin; cz < end; cz++) {
+      for (int cx = 0; cx < cellsX; cx++) {
+        float minY = INFINITY;
+        bool covered = true;
+        for (int iz = 0; covered && iz <= steps; iz++) {
+          float z = originZ + std::min(cz * cellSize + iz * fine, extentZ);
+          for (int ix = 0; ix <= steps; ix++) {
+            float x = originX + std::min(cx * cellSize + ix * fine, extentX);
+            float y;
+            if (!heightfield.getHeight(x, z, y)) {
+              covered = false;
+              break;
+            }
+            minY = std::min(minY, y);
+          }
+        }
+        if (covered)
+          cellMin[cz * cellsX + cx] = minY;
+      }
+    }
+  });
+
+  // Un vertice prende il minimo delle (fino a 4) celle che lo toccano: ogni
+  // triangolo resta sotto il terreno vero della propria cella
+  const int vertsX = cellsX + 1;
+  std::vector<float> vertexY(vertsX * (cellsZ + 1), 0.0f);
+  for (int vz = 0; vz <= cellsZ; vz++) {
+    for (int vx = 0; vx < vertsX; vx++) {
+      float minY = INFINITY;
+      for (int cz = std::max(0, vz - 1); cz <= std::min(cellsZ - 1, vz); cz++) {
+        for (int cx = std::max(0, vx - 1); cx <= std::min(cellsX - 1, vx); cx++)
+          minY = std::min(minY, cellMin[cz * cellsX + cx]);
+      }
+      if (minY != INFINITY)
+        vertexY[vz * vertsX + vx] = minY - heightBias;
+    }
+  }
+
+  int triangleCount = 0;
+  for (int chunkZ = 0; chunkZ < cellsZ; chunkZ += TERRAIN_CHUNK_CELLS) {
+    for (int chunkX = 0; chunkX < cellsX; chunkX += TERRAIN_CHUNK_CELLS) {
+      const int nx = std::min(TERRAIN_CHUNK_CELLS, cellsX - chunkX);
+      const int nz = std::min(TERRAIN_CHUNK_CELLS, cellsZ - chunkZ);
+      TerrainChunk chunk;
+      chunk.vertices.reserve((nx + 1) * (nz + 1));
+      for (int z = 0; z <= nz; z++) {
+        for (int x = 0; x <= nx; x++) {
+          int vx = chunkX + x;
+          int vz = chunkZ + z;
+          chunk.vertices.push_back({originX + std::min(vx * cellSize, extentX),
+                                    vertexY[vz * vertsX + vx],
+                                    originZ + std::min(vz * cellSize, extentZ)});
+        }
+      }
+
+      chunk.bounds = {{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}};
+      for (int z = 0; z < nz; z++) {
+        for (int x = 0; x < nx; x++) {
+          if (cellMin[(chunkZ + z) * cellsX + chunkX + x] == INFINITY)
+            continue;
+          uint16_t i00 = (uint16_t)(z * (nx + 1) + x);
+          uint16_t i10 = (uint16_t)(i00 + 1);
+          uint16_t i01 = (uint16_t)(i00 + nx + 1);
+          uint16_t i11 = (uint16_t)(i01 + 1);
+          chunk.indices.insert(chunk.indices.end(), {i00, i01, i10, i10, i01, i11});
+          for (uint16_t i : {i00, i10, i01, i11}) {
+            chunk.bounds.min = Vector3Min(chunk.bounds.min, chunk.vertices[i]);
+            chunk.bounds.max = Vector3Max(chunk.bounds.max, chunk.vertices[i]);
+          }
+        }
+      }
+      if (chunk.indices.empty())
+        continue;
+      triangleCount += (int)chunk.indices.size() / 3;
+      m_terrain.push_back(std::move(chunk));
+    }
+  }
+
+  TraceLog(LOG_INFO, "OCCLUSION: Terrain occluder %dx%d cells (%.1f m), %d chunks, %d triangles",
+           cellsX, cellsZ, cellSize, (int)m_terrain.size(), triangleCount);
+}
+
+void OcclusionCuller::beginFrame(const Matrix &viewProjection) {
+  m_ready = false;
+  m_tested = 0;
+  m_culled = 0;
+  m_tris.clear();
+  if (!enabled)
+    return;
+
+  m_viewProjection = viewProjection;
+  m_depth.assign(WIDTH * HEIGHT, 0.0f);
+
+  Frustum frustum = Frustum::fromMatrix(viewProjection);
+  for (const TerrainChunk &chunk : m_terrain) {
+    if (!frustum.intersectsBox(chunk.bounds))
+      continue;
+    addTriangles(chunk.vertices.data(), (int)chunk.vertices.size(), chunk.indices.data(),
+                 (int)chunk.indices.size() / 3, viewProjection);
+  }
+}
+
+void OcclusionCuller::addOccluder(const Mesh &mesh, const Matrix &transform) {
+  if (!enabled || !mesh.vertices || mesh.triangleCount <= 0)
+    return;
+  addTriangles((const Vector3 *)mesh.vertices, mesh.vertexCount, mesh.indices,
+               mesh.triangleCount, MatrixMultiply(transform, m_viewProjection));
+}
+
+void OcclusionCuller::addTriangles(const Vector3 *vertices, int vertexCount,
+                                   const uint16_t *indices, int triangleCount,
+                                   const Matrix &mvp) {
+  m_clipVertices.resize(vertexCount);
+  for (int i = 0; i < vertexCount; i++)
+    m_clipVertices[i] = transformPoint(mvp, vertices[i]);
+
+  for (int t = 0; t < triangleCount; t++) {
+    Vector4 v[3];
+    bool valid = true;
+    for (int k = 0; k < 3; k++) {
+      int index = indices ? indices[t * 3 + k] : t * 3 + k;
+      if (index >= vertexCount) {
+        valid = false;
+        break;
+      }
+      v[k] = m_clipVertices[index];
+    }
+    if (!valid)
+      continue;
+
+    // Tutto fuori dallo stesso lato dello schermo o oltre il far plane
+    if ((v[0].x > v[0].w && v[1].x > v[1].w && v[2].x > v[2].w) ||
+        (v[0].x < -v[0].w && v[1].x < -v[1].w && v[2].x < -v[2].w) ||
+        (v[0].y > v[0].w && v[1].y > v[1].w && v[2].y > v[2].w) ||
+        (v[0].y < -v[0].w && v[1].y < -v[1].w && v[2].y < -v[2].w) ||
+        (v[0].z > v[0].w && v[1].z > v[1].w && v[2].z > v[2].w))
+      continue;
+
+    unsigned int outside = 0;
+    for (int p = 0; p < 5; p++) {
+      for (int k = 0; k < 3; k++) {
+        if (planeDistance(CLIP_PLANES[p], v[k]) < 0.0f)
+          outside |= 1u << p;
+      }
+    }
+    if (outside == 0) {
+      setupTriangle(v[0], v[1], v[2]);
+      continue;
+    }
+
+    // Sutherland-Hodgman solo sui piani attraversati
+    Vector4 polygon[8] = {v[0], v[1], v[2]};
+    Vector4 clipped[8];
+    int count = 3;
+    for (int p = 0; p < 5 && count >= 3; p++) {
+      if (!(outside & (1u << p)))
+        continue;
+      int out = 0;
+      for (int k = 0; k < count; k++) {
+        const Vector4 &a = polygon[k];
+        const Vector4 &b = polygon[(k + 1) % count];
+        float da = planeDistance(CLIP_PLANES[p], a);
+        float db = planeDistance(CLIP_PLANES[p], b);
+        if (da >= 0.0f)
+          clipped[out++] = a;
+        if ((da >= 0.0f) != (db >= 0.0f)) {
+          float s = da / (da - db);
+          clipped[out++] = {a.x + (b.x - a.x) * s, a.y + (b.y - a.y) * s,
+                            a.z + (b.z - a.z) * s, a.w + (b.w - a.w) * s};
+        }
+      }
+      count = out;
+      std::copy(clipped, clipped + count, polygon);
+    }
+    for (int k = 1; k + 1 < count; k++)
+      setupTriangle(polygon[0], polygon[k], polygon[k + 1]);
+  }
+}
+
+void OcclusionCuller::setupTriangle(const Vector4 &a, const Vector4 &b, const Vector4 &c) {
+  const Vector4 *clip[3] = {&a, &b, &c};
+  float x[3], y[3], invW[3];
+  for (int k = 0; k < 3; k++) {
+    if (clip[k]->w <= 0.0f)
+      return;
+    invW[k] = 1.0f / clip[k]->w;
+    x[k] = (clip[k]->x * invW[k] * 0.5f + 0.5f) * WIDTH;
+    y[k] = (0.5f - clip[k]->y * invW[k] * 0.5f) * HEIGHT;
+  }
+
+  RasterTri tri;
+  tri.minX = std::max(0, (int)floorf(std::min({x[0], x[1], x[2]})));
+  tri.maxX = std::min(WIDTH - 1, (int)ceilf(std::max({x[0], x[1], x[2]})));
+  tri.minY = std::max(0, (int)floorf(std::min({y[0], y[1], y[2]})));
+  tri.maxY = std::min(HEIGHT - 1, (int)ceilf(std::max({y[0], y[1], y[2]})));
+  if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+    return;
+
+  // Edge i: lato opposto al vertice i, E(p) = A * px + B * py + C
+  float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+  if (fabsf(area) < 1e-6f)
+    return;
+  // Entrambe le facce: l'orientamento si normalizza col segno dell'area
+  const float sign = area > 0.0f ? 1.0f : -1.0f;
+  const float invArea = 1.0f / fabsf(area);
+  for (int i = 0; i < 3; i++) {
+    int s = (i + 1) % 3;
+    int e = (i + 2) % 3;
+    float A = -(y[e] - y[s]) * sign;
+    float B = (x[e] - x[s]) * sign;
+    float C = -A * x[s] - B * y[s];
+    // Valutata sui centri dei pixel
+    tri.edgeA[i] = A;
+    tri.edgeB[i] = B;
+    tri.edgeC[i] = C + 0.5f * A + 0.5f * B;
+  }
+  // 1/w = somma delle baricentriche (E_i / area) per 1/w_i
+  tri.depthA = (tri.edgeA[0] * invW[0] + tri.edgeA[1] * invW[1] + tri.edgeA[2] * invW[2]) * invArea;
+  tri.depthB = (tri.edgeB[0] * invW[0] + tri.edgeB[1] * invW[1] + tri.edgeB[2] * invW[2]) * invArea;
+  tri.depthC = (tri.edgeC[0] * invW[0] + tri.edgeC[1] * invW[1] + tri.edgeC[2] * invW[2]) * invArea;
+  m_tris.push_back(tri);
+}
+
+void OcclusionCuller::rasterize() {
+  if (!enabled)
+    return;
+  PROFILE_SCOPE("OcclusionCuller::rasterize");
+
+  // Setup seriale, poi bande di righe indipendenti in parallelo
+  m_bins.resize(BAND_COUNT);
+  for (auto &bin : m_bins)
+    bin.clear();
+  for (int t = 0; t < (int)m_tris.size(); t++) {
+    for (int band = m_tris[t].minY / BAND_HEIGHT; band <= m_tris[t].maxY / BAND_HEIGHT; band++)
+      m_bins[band].push_back(t);
+  }
+  JobSystem::getInstance().parallel_for(BAND_COUNT, 1, [this](int begin, int end) {
+    for (int band = begin; band < end; band++)
+      rasterizeBand(band);
+  });
+  m_ready = true;
+}
+
+void OcclusionCuller::rasterizeBand(int band) {
+  const int bandStart = band * BAND_HEIGHT;
+  const int bandEnd = std::min(HEIGHT, bandStart + BAND_HEIGHT) - 1;
+  for (int t : m_bins[band]) {
+    const RasterTri &tri = m_tris[t];
+    const int y0 = std::max(tri.minY, bandStart);
+    const int y1 = std::min(tri.maxY, bandEnd);
+    // Gruppi di 8 pixel allineati (WIDTH e' multiplo di 8): i pixel fuori
+    // dal bounding box falliscono comunque le edge function
+    const int x0 = tri.minX & ~7;
+
+#if defined(__AVX2__)
+    const __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 a0 = _mm256_set1_ps(tri.edgeA[0]);
+    const __m256 a1 = _mm256_set1_ps(tri.edgeA[1]);
+    const __m256 a2 = _mm256_set1_ps(tri.edgeA[2]);
+    const __m256 da = _mm256_set1_ps(tri.depthA);
+    for (int y = y0; y <= y1; y++) {
+      float *row = &m_depth[y * WIDTH];
+      const __m256 r0 = _mm256_set1_ps(tri.edgeB[0] * y + tri.edgeC[0]);
+      const __m256 r1 = _mm256_set1_ps(tri.edgeB[1] * y + tri.edgeC[1]);
+      const __m256 r2 = _mm256_set1_ps(tri.edgeB[2] * y + tri.edgeC[2]);
+      const __m256 rd = _mm256_set1_ps(tri.depthB * y + tri.depthC);
+      for (int x = x0; x <= tri.maxX; x += 8) {
+        __m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), lane);
+        __m256 e0 = _mm256_add_ps(_mm256_mul_ps(a0, px), r0);
+        __m256 e1 = _mm256_add_ps(_mm256_mul_ps(a1, px), r1);
+        __m256 e2 = _mm256_add_ps(_mm256_mul_ps(a2, px), r2);
+        __m256 inside = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)),
+            _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+        if (_mm256_movemask_ps(inside) == 0)
+          continue;
+        __m256 depth = _mm256_add_ps(_mm256_mul_ps(da, px), rd);
+        __m256 old = _mm256_loadu_ps(row + x);
+        _mm256_storeu_ps(row + x, _mm256_blendv_ps(old, _mm256_max_ps(old, depth), inside));
+      }
+    }
+#else
+    for (int y = y0; y <= y1; y++) {
+      float *row = &m_depth[y * WIDTH];
+      const float r0 = tri.edgeB[0] * y + tri.edgeC[0];
+      const float r1 = tri.edgeB[1] * y + tri.edgeC[1];
+      const float r2 = tri.edgeB[2] * y + tri.edgeC[2];
+      const float rd = tri.depthB * y + tri.depthC;
+      for (int x = x0; x <= tri.maxX; x++) {
+        const float px = (float)x;
+        if (tri.edgeA[0] * px + r0 >= 0.0f && tri.edgeA[1] * px + r1 >= 0.0f &&
+            tri.edgeA[2] * px + r2 >= 0.0f)
+          row[x] = std::max(row[x], tri.depthA * px + rd);
+      }
+    }
+#endif
+  }
+}
+
+bool OcclusionCuller::isVisible(const BoundingBox &box) {
+  return isVisible(box, MatrixIdentity());
+}
+
+bool OcclusionCuller::isVisible(const BoundingBox &box, const Matrix &transform) {
+  if (!enabled || !m_ready)
+    return true;
+  const Matrix mvp = MatrixMultiply(transform, m_viewProjection);
+  Vector4 clip[8];
+  for (int i = 0; i < 8; i++) {
+    Vector3 corner = {(i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y,
+                      (i & 4) ? box.max.z : box.min.z};
+    clip[i] = transformPoint(mvp, corner);
+  }
+  m_tested++;
+  if (testScreenBox(clip))
+    return true;
+  m_culled++;
+  return false;
+}
+
+bool OcclusionCuller::testScreenBox(const Vector4 *clip) {
+  float minX = INFINITY, maxX = -INFINITY;
+  float minY = INFINITY, maxY = -INFINITY;
+  float nearestInvW = 0.0f;
+  for (int i = 0; i < 8; i++) {
+    // Un angolo davanti al near plane: il box contiene la camera o quasi
+    if (clip[i].z + clip[i].w <= 0.0f || clip[i].w <= 0.0f)
+      return true;
+    float invW = 1.0f / clip[i].w;
+    float x = (clip[i].x * invW * 0.5f + 0.5f) * WIDTH;
+    float y = (0.5f - clip[i].y * invW * 0.5f) * HEIGHT;
+    minX = std::min(minX, x);
+    maxX = std::max(maxX, x);
+    minY = std::min(minY, y);
+    maxY = std::max(maxY, y);
+    // w e' lineare: il punto piu' vicino del box e' un angolo
+    nearestInvW = std::max(nearestInvW, invW);
+  }
+
+  const int x0 = std::max(0, (int)floorf(minX));
+  const int x1 = std::min(WIDTH - 1, (int)floorf(maxX));
+  const int y0 = std::max(0, (int)floorf(minY));
+  const int y1 = std::min(HEIGHT - 1, (int)floorf(maxY));
+  // Fuori schermo: compito del frustum culling
+  if (x0 > x1 || y0 > y1)
+    return true;
+
+  const float threshold = nearestInvW * (1.0f + DEPTH_EPSILON);
+  for (int y = y0; y <= y1; y++) {
+    const float *row = &m_depth[y * WIDTH];
+    for (int x = x0; x <= x1; x++) {
+      if (row[x] <= threshold)
+        return true;
+    }
+  }
+  return false;
+}
+
+void OcclusionCuller::gui() {
+  ImGui::Checkbox("Occlusion culling", &enabled);
+  ImGui::SliderFloat("Min occluder radius", &minOccluderRadius, 0.0f, 50.0f, "%.1f");
+  ImGui::Text("Terrain chunks: %d", (int)m_terrain.size());
+  ImGui::Text("Occluder triangles: %d", getOccluderTriangles());
+  ImGui::Text("Tested: %d, culled: %d", m_tested, m_culled);
+}
+
+} // namespace moiras
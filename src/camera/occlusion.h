@@ -0,0 +1,96 @@
+#pragma once
+#include <raylib.h>
+#include <cstdint>
+#include <vector>
+
+namespace moiras {
+
+class TerrainHeightfield;
+
+// Occlusion culling software sulla CPU: a ogni frame il terreno (griglia
+// grossolana conservativa) e le strutture grandi (a LOD0) vengono
+// rasterizzati in un piccolo depth buffer, poi i bounding box degli oggetti
+// vengono testati contro di esso prima del draw. Il buffer contiene 1/w
+// (lineare nello schermo, 0 = vuoto): un box e' nascosto se ogni pixel del
+// suo rettangolo a schermo ha un occluder piu' vicino del suo punto piu'
+// vicino. Stesso risultato su ogni piattaforma: AVX2 dove disponibile,
+// altrimenti lo stesso algoritmo scalare.
+class OcclusionCuller {
+public:
+  static constexpr int WIDTH = 320;
+  static constexpr int HEIGHT = 180;
+
+  static OcclusionCuller &getInstance() {
+    static OcclusionCuller instance;
+    return instance;
+  }
+
+  // Griglia del terreno con passo cellSize (allargato se la mappa supera
+  // MAX_TERRAIN_CELLS per lato). L'altezza di ogni vertice e' il minimo
+  // dell'heightfield nelle celle adiacenti meno heightBias: la superficie
+  // approssimata resta sempre sotto quella vera e non nasconde cio' che
+  // le sta sopra.
+  void buildTerrainOccluder(const TerrainHeightfield &heightfield, float cellSize = 4.0f,
+                            float heightBias = 0.5f);
+
+  // Nuovo frame con la camera attiva (view * projection). Il terreno viene
+  // accodato qui, gli altri occluder con addOccluder, poi rasterize().
+  void beginFrame(const Matrix &viewProjection);
+  void addOccluder(const Mesh &mesh, const Matrix &transform);
+  void rasterize();
+  // Fine del main pass: i draw successivi (altre camere) non vengono testati
+  void endFrame() { m_ready = false; }
+
+  // false solo se il box (local space + transform) e' certamente nascosto
+  bool isVisible(const BoundingBox &box);
+  bool isVisible(const BoundingBox &box, const Matrix &transform);
+
+  bool enabled = true;
+  // Raggio minimo di una struttura per essere usata come occluder
+  float minOccluderRadius = 4.0f;
+
+  int getTestedCount() const { return m_tested; }
+  int getCulledCount() const { return m_culled; }
+  int getOccluderTriangles() const { return (int)m_tris.size(); }
+
+  void gui();
+
+private:
+  OcclusionCuller() = default;
+  OcclusionCuller(const OcclusionCuller &) = delete;
+  OcclusionCuller &operator=(const OcclusionCuller &) = delete;
+
+  struct TerrainChunk {
+    std::vector<Vector3> vertices;
+    std::vector<uint16_t> indices;
+    BoundingBox bounds;
+  };
+
+  // Triangolo pronto per la rasterizzazione: tre edge function e il piano
+  // di 1/w, nella forma a*x + b*y + c sui centri dei pixel
+  struct RasterTri {
+    float edgeA[3], edgeB[3], edgeC[3];
+    float depthA, depthB, depthC;
+    int minX, maxX, minY, maxY;
+  };
+
+  // indices a 16 bit come le Mesh di raylib, nullptr = non indicizzata
+  void addTriangles(const Vector3 *vertices, int vertexCount, const uint16_t *indices,
+                    int triangleCount, const Matrix &mvp);
+  void setupTriangle(const Vector4 &a, const Vector4 &b, const Vector4 &c);
+  void rasterizeBand(int band);
+  bool testScreenBox(const Vector4 *clip);
+
+  std::vector<TerrainChunk> m_terrain;
+  std::vector<float> m_depth; // WIDTH * HEIGHT, 1/w
+  std::vector<RasterTri> m_tris;
+  std::vector<std::vector<int>> m_bins; // triangoli per banda di righe
+  std::vector<Vector4> m_clipVertices;  // scratch di addTriangles
+  Matrix m_viewProjection = {};
+  bool m_ready = false; // depth buffer valido per il frame corrente
+
+  int m_tested = 0;
+  int m_culled = 0;
+};
+
+} // namespace moiras
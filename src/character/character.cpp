@@ -1,6 +1,7 @@
 #include "character.h"
 #include <limits>
 #include <raylib.h>
+#include "../camera/occlusion.h"
 #include "../gui/inventory.hpp"
 #include "../time/time_manager.h"
 #include <raymath.h>
@@ -31,6 +32,7 @@ namespace moiras
         : health(100), scale(1.0f), name("Character"), isVisible(true),
           quat_rotation{1.0, 0.0, 0.0, 0.0}, eulerRot{0, 0, 0}
     {
+        typeMask |= TypeMask;
         quat_rotation = QuaternionFromEuler(eulerRot.x, eulerRot.y, eulerRot.z);
         auto inventory = std::make_unique<Inventory>(10, 6);
         inventory.get()->setName("Inventory");
@@ -186,21 +188,16 @@ namespace moiras
 
         if (modelInstance.isValid())
         {
-            Quaternion q = QuaternionFromEuler(
-                eulerRot.x * DEG2RAD,
-                eulerRot.y * DEG2RAD,
-                eulerRot.z * DEG2RAD);
+            // Matrice in cache, ricalcolata solo quando cambia il transform
+            const Matrix &transform = getWorldMatrix();
 
-            Vector3 axis;
-            float angle;
-            QuaternionToAxisAngle(q, &axis, &angle);
-
-            // Calcola la matrice di trasformazione
-            Matrix matScale = MatrixScale(scale, scale, scale);
-            Matrix matRotation = MatrixRotate(axis, angle); // angle is already in radians from QuaternionToAxisAngle
-            Matrix matTranslation = MatrixTranslate(position.x, position.y, position.z);
-
-            Matrix transform = MatrixMultiply(MatrixMultiply(matScale, matRotation), matTranslation);
+            // Box della bind pose allargato: l'animazione puo' uscirne
+            BoundingBox box = modelInstance.getBoundingBox();
+            Vector3 margin = Vector3Scale(Vector3Subtract(box.max, box.min), 0.25f);
+            box.min = Vector3Subtract(box.min, margin);
+            box.max = Vector3Add(box.max, margin);
+            if (!OcclusionCuller::getInstance().isVisible(box, transform))
+                return;
 
             // Disegna ogni mesh con il suo materiale
             // Note: bindAnimationData/unbindAnimationData are no-ops with per-instance meshes
@@ -221,28 +218,35 @@ namespace moiras
         }
     }
 
-    void Character::snapToGround(const Model &ground)
+    GameObject::TransformKey Character::getTransformKey() const
     {
-        Ray downRay;
-        downRay.position = {position.x, position.y + 100.0f, position.z};
-        downRay.direction = {0.0f, -1.0f, 0.0f};
+        return {position, {eulerRot.x, eulerRot.y, eulerRot.z, 0.0f}, {scale, scale, scale}};
+    }
 
-        RayCollision closest = {0};
-        closest.hit = false;
-        closest.distance = std::numeric_limits<float>::max();
+    Matrix Character::buildLocalMatrix() const
+    {
+        Quaternion q = QuaternionFromEuler(
+            eulerRot.x * DEG2RAD,
+            eulerRot.y * DEG2RAD,
+            eulerRot.z * DEG2RAD);
 
-        for (int m = 0; m < ground.meshCount; m++)
-        {
-            RayCollision hit = GetRayCollisionMesh(downRay, ground.meshes[m], ground.transform);
-            if (hit.hit && hit.distance < closest.distance)
-            {
-                closest = hit;
-            }
-        }
+        Vector3 axis;
+        float angle;
+        QuaternionToAxisAngle(q, &axis, &angle);
+
+        Matrix matScale = MatrixScale(scale, scale, scale);
+        Matrix matRotation = MatrixRotate(axis, angle); // angle is already in radians from QuaternionToAxisAngle
+        Matrix matTranslation = MatrixTranslate(position.x, position.y, position.z);
 
-        if (closest.hit)
+        return MatrixMultiply(MatrixMultiply(matScale, matRotation), matTranslation);
+    }
+
+    void Character::snapToGround(const Map &ground)
+    {
+        float groundY;
+        if (ground.getGroundHeight(position.x, position.z, groundY))
         {
-            position.y = closest.point.y;
+            position.y = groundY;
         }
     }
 
@@ -12,6 +12,8 @@ class Inventory; // Forward declaration
 
 class Character : public GameObject {
 public:
+  static constexpr unsigned int TypeMask = OBJECT_CHARACTER;
+
   int health;
   std::string name;
   Vector3 eulerRot;
@@ -44,9 +46,13 @@ public:
   void draw() override;
   void gui() override;
 
+  // Rotazione da eulerRot (gradi), scala uniforme
+  TransformKey getTransformKey() const override;
+  Matrix buildLocalMatrix() const override;
+
   void loadModel(ModelManager& manager, const std::string &path);
   void unloadModel();
-  void snapToGround(const Model &ground);
+  void snapToGround(const Map &ground);
   void handleDroppedModel();
   void handleFileDialog();
 
@@ -1,28 +1,32 @@
 #include "controller.h"
 #include "../input/input_manager.h"
+#include "../game/object_registry.h"
 #include "../map/map.h"
+#include "../navigation/crowd.h"
 #include "../time/time_manager.h"
 #include <raymath.h>
 #include <limits>
 
 namespace moiras {
 
-CharacterController::CharacterController(Character* character, NavMesh* navMesh, const Model* groundModel)
+CharacterController::CharacterController(Character* character, NavMesh* navMesh, const Map* ground)
     : m_character(character)
     , m_navMesh(navMesh)
-    , m_groundModel(groundModel)
+    , m_ground(ground)
     , m_currentPathIndex(0)
     , m_isMoving(false)
     , m_movementSpeed(5.0f)
     , m_targetPoint{0, 0, 0}
     , m_hasTarget(false)
     , m_waypointThreshold(0.5f)
+    , m_crowdAgent(-1)
+    , m_pathRequest(0)
 {
     TraceLog(LOG_INFO, "CharacterController: Created for character '%s'", character->name.c_str());
 
     // Snap del character sulla mesh geometrica se disponibile
-    if (m_character && m_groundModel) {
-        m_character->snapToGround(*m_groundModel);
+    if (m_character && m_ground) {
+        m_character->snapToGround(*m_ground);
         TraceLog(LOG_INFO, "CharacterController: Character snapped to ground at (%.2f,%.2f,%.2f)",
                  m_character->position.x, m_character->position.y, m_character->position.z);
     }
@@ -35,12 +39,29 @@ CharacterController::CharacterController(Character* character, NavMesh* navMesh,
                      projectedPos.x, projectedPos.y, projectedPos.z);
         }
     }
+
+    // Con la crowd attiva path, avoidance e snap li gestisce lei
+    Crowd& crowd = Crowd::getInstance();
+    if (m_character && m_navMesh && crowd.isInitialized()) {
+        CrowdAgentConfig config;
+        config.radius = m_navMesh->m_agentRadius;
+        config.height = m_navMesh->m_agentHeight;
+        config.maxSpeed = m_movementSpeed;
+        m_crowdAgent = crowd.addAgent(m_character, config);
+    }
 }
 
 CharacterController::~CharacterController() {
+    Crowd::getInstance().removeAgent(m_crowdAgent);
+    PathService::getInstance().cancel(m_pathRequest);
     TraceLog(LOG_INFO, "CharacterController: Destroyed");
 }
 
+void CharacterController::setMovementSpeed(float speed) {
+    m_movementSpeed = speed;
+    Crowd::getInstance().setMaxSpeed(m_crowdAgent, speed);
+}
+
 void CharacterController::update(GameCamera* camera) {
     if (!m_character || !m_navMesh || !camera) {
         return;
@@ -49,14 +70,39 @@ void CharacterController::update(GameCamera* camera) {
     // Gestisce il click del mouse per impostare il target
     handleMouseClick(camera);
 
-    // Muove il character lungo il path
-    if (m_isMoving) {
-        followPath();
+    updateMovement();
+}
+
+void CharacterController::updateMovement() {
+    // La crowd muove il character in Crowd::update, qui solo lo stato
+    if (m_crowdAgent >= 0) {
+        bool wasMoving = m_isMoving;
+        m_isMoving = Crowd::getInstance().isMoving(m_crowdAgent);
+        if (wasMoving && !m_isMoving) {
+            stop();
+        } else if (m_isMoving) {
+            m_character->updateAnimation();
+        }
+        return;
+    }
+
+    // Muove il character lungo il path, appena PathService lo ha calcolato
+    if (m_character && m_isMoving) {
+        if (pollPathRequest()) {
+            followPath();
+        }
         // Update character animation while moving
         m_character->updateAnimation();
     }
 }
 
+bool CharacterController::moveTo(Vector3 target) {
+    m_targetPoint = target;
+    m_hasTarget = true;
+    calculatePath(target);
+    return m_isMoving;
+}
+
 void CharacterController::handleMouseClick(GameCamera* camera) {
     // Use InputManager to check for character movement action
     // InputManager automatically handles ImGui capture checking
@@ -103,21 +149,14 @@ bool CharacterController::raycastToNavMesh(GameCamera* camera, Vector3& hitPoint
 
     RayCollision closestHit = {0};
     closestHit.hit = false;
-    closestHit.distance = std::numeric_limits<float>::max();
-
-    // Ottiene il modello della mappa dal parent della camera
-    auto mapObj = camera->getParent()->getChildOfType<Map>();
-    if (mapObj) {
-        const Model& model = mapObj->model;  // Reference to avoid VRAM copy
-
-        // Testa il ray contro tutte le mesh del modello
-        for (int m = 0; m < model.meshCount; m++) {
-            RayCollision hit = GetRayCollisionMesh(ray, model.meshes[m], model.transform);
 
-            if (hit.hit && hit.distance < closestHit.distance) {
-                closestHit = hit;
-            }
-        }
+    // Usa la BVH del terreno; se la mappa non e' stata passata la cerca
+    const Map* ground = m_ground;
+    if (!ground) {
+        ground = ObjectRegistry::getInstance().getFirst<Map>();
+    }
+    if (ground) {
+        closestHit = ground->raycaster.raycast(ray);
     }
 
     if (closestHit.hit) {
@@ -142,27 +181,65 @@ void CharacterController::calculatePath(Vector3 targetPos) {
         return;
     }
 
-    Vector3 startPos = m_character->position;
+    if (m_crowdAgent >= 0) {
+        // Il path viene pianificato dalla crowd nei prossimi update
+        m_currentPath.clear();
+        m_isMoving = Crowd::getInstance().requestMove(m_crowdAgent, targetPos);
+        if (m_isMoving) {
+            if (m_character->setAnimation("Running")) {
+                m_character->playAnimation();
+            }
+        } else {
+            m_character->stopAnimation();
+            TraceLog(LOG_WARNING, "CharacterController: Target not on navmesh");
+        }
+        return;
+    }
 
-    // Usa NavMesh::findPath per calcolare il percorso
-    m_currentPath = m_navMesh->findPath(startPos, targetPos);
+    // Il path arriva da PathService in un prossimo update: fino ad allora
+    // il character resta fermo ma risulta in movimento
+    PathService& paths = PathService::getInstance();
+    paths.cancel(m_pathRequest);
+    m_currentPath.clear();
+    m_currentPathIndex = 0;
+    m_pathRequest = paths.request(m_character->position, targetPos);
 
-    if (m_currentPath.size() > 0) {
-        m_currentPathIndex = 0;
+    if (m_pathRequest != 0) {
         m_isMoving = true;
 
         // Start the Running animation
         if (m_character->setAnimation("Running")) {
             m_character->playAnimation();
         }
-
-        TraceLog(LOG_INFO, "CharacterController: Path calculated with %d waypoints",
-                 (int)m_currentPath.size());
     } else {
         m_isMoving = false;
         m_character->stopAnimation();
+        TraceLog(LOG_WARNING, "CharacterController: Failed to request path");
+    }
+}
+
+bool CharacterController::pollPathRequest() {
+    if (m_pathRequest == 0) {
+        return true;
+    }
+
+    PathService& paths = PathService::getInstance();
+    PathStatus status = paths.getStatus(m_pathRequest);
+    if (status == PathStatus::Pending) {
+        return false;
+    }
+
+    bool found = paths.takePath(m_pathRequest, m_currentPath);
+    m_pathRequest = 0;
+    if (!found || m_currentPath.empty()) {
+        stop();
         TraceLog(LOG_WARNING, "CharacterController: Failed to find path");
+        return false;
     }
+
+    TraceLog(LOG_INFO, "CharacterController: Path calculated with %d waypoints",
+             (int)m_currentPath.size());
+    return true;
 }
 
 void CharacterController::followPath() {
@@ -205,8 +282,8 @@ void CharacterController::followPath() {
     m_character->position = Vector3Add(m_character->position, movement);
 
     // Snap continuo alla geometria per seguire pendenze/lati
-    if (m_groundModel) {
-        m_character->snapToGround(*m_groundModel);
+    if (m_ground) {
+        m_character->snapToGround(*m_ground);
     }
 
     // Calcola la rotazione del character verso la direzione di movimento
@@ -216,6 +293,9 @@ void CharacterController::followPath() {
 }
 
 void CharacterController::stop() {
+    Crowd::getInstance().stop(m_crowdAgent);
+    PathService::getInstance().cancel(m_pathRequest);
+    m_pathRequest = 0;
     m_isMoving = false;
     m_currentPath.clear();
     m_currentPathIndex = 0;
@@ -231,6 +311,12 @@ void CharacterController::drawDebug() {
         return;
     }
 
+    // Con la crowd il path sono gli angoli verso cui sta sterzando
+    if (m_crowdAgent >= 0) {
+        Crowd::getInstance().getCorners(m_crowdAgent, m_currentPath);
+        m_currentPathIndex = 0;
+    }
+
     // Disegna il path corrente
     if (!m_currentPath.empty()) {
         for (size_t i = 0; i < m_currentPath.size(); i++) {
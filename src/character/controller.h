@@ -2,6 +2,7 @@
 
 #include "character.h"
 #include "../navigation/navmesh.h"
+#include "../navigation/path_service.h"
 #include "../camera/camera.h"
 #include <raylib.h>
 #include <vector>
@@ -14,7 +15,7 @@ namespace moiras {
  */
 class CharacterController {
 public:
-    CharacterController(Character* character, NavMesh* navMesh, const Model* groundModel = nullptr);
+    CharacterController(Character* character, NavMesh* navMesh, const Map* ground = nullptr);
     ~CharacterController();
 
     /**
@@ -23,6 +24,22 @@ public:
      */
     void update(GameCamera* camera);
 
+    /**
+     * Avanza il movimento lungo il path corrente senza leggere l'input
+     * (agenti guidati da codice, modalita' headless)
+     */
+    void updateMovement();
+
+    /**
+     * Chiede un path verso target e inizia a seguirlo appena e' pronto.
+     * Con la Crowd il path lo pianifica dtCrowd, altrimenti PathService:
+     * in entrambi i casi il risultato arriva nei frame successivi.
+     * @return false solo se la richiesta non parte (target fuori dalla
+     * navmesh con la Crowd, servizio non inizializzato); un path che non
+     * esiste viene scoperto dopo e il character si ferma (isMoving() false)
+     */
+    bool moveTo(Vector3 target);
+
     /**
      * Disegna debug info (path, target point, etc.)
      */
@@ -31,7 +48,7 @@ public:
     /**
      * Imposta la velocità di movimento del character
      */
-    void setMovementSpeed(float speed) { m_movementSpeed = speed; }
+    void setMovementSpeed(float speed);
 
     /**
      * Ottiene la velocità di movimento corrente
@@ -51,7 +68,7 @@ public:
 private:
     Character* m_character;
     NavMesh* m_navMesh;
-    const Model* m_groundModel;  // Modello per snap continuo alla geometria
+    const Map* m_ground;  // Mappa per snap continuo alla geometria (heightfield + BVH)
 
     // Path corrente
     std::vector<Vector3> m_currentPath;
@@ -68,6 +85,16 @@ private:
     // Distanza minima per considerare raggiunto un waypoint
     float m_waypointThreshold;
 
+    // Handle nella Crowd (-1 = path seguito direttamente dal controller).
+    // Game e headless inizializzano la Crowd prima dei controller, quindi
+    // il ramo senza Crowd serve solo oltre Crowd::MAX_AGENTS o senza Crowd
+    // (es. strumenti che usano il controller da soli)
+    int m_crowdAgent;
+
+    // Richiesta di path in attesa in PathService (0 = nessuna), solo nel
+    // ramo senza Crowd
+    PathRequestId m_pathRequest;
+
     /**
      * Gestisce il click del mouse per impostare il target
      * @param camera La camera per fare il raycast
@@ -91,6 +118,12 @@ private:
      * Calcola il path dalla posizione corrente al target
      */
     void calculatePath(Vector3 targetPos);
+
+    /**
+     * Legge il risultato della richiesta in PathService
+     * @return false finche' il path non e' pronto
+     */
+    bool pollPathRequest();
 };
 
 } // namespace moiras
@@ -1,11 +1,17 @@
 #include "game.h"
 #include "../building/structure.h"
 #include "../camera/camera.h"
+#include "../camera/frustum.h"
+#include "../camera/occlusion.h"
 #include "../character/character.h"
 #include "../gui/gui.h"
 #include "../gui/sidebar.h"
 #include "../gui/script_editor.h"
 #include "../input/input_manager.h"
+#include "../jobs/job_system.h"
+#include "../navigation/crowd.h"
+#include "../navigation/path_service.h"
+#include "../profiler/profiler.h"
 #include "../time/time_manager.h"
 #include "../map/environment.hpp"
 #include "../src/audio/audiodevice.hpp"
@@ -20,7 +26,11 @@
 namespace moiras
 {
 
-  Game::Game() { auto root = std::make_unique<GameObject>(); }
+  Game::Game()
+  {
+    auto root = std::make_unique<GameObject>();
+    ObjectRegistry::getInstance().setSpatialIndex(&m_spatialIndex);
+  }
 
   void Game::setup()
   {
@@ -28,6 +38,9 @@ namespace moiras
     renderTarget = LoadRenderTexture(GetScreenWidth(), GetScreenHeight());
     rlImGuiSetup(false);
 
+    // Worker condivisi da tutti i sottosistemi (vedi JobSystem::parallel_for)
+    JobSystem::getInstance().init();
+
     renderLoadingFrame("Inizializzazione scripting...", 0.0f);
 
     // Initialize the Lua scripting engine
@@ -151,6 +164,10 @@ namespace moiras
         char msg[128];
         snprintf(msg, sizeof(msg), "Costruzione NavMesh... (tile %d/%d)", current, total);
         renderLoadingFrame(msg, overallProgress); });
+      renderLoadingFrame("Heightfield del terreno...", 0.90f);
+      mapPtr->buildHeightfield();
+      mapPtr->buildShadowChunks();
+      OcclusionCuller::getInstance().buildTerrainOccluder(mapPtr->heightfield);
       TraceLog(LOG_INFO, "Shader assigned, ID: %d",
                mapPtr->model.materials[0].shader.id);
     }
@@ -164,8 +181,8 @@ namespace moiras
     {
       renderLoadingFrame("Generazione rocce...", 0.90f);
       auto rocks = std::make_unique<EnvironmentalObject>(1.0f, 200.0f);
-      rocks->generate(mapPtr->model, 300, RockMeshType::CUBE);
-      rocks->generate(mapPtr->model, 200, RockMeshType::SPHERE);
+      rocks->generate(*mapPtr, 300, RockMeshType::CUBE);
+      rocks->generate(*mapPtr, 200, RockMeshType::SPHERE);
       auto *rocksPtr = rocks.get();
       root.addChild(std::move(rocks));
       if (sidebar)
@@ -185,9 +202,15 @@ namespace moiras
     registerObject(player->id, player.get());
     auto playerPtr = getObjectByID<Character>(player->id);
     root.addChild(std::move(player));
+    if (mapPtr)
+    {
+      // Prima dei controller: ognuno registra il proprio agente
+      Crowd::getInstance().init(&mapPtr->navMesh, mapPtr);
+      PathService::getInstance().init(&mapPtr->navMesh);
+    }
     if (mapPtr && playerPtr)
     {
-      playerController = std::make_unique<CharacterController>(playerPtr, &mapPtr->navMesh, &mapPtr->model);
+      playerController = std::make_unique<CharacterController>(playerPtr, &mapPtr->navMesh, mapPtr);
       playerController->setMovementSpeed(12.0f);
       TraceLog(LOG_INFO, "Player controller created and initialized");
     }
@@ -209,7 +232,8 @@ namespace moiras
     renderLoadingFrame("Inizializzazione ombre...", 0.96f);
     lightmanager.registerShadowShader(celShader);
     lightmanager.setupShadowMap("../assets/shaders/shadow_depth.vs",
-                                "../assets/shaders/shadow_depth.fs");
+                                "../assets/shaders/shadow_depth.fs",
+                                "../assets/shaders/shadow_depth_instanced.vs");
     renderLoadingFrame("Pronto!", 1.0f);
     TraceLog(LOG_INFO, "SCRIPTING: Lua scripting system ready");
   }
@@ -267,59 +291,76 @@ namespace moiras
 
   void Game::loop(Window window)
   {
+    Profiler &profiler = Profiler::getInstance();
     while (!window.shouldClose())
     {
+      profiler.beginFrame();
+      PROFILE_SCOPE("Frame");
+
       // Update TimeManager first (caches delta time for the frame)
       TimeManager::getInstance().update();
 
       // Update input manager and set context based on game state
       InputManager &input = InputManager::getInstance();
-
-      // Determine current context
-      if (scriptEditor && scriptEditor->isOpen())
-      {
-        input.setContext(InputContext::UI);
-      }
-      else if (structureBuilder && structureBuilder->isBuildingMode())
-      {
-        input.setContext(InputContext::BUILDING);
-      }
-      else
       {
-        input.setContext(InputContext::GAME);
-      }
+        PROFILE_SCOPE("Input");
+
+        // Determine current context
+        if (scriptEditor && scriptEditor->isOpen())
+        {
+          input.setContext(InputContext::UI);
+        }
+        else if (structureBuilder && structureBuilder->isBuildingMode())
+        {
+          input.setContext(InputContext::BUILDING);
+        }
+        else
+        {
+          input.setContext(InputContext::GAME);
+        }
 
-      // Update input state (must be called before any input queries)
-      input.update();
+        // Update input state (must be called before any input queries)
+        input.update();
 
-      // Handle pause toggle (works in any context)
-      if (input.isActionJustPressed(InputAction::UI_TOGGLE_PAUSE))
-      {
-        TimeManager::getInstance().togglePause();
-      }
+        // Handle pause toggle (works in any context)
+        if (input.isActionJustPressed(InputAction::UI_TOGGLE_PAUSE))
+        {
+          TimeManager::getInstance().togglePause();
+        }
 
-      // Handle speed changes (works in any context)
-      if (input.isActionJustPressed(InputAction::UI_SPEED_NORMAL))
-      {
-        TimeManager::getInstance().setTimeScale(1.0f);
-      }
-      if (input.isActionJustPressed(InputAction::UI_SPEED_MEDIUM))
-      {
-        TimeManager::getInstance().setTimeScale(2.5f);
-      }
-      if (input.isActionJustPressed(InputAction::UI_SPEED_FAST))
-      {
-        TimeManager::getInstance().setTimeScale(5.0f);
+        // Handle speed changes (works in any context)
+        if (input.isActionJustPressed(InputAction::UI_SPEED_NORMAL))
+        {
+          TimeManager::getInstance().setTimeScale(1.0f);
+        }
+        if (input.isActionJustPressed(InputAction::UI_SPEED_MEDIUM))
+        {
+          TimeManager::getInstance().setTimeScale(2.5f);
+        }
+        if (input.isActionJustPressed(InputAction::UI_SPEED_FAST))
+        {
+          TimeManager::getInstance().setTimeScale(5.0f);
+        }
+
+        // Toggle script editor with F12 (always works)
+        if (input.isActionJustPressed(InputAction::UI_TOGGLE_SCRIPT_EDITOR) && scriptEditor)
+        {
+          scriptEditor->setOpen(!scriptEditor->isOpen());
+        }
+
+        // Salva gli ultimi frame del profiler in formato Chrome trace
+        if (input.isActionJustPressed(InputAction::UI_DUMP_PROFILE))
+        {
+          profiler.dumpChromeTrace(TextFormat("moiras_trace_%d.json", m_frameCount),
+                                   profiler.dumpFrameCount);
+        }
       }
 
-      // Toggle script editor with F12 (always works)
-      if (input.isActionJustPressed(InputAction::UI_TOGGLE_SCRIPT_EDITOR) && scriptEditor)
       {
-        scriptEditor->setOpen(!scriptEditor->isOpen());
+        PROFILE_SCOPE("Update");
+        root.update();
       }
 
-      root.update();
-
       // Hot-reload check every 60 frames (~1 second at 60fps)
       m_frameCount++;
       if (m_frameCount % 60 == 0)
@@ -329,13 +370,17 @@ namespace moiras
 
       // Update all Lua scripts with scaled delta time
       float dt = TimeManager::getInstance().getGameDeltaTime();
-      updateScriptsRecursive(&root, dt);
+      {
+        PROFILE_SCOPE("Scripts");
+        updateScriptsRecursive(&root, dt);
+      }
 
-      auto camera = root.getChildOfType<GameCamera>();
-      auto map = root.getChildOfType<Map>();
+      ObjectRegistry &objects = ObjectRegistry::getInstance();
+      auto camera = objects.getFirst<GameCamera>();
+      auto map = objects.getFirst<Map>();
 
       // Aggiorna il player controller (solo se non siamo in building mode o brush mode)
-      auto *rocks = root.getChildOfType<EnvironmentalObject>();
+      auto *rocks = objects.getFirst<EnvironmentalObject>();
       bool inBuildingMode =
           (structureBuilder && structureBuilder->isBuildingMode());
       bool inBrushMode = (rocks && rocks->isBrushMode());
@@ -343,6 +388,10 @@ namespace moiras
       {
         playerController->update(camera);
       }
+      // Path richiesti in questo frame, poi un solo update per tutti gli
+      // agenti (path, avoidance, posizioni)
+      PathService::getInstance().update();
+      Crowd::getInstance().update(dt);
       // auto audioManager = root.getChildOfType<AudioManager>();
       //  Aggiorna luci
       lightmanager.updateCameraPosition(camera->rcamera.position);
@@ -353,6 +402,16 @@ namespace moiras
         rocks->updateCameraPos(camera->rcamera.position);
       }
 
+      // Ricalcola le matrici world solo degli oggetti spostati (dopo tutti
+      // gli update, prima di shadow pass e draw che le riusano)
+      {
+        PROFILE_SCOPE("Transforms");
+        // Riallinea l'indice spaziale dopo tutto cio' che muove gli oggetti
+        // (script, player controller, Crowd)
+        m_spatialIndex.updateAll();
+        root.updateTransforms();
+      }
+
       // Update cel shader uniforms needed for CSM shadow mapping
       {
         float camPos[3] = {camera->rcamera.position.x, camera->rcamera.position.y, camera->rcamera.position.z};
@@ -383,46 +442,63 @@ namespace moiras
       // Shadow pass: render depth from light's perspective using CSM
       if (lightmanager.areShadowsEnabled())
       {
-        lightmanager.shadowFrameCounter++;
-        bool shouldUpdateShadow = (lightmanager.shadowFrameCounter % lightmanager.shadowUpdateInterval) == 0;
+        // Strutture piazzate/rimosse/modificate o rocce modificate: la
+        // profondita' statica in cache non e' piu' valida. I due contatori
+        // delle strutture crescono soltanto, la somma cambia con ognuno.
+        unsigned int structureRevision =
+            objects.revision<Structure>() + Structure::getRevision();
+        unsigned long long staticKey =
+            ((unsigned long long)structureRevision << 32) |
+            (rocks ? (rocks->getRevision() << 1 | (rocks->isVisible ? 1u : 0u)) : 0u);
+        if (staticKey != m_staticShadowKey)
+        {
+          m_staticShadowKey = staticKey;
+          lightmanager.invalidateStaticShadows();
+        }
 
-        if (shouldUpdateShadow)
+        // Cascate vicine a ogni frame, lontane a frame alterni (vedi
+        // LightManager::cascadeInterval)
+        unsigned int cascadeMask = lightmanager.scheduleShadowCascades();
+
+        if (cascadeMask != 0)
         {
+          PROFILE_SCOPE("Shadow pass");
           float aspect = (float)GetScreenWidth() / (float)GetScreenHeight();
           lightmanager.updateCascadeMatrices(camera->rcamera, nearPlane, aspect);
 
           lightmanager.beginShadowPass();
 
           Material shadowMat = lightmanager.getShadowMaterial();
+          Material shadowInstancedMat = lightmanager.getShadowInstancedMaterial();
 
-          // Render all shadow casters into each cascade
+          // Render into each cascade only the casters inside its light volume
+          static const char *cascadeScopes[NUM_CASCADES] = {
+              "Cascade 0", "Cascade 1", "Cascade 2", "Cascade 3"};
+          bool staticCache = lightmanager.isStaticCacheActive();
           for (int c = 0; c < NUM_CASCADES; c++)
           {
-            lightmanager.setCascade(c);
-
-            // Map terrain
-            if (map && map->model.meshCount > 0)
+            if (!(cascadeMask & (1u << c)))
+              continue;
+            PROFILE_SCOPE(cascadeScopes[c]);
+            lightmanager.shadowCastersDrawn[c] = 0;
+            lightmanager.shadowCastersCulled[c] = 0;
+
+            // Terreno, rocce e strutture: nella cache statica solo quando
+            // e' stata invalidata, altrimenti direttamente nell'atlas
+            if (staticCache && lightmanager.isStaticCascadeDirty(c))
             {
-              Matrix mapTransform = MatrixMultiply(map->model.transform,
-                                                   MatrixTranslate(map->position.x, map->position.y, map->position.z));
-              for (int i = 0; i < map->model.meshCount; i++)
-              {
-                DrawMesh(map->model.meshes[i], shadowMat, mapTransform);
-              }
+              PROFILE_SCOPE("Static casters");
+              lightmanager.beginStaticCascade(c);
+              drawStaticShadowCasters(shadowMat, shadowInstancedMat, c);
             }
-
-            // Instanced rocks shadow pass (per-patch)
-            if (rocks && rocks->isVisible) {
-              for (int p = 0; p < rocks->getPatchCount(); p++) {
-                auto &patch = rocks->getPatch(p);
-                for (auto &t : patch.transforms) {
-                  DrawMesh(patch.mesh, shadowMat, t);
-                }
-              }
+            lightmanager.setCascade(c);
+            if (!staticCache)
+            {
+              drawStaticShadowCasters(shadowMat, shadowInstancedMat, c);
             }
 
-            // Characters, structures, and other shadow casters
-            drawShadowCastersRecursive(&root, shadowMat);
+            // Characters sopra la profondita' statica
+            drawDynamicShadowCasters(shadowMat, c);
           }
 
           lightmanager.endShadowPass();
@@ -437,175 +513,261 @@ namespace moiras
       lightmanager.updateShadowUniforms();
 
       // Render scene to texture
-      BeginTextureMode(renderTarget);
-      ClearBackground(DARKBLUE);
-      camera->beginMode3D();
-      root.draw();
-      auto ray = camera->getRay();
-      RayCollision closest = {0};
-      closest.hit = false;
-      closest.distance = std::numeric_limits<float>::max();
-      RayCollision meshHitInfo = {0};
-
-      for (int m = 0; m < map->model.meshCount; m++)
       {
-        meshHitInfo =
-            GetRayCollisionMesh(ray, map->model.meshes[m], map->model.transform);
-        if (meshHitInfo.hit)
+        PROFILE_SCOPE("Main pass");
+        BeginTextureMode(renderTarget);
+        ClearBackground(DARKBLUE);
+        camera->beginMode3D();
+        rasterizeOccluders();
+        root.draw();
         {
-          if ((!closest.hit) || (closest.distance > meshHitInfo.distance))
-            closest = meshHitInfo;
-          break;
+          OcclusionCuller &occlusion = OcclusionCuller::getInstance();
+          occlusion.endFrame();
+          PROFILE_COUNTER("Occlusion tested", occlusion.getTestedCount());
+          PROFILE_COUNTER("Occlusion culled", occlusion.getCulledCount());
         }
-      }
+        auto ray = camera->getRay();
+        RayCollision closest = map->raycaster.raycast(ray);
 
-      if (closest.hit)
-      {
-        // Brush mode: anteprima cerchio e input paint/erase
-        if (inBrushMode && rocks)
+        if (closest.hit)
         {
-          float brushR = rocks->getBrushRadius();
-          DrawCircle3D(closest.point, brushR,
-                       {1.0f, 0.0f, 0.0f}, 90.0f, {0, 200, 0, 180});
-
-          if (IsMouseButtonDown(MOUSE_BUTTON_LEFT))
+          // Brush mode: anteprima cerchio e input paint/erase
+          if (inBrushMode && rocks)
           {
-            rocks->paintAt(closest.point);
+            float brushR = rocks->getBrushRadius();
+            DrawCircle3D(closest.point, brushR,
+                         {1.0f, 0.0f, 0.0f}, 90.0f, {0, 200, 0, 180});
+
+            if (IsMouseButtonDown(MOUSE_BUTTON_LEFT))
+            {
+              rocks->paintAt(closest.point);
+            }
+            if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT))
+            {
+              rocks->eraseAt(closest.point);
+            }
           }
-          if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT))
+          else
           {
-            rocks->eraseAt(closest.point);
+            DrawCube(closest.point, 0.3f, 0.3f, 0.3f, ORANGE);
+            Vector3 normalEnd;
+            normalEnd.x = closest.point.x + closest.normal.x;
+            normalEnd.y = closest.point.y + closest.normal.y;
+            normalEnd.z = closest.point.z + closest.normal.z;
+            DrawLine3D(closest.point, normalEnd, RED);
           }
         }
-        else
-        {
-          DrawCube(closest.point, 0.3f, 0.3f, 0.3f, ORANGE);
-          Vector3 normalEnd;
-          normalEnd.x = closest.point.x + closest.normal.x;
-          normalEnd.y = closest.point.y + closest.normal.y;
-          normalEnd.z = closest.point.z + closest.normal.z;
-          DrawLine3D(closest.point, normalEnd, RED);
-        }
-      }
 
-      camera->endMode3D();
-      EndTextureMode();
+        camera->endMode3D();
+        EndTextureMode();
+      }
 
       // Draw to screen
       camera->beginDrawing();
-
-      // Applica l'outline shader solo se abilitato
-      if (this->outlineEnabled)
       {
-        BeginShaderMode(outlineShader);
-      }
+        PROFILE_SCOPE("Post");
 
-      DrawTextureRec(renderTarget.texture,
-                     (Rectangle){0, 0, (float)renderTarget.texture.width,
-                                 (float)-renderTarget.texture.height},
-                     (Vector2){0, 0}, WHITE);
+        // Applica l'outline shader solo se abilitato
+        if (this->outlineEnabled)
+        {
+          BeginShaderMode(outlineShader);
+        }
 
-      if (this->outlineEnabled)
-      {
-        EndShaderMode();
-      }
+        DrawTextureRec(renderTarget.texture,
+                       (Rectangle){0, 0, (float)renderTarget.texture.width,
+                                   (float)-renderTarget.texture.height},
+                       (Vector2){0, 0}, WHITE);
 
-      camera->beginMode3D();
-      if (map && map->showNavMeshDebug && map->navMeshBuilt)
-      {
-        map->navMesh.drawDebug();
-      }
-      if (map && map->showPath && map->debugPath.size() > 1)
-      {
-        for (size_t i = 0; i < map->debugPath.size() - 1; i++)
+        if (this->outlineEnabled)
         {
-          DrawLine3D(map->debugPath[i], map->debugPath[i + 1], RED);
-          DrawSphere(map->debugPath[i], 0.5f, YELLOW);
+          EndShaderMode();
         }
-        DrawSphere(map->debugPath.back(), 0.5f, YELLOW);
-      }
 
-      // Draw player controller debug (path, waypoints, target)
-      // Visibile sempre (non legato a showNavMeshDebug)
-      if (playerController && map && map->showPath)
-      {
-        playerController->drawDebug();
-      }
+        camera->beginMode3D();
+        if (map && map->showNavMeshDebug && map->navMeshBuilt)
+        {
+          map->navMesh.drawDebug();
+        }
+        if (Crowd::getInstance().debugDraw)
+        {
+          Crowd::getInstance().drawDebug();
+        }
+        if (map && map->showPath && map->debugPath.size() > 1)
+        {
+          for (size_t i = 0; i < map->debugPath.size() - 1; i++)
+          {
+            DrawLine3D(map->debugPath[i], map->debugPath[i + 1], RED);
+            DrawSphere(map->debugPath[i], 0.5f, YELLOW);
+          }
+          DrawSphere(map->debugPath.back(), 0.5f, YELLOW);
+        }
 
-      camera->endMode3D();
+        // Draw player controller debug (path, waypoints, target)
+        // Visibile sempre (non legato a showNavMeshDebug)
+        if (playerController && map && map->showPath)
+        {
+          playerController->drawDebug();
+        }
+
+        camera->endMode3D();
+      }
       //  ImGui
-      rlImGuiBegin();
-      root.gui();
-      rlImGuiEnd();
+      {
+        PROFILE_SCOPE("ImGui");
+        rlImGuiBegin();
+        root.gui();
+        rlImGuiEnd();
+      }
 
-      camera->endDrawing();
+      {
+        // Include l'attesa del vsync
+        PROFILE_SCOPE("Present");
+        camera->endDrawing();
+      }
     }
   }
 
-  void Game::drawShadowCastersRecursive(GameObject *obj, Material &shadowMat)
+  void Game::drawStaticShadowCasters(Material &shadowMat, Material &shadowInstancedMat,
+                                     int cascade)
   {
-    if (!obj)
-      return;
+    ObjectRegistry &objects = ObjectRegistry::getInstance();
+    Map *map = objects.getFirst<Map>();
 
-    // Characters
-    if (auto *character = dynamic_cast<Character *>(obj))
+    // Map terrain: chunk XZ se disponibili, altrimenti mesh intere
+    if (map && map->shadowChunks.isBuilt())
     {
-      if (character->isVisible && character->hasModel())
+      Matrix chunkTransform = MatrixTranslate(map->position.x, map->position.y, map->position.z);
+      for (const auto &chunk : map->shadowChunks.getChunks())
       {
-        Quaternion q = QuaternionFromEuler(
-            character->eulerRot.x * DEG2RAD,
-            character->eulerRot.y * DEG2RAD,
-            character->eulerRot.z * DEG2RAD);
-        Vector3 axis;
-        float angle;
-        QuaternionToAxisAngle(q, &axis, &angle);
-        Matrix matScale = MatrixScale(character->scale, character->scale, character->scale);
-        Matrix matRotation = MatrixRotate(axis, angle);
-        Matrix matTranslation = MatrixTranslate(
-            character->position.x, character->position.y, character->position.z);
-        Matrix transform = MatrixMultiply(MatrixMultiply(matScale, matRotation), matTranslation);
-
-        for (int i = 0; i < character->modelInstance.meshCount(); i++)
+        if (lightmanager.cascadeIntersectsBox(cascade, chunk.bounds, chunkTransform))
         {
-          DrawMesh(character->modelInstance.meshes()[i], shadowMat, transform);
+          DrawMesh(chunk.mesh, shadowMat, chunkTransform);
+          lightmanager.shadowCastersDrawn[cascade]++;
+        }
+        else
+        {
+          lightmanager.shadowCastersCulled[cascade]++;
         }
       }
     }
+    else if (map && map->model.meshCount > 0)
+    {
+      Matrix mapTransform = MatrixMultiply(map->model.transform,
+                                           MatrixTranslate(map->position.x, map->position.y, map->position.z));
+      for (int i = 0; i < map->model.meshCount; i++)
+      {
+        DrawMesh(map->model.meshes[i], shadowMat, mapTransform);
+      }
+      lightmanager.shadowCastersDrawn[cascade] += map->model.meshCount;
+    }
 
-    // Structures
-    if (auto *structure = dynamic_cast<Structure *>(obj))
+    // Instanced rocks shadow pass: una draw call per patch
+    auto *rocks = objects.getFirst<EnvironmentalObject>();
+    if (rocks && rocks->isVisible)
+    {
+      rocks->drawShadow(lightmanager, cascade, shadowMat, shadowInstancedMat);
+    }
+
+    // Structures: matrici world gia' in cache, bounds del modello in cache
+    // nella ModelInstance
+    objects.forEach<Structure>([&](Structure *structure)
     {
       if (structure->isVisible && structure->hasModel())
       {
-        Matrix matScale = MatrixScale(structure->scale, structure->scale, structure->scale);
-        Matrix matRotation = QuaternionToMatrix(structure->rotation);
-        Matrix matTranslation = MatrixTranslate(
-            structure->position.x, structure->position.y, structure->position.z);
-        Matrix transform = MatrixMultiply(MatrixMultiply(matScale, matRotation), matTranslation);
-
+        const Matrix &transform = structure->getWorldMatrix();
+        if (!lightmanager.cascadeIntersectsBox(cascade, structure->modelInstance.getBoundingBox(), transform))
+        {
+          lightmanager.shadowCastersCulled[cascade]++;
+          return;
+        }
+        // LOD dalla risoluzione della cascata, non dalla camera: la
+        // profondita' statica in cache resta valida
+        int lod = selectMeshLod(structure->getBoundingRadius() * lightmanager.getCascadeLodScale(cascade),
+                                structure->modelInstance.lodCount());
         for (int i = 0; i < structure->modelInstance.meshCount(); i++)
         {
-          DrawMesh(structure->modelInstance.meshes()[i], shadowMat, transform);
+          DrawMesh(structure->modelInstance.lodMesh(i, lod), shadowMat, transform);
         }
+        lightmanager.shadowCastersDrawn[cascade]++;
       }
-    }
+    });
+  }
 
-    // Recurse into children
-    for (auto &child : obj->children)
+  void Game::rasterizeOccluders()
+  {
+    OcclusionCuller &occlusion = OcclusionCuller::getInstance();
+    if (!occlusion.enabled)
+      return;
+    PROFILE_SCOPE("Occlusion");
+
+    Matrix viewProjection = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    occlusion.beginFrame(viewProjection);
+
+    // Strutture grandi nel frustum, a LOD0: i LOD semplificati possono
+    // uscire dalla superficie vera (parti concave) e non sarebbero
+    // occluder conservativi
+    Frustum frustum = Frustum::fromMatrix(viewProjection);
+    ObjectRegistry::getInstance().forEach<Structure>([&](Structure *structure)
     {
-      if (child)
+      if (!structure->isVisible || !structure->hasModel())
+        return;
+      float radius = structure->getBoundingRadius();
+      if (radius < occlusion.minOccluderRadius)
+        return;
+      const Matrix &transform = structure->getWorldMatrix();
+      BoundingBox box = structure->modelInstance.getBoundingBox();
+      Vector3 center = Vector3Transform(Vector3Scale(Vector3Add(box.min, box.max), 0.5f), transform);
+      if (!frustum.intersectsSphere(center, radius))
+        return;
+      for (int i = 0; i < structure->modelInstance.meshCount(); i++)
       {
-        drawShadowCastersRecursive(child.get(), shadowMat);
+        occlusion.addOccluder(structure->modelInstance.lodMesh(i, 0), transform);
       }
-    }
+    });
+
+    occlusion.rasterize();
+  }
+
+  void Game::drawDynamicShadowCasters(Material &shadowMat, int cascade)
+  {
+    ObjectRegistry::getInstance().forEach<Character>([&](Character *character)
+    {
+      if (character->isVisible && character->hasModel())
+      {
+        const Matrix &transform = character->getWorldMatrix();
+        // Margine per le pose animate fuori dai bounds della bind pose
+        BoundingBox box = character->modelInstance.getBoundingBox();
+        Vector3 margin = Vector3Scale(Vector3Subtract(box.max, box.min), 0.25f);
+        box.min = Vector3Subtract(box.min, margin);
+        box.max = Vector3Add(box.max, margin);
+        if (!lightmanager.cascadeIntersectsBox(cascade, box, transform))
+        {
+          lightmanager.shadowCastersCulled[cascade]++;
+          return;
+        }
+        for (int i = 0; i < character->modelInstance.meshCount(); i++)
+        {
+          DrawMesh(character->modelInstance.meshes()[i], shadowMat, transform);
+        }
+        lightmanager.shadowCastersDrawn[cascade]++;
+      }
+    });
   }
 
   Game::~Game()
   {
+    // La scena (root) viene distrutta fra i membri: non deve piu' toccare
+    // l'indice
+    ObjectRegistry::getInstance().setSpatialIndex(nullptr);
     ScriptEngine::instance().shutdown();
-    lightmanager.unload();
-    UnloadShader(outlineShader);
-    UnloadRenderTexture(renderTarget);
-    rlImGuiShutdown();
+    // In headless non esistono risorse GL ne' contesto ImGui
+    if (!m_headless)
+    {
+      lightmanager.unload();
+      UnloadShader(outlineShader);
+      UnloadRenderTexture(renderTarget);
+      rlImGuiShutdown();
+    }
+    JobSystem::getInstance().shutdown();
   }
 } // namespace moiras
@@ -11,10 +11,24 @@
 #include "../gui/script_editor.h"
 #include "../map/environment.hpp"
 #include "game_object.h"
+#include "object_registry.h"
+#include "spatial_index.h"
 #include <memory>
 #include <raylib.h>
 namespace moiras
 {
+  // Opzioni della modalita' headless (--headless): simulazione senza
+  // finestra ne' contesto GL, per benchmark e test con molti agenti
+  struct HeadlessConfig
+  {
+    int maxFrames = 0;       // 0 = nessun limite
+    float maxSeconds = 0.0f; // tempo simulato, 0 = nessun limite
+    float fixedDeltaTime = 1.0f / 60.0f;
+    float tickRate = 0.0f; // tick reali al secondo, 0 = il piu' veloce possibile
+    int agentCount = 0;    // Character che vagano fra punti casuali della navmesh
+    unsigned int seed = 1;
+  };
+
   class Game
   {
     RenderTexture2D renderTarget;
@@ -24,10 +38,24 @@ namespace moiras
     float farPlane;
     int depthTextureLoc;
     std::unordered_map<unsigned int, GameObject *> registry;
+    // Indice spaziale su tutti gli oggetti della scena: ObjectRegistry lo
+    // aggiorna in addChild e nel distruttore, le posizioni a ogni frame
+    SpatialIndex m_spatialIndex;
     int m_frameCount = 0;
+    bool m_headless = false;
+    // Agenti della modalita' headless
+    std::vector<std::unique_ptr<CharacterController>> m_agentControllers;
 
     void updateScriptsRecursive(GameObject *obj, float dt);
-    void drawShadowCastersRecursive(GameObject *obj, Material &shadowMat);
+    // Terreno, rocce, strutture (cache statica) / characters
+    void drawStaticShadowCasters(Material &shadowMat, Material &shadowInstancedMat,
+                                 int cascade);
+    void drawDynamicShadowCasters(Material &shadowMat, int cascade);
+    // Depth buffer software della camera (terreno + strutture grandi), dentro
+    // BeginMode3D prima di root.draw()
+    void rasterizeOccluders();
+    // Revisioni di strutture e rocce all'ultimo controllo della cache statica
+    unsigned long long m_staticShadowKey = 0;
 
   public:
     GameObject root;
@@ -41,6 +69,10 @@ namespace moiras
     ~Game();
     void setup();
     void loop(Window window);
+    // Carica mappa, navmesh, script e personaggi senza risorse GPU
+    void setupHeadless(const HeadlessConfig &config);
+    // Tick di update/script/pathfinding a passo fisso, senza rendering
+    void runHeadless(const HeadlessConfig &config);
     void renderLoadingFrame(const char *message, float progress);
     void registerObject(unsigned int id, GameObject *object)
     {
@@ -50,6 +82,10 @@ namespace moiras
       }
       registry[id] = object;
     };
+    void unregisterObject(unsigned int id)
+    {
+      registry.erase(id);
+    }
     template <typename T>
     T *getObjectByID(unsigned int id)
     {
@@ -63,16 +99,41 @@ namespace moiras
 
     template <typename T>
     std::vector<T*> getObjectInRange(float radius, Vector3 position)
+    {
+      std::vector<GameObject *> found;
+      m_spatialIndex.queryRadius(position, radius, objectTypeMask<T>(), found);
+      return castObjects<T>(found);
+    }
+
+    template <typename T>
+    std::vector<T*> getObjectsInBox(BoundingBox box)
+    {
+      std::vector<GameObject *> found;
+      m_spatialIndex.queryAABB(box, objectTypeMask<T>(), found);
+      return castObjects<T>(found);
+    }
+
+    // I k oggetti di tipo T piu' vicini a position, dal piu' vicino
+    template <typename T>
+    std::vector<T*> getNearestObjects(Vector3 position, int k,
+                                      float maxRadius = FLT_MAX)
+    {
+      std::vector<GameObject *> found;
+      m_spatialIndex.queryNearest(position, k, objectTypeMask<T>(), found,
+                                  maxRadius);
+      return castObjects<T>(found);
+    }
+
+  private:
+    // Il filtro su typeMask e' gia' fatto dall'indice
+    template <typename T>
+    static std::vector<T*> castObjects(const std::vector<GameObject *> &objects)
     {
       std::vector<T*> results;
-      for (const auto &[id, object] : registry)
+      results.reserve(objects.size());
+      for (GameObject *object : objects)
       {
-        auto target = object->position;
-        auto distance = abs(sqrt(pow((target.x - position.x), 2) + pow((target.y - position.y), 2) - pow((target.z - position.z), 2)));
-        if (radius > distance)
-        {
-          results.push_back(dynamic_cast<T *>(object));
-        }
+        results.push_back(static_cast<T *>(object));
       }
       return results;
     }
@@ -0,0 +1,189 @@
+#include "game.h"
+#include "../jobs/job_system.h"
+#include "../map/map.h"
+#include "../navigation/crowd.h"
+#include "../navigation/path_service.h"
+#include "../profiler/profiler.h"
+#include "../scripting/ScriptEngine.hpp"
+#include "../time/time_manager.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace moiras
+{
+  // Modalita' headless: nessuna chiamata a finestra, GL o ImGui. La mappa
+  // viene caricata solo come geometria CPU (loadModelGeometry), i personaggi
+  // non hanno modello e il tempo avanza a passo fisso.
+
+  void Game::setupHeadless(const HeadlessConfig &config)
+  {
+    m_headless = true;
+    SetRandomSeed(config.seed);
+    JobSystem::getInstance().init();
+
+    ScriptEngine::instance().initialize();
+    ScriptEngine::instance().setGameRoot(&root);
+    ScriptEngine::instance().setGame(this);
+    ScriptEngine::instance().setScriptsDirectory("../assets/scripts");
+
+    root.addChild(moiras::mapFromModel("../assets/map.glb", true));
+    auto mapPtr = root.getChildOfType<Map>();
+    if (!mapPtr || mapPtr->model.meshCount == 0)
+    {
+      TraceLog(LOG_ERROR, "HEADLESS: Map has no geometry");
+      return;
+    }
+    mapPtr->buildNavMesh();
+    mapPtr->buildHeightfield();
+    Crowd::getInstance().init(&mapPtr->navMesh, mapPtr);
+    PathService::getInstance().init(&mapPtr->navMesh);
+
+    auto player = std::make_unique<Character>();
+    player->name = "Player";
+    player->tag = "player";
+    player->position = {0.0f, 10.0f, 0.0f};
+    player->scale = 0.05f;
+    player->snapToGround(*mapPtr);
+    registerObject(player->id, player.get());
+    Character *playerPtr = player.get();
+    root.addChild(std::move(player));
+    playerController = std::make_unique<CharacterController>(playerPtr, &mapPtr->navMesh, mapPtr);
+    playerController->setMovementSpeed(12.0f);
+
+    if (!mapPtr->navMeshBuilt)
+    {
+      TraceLog(LOG_WARNING, "HEADLESS: NavMesh not built, agents disabled");
+      return;
+    }
+
+    for (int i = 0; i < config.agentCount; i++)
+    {
+      Vector3 spawn;
+      if (!mapPtr->navMesh.findRandomPoint(spawn))
+        continue;
+
+      auto agent = std::make_unique<Character>();
+      agent->name = TextFormat("Agent %d", i);
+      agent->tag = "agent";
+      agent->position = spawn;
+      agent->scale = 0.05f;
+      registerObject(agent->id, agent.get());
+      auto controller = std::make_unique<CharacterController>(agent.get(), &mapPtr->navMesh, mapPtr);
+      controller->setMovementSpeed(12.0f);
+      m_agentControllers.push_back(std::move(controller));
+      root.addChild(std::move(agent));
+    }
+    TraceLog(LOG_INFO, "HEADLESS: Spawned %d agents",
+             (int)m_agentControllers.size());
+  }
+
+  void Game::runHeadless(const HeadlessConfig &config)
+  {
+    using Clock = std::chrono::steady_clock;
+
+    int maxFrames = config.maxFrames;
+    if (maxFrames <= 0 && config.maxSeconds <= 0.0f)
+    {
+      maxFrames = 600;
+      TraceLog(LOG_INFO, "HEADLESS: No limit given, running %d frames",
+               maxFrames);
+    }
+
+    Map *map = ObjectRegistry::getInstance().getFirst<Map>();
+    Profiler &profiler = Profiler::getInstance();
+    TimeManager &time = TimeManager::getInstance();
+    const float dt = config.fixedDeltaTime;
+
+    // I log per-path degli agenti dominerebbero l'output
+    SetTraceLogLevel(LOG_WARNING);
+
+    const Clock::time_point start = Clock::now();
+    double simulatedSeconds = 0.0;
+    double totalTickMs = 0.0;
+    double maxTickMs = 0.0;
+    int frames = 0;
+    int pathRequests = 0;
+
+    while ((maxFrames <= 0 || frames < maxFrames) &&
+           (config.maxSeconds <= 0.0f || simulatedSeconds < config.maxSeconds))
+    {
+      const Clock::time_point tickStart = Clock::now();
+      profiler.beginFrame();
+      {
+        PROFILE_SCOPE("Frame");
+        time.update(dt);
+
+        {
+          PROFILE_SCOPE("Update");
+          root.update();
+        }
+
+        m_frameCount++;
+        if (m_frameCount % 60 == 0)
+        {
+          ScriptEngine::instance().hotReload();
+        }
+        {
+          PROFILE_SCOPE("Scripts");
+          updateScriptsRecursive(&root, time.getGameDeltaTime());
+        }
+
+        {
+          PROFILE_SCOPE("Agents");
+          // Ogni agente fermo riparte verso un nuovo punto casuale
+          for (auto &controller : m_agentControllers)
+          {
+            Vector3 target;
+            if (!controller->isMoving() && map &&
+                map->navMesh.findRandomPoint(target))
+            {
+              controller->moveTo(target);
+              pathRequests++;
+            }
+            controller->updateMovement();
+          }
+          if (playerController)
+          {
+            playerController->updateMovement();
+          }
+          PathService::getInstance().update();
+          Crowd::getInstance().update(time.getGameDeltaTime());
+        }
+
+        {
+          PROFILE_SCOPE("Transforms");
+          // Dopo script e Crowd, che spostano gli agenti
+          m_spatialIndex.updateAll();
+          root.updateTransforms();
+        }
+      }
+
+      frames++;
+      simulatedSeconds += dt;
+      double tickMs = std::chrono::duration<double, std::milli>(Clock::now() - tickStart).count();
+      totalTickMs += tickMs;
+      maxTickMs = std::max(maxTickMs, tickMs);
+
+      // Passo fisso in tempo reale, altrimenti il piu' veloce possibile
+      if (config.tickRate > 0.0f)
+      {
+        std::this_thread::sleep_until(
+            start + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(frames / (double)config.tickRate)));
+      }
+    }
+
+    double wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    SetTraceLogLevel(LOG_INFO);
+    TraceLog(LOG_INFO,
+             "HEADLESS: %d frames, %.2f s simulated in %.2f s (%.1f ticks/s, %.1fx real time)",
+             frames, simulatedSeconds, wallSeconds,
+             wallSeconds > 0.0 ? frames / wallSeconds : 0.0,
+             wallSeconds > 0.0 ? simulatedSeconds / wallSeconds : 0.0);
+    TraceLog(LOG_INFO,
+             "HEADLESS: tick avg %.3f ms, max %.3f ms, %d agents, %d path requests",
+             frames > 0 ? totalTickMs / frames : 0.0, maxTickMs,
+             (int)m_agentControllers.size(), pathRequests);
+  }
+} // namespace moiras
@@ -1,7 +1,10 @@
 #include "game_object.h"
 #include "../scripting/ScriptComponent.hpp"
+#include "object_registry.h"
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <raymath.h>
 
 namespace moiras
 {
@@ -26,6 +29,7 @@ namespace moiras
         id(other.id),
         name(std::move(other.name)),
         tag(std::move(other.tag)),
+        typeMask(other.typeMask),
         isVisible(other.isVisible),
         position(other.position)
   {
@@ -39,6 +43,8 @@ namespace moiras
       }
     }
 
+    // Le liste per tipo puntano ora a questo oggetto
+    ObjectRegistry::getInstance().replace(&other, this);
     other.parent = nullptr;
   }
 
@@ -47,12 +53,14 @@ namespace moiras
   {
     if (this != &other)
     {
+      ObjectRegistry::getInstance().remove(this);
       m_scriptComponent = std::move(other.m_scriptComponent);
       children = std::move(other.children);
       parent = other.parent;
       id = other.id;
       name = std::move(other.name);
       tag = std::move(other.tag);
+      typeMask = other.typeMask;
       isVisible = other.isVisible;
       position = other.position;
 
@@ -63,12 +71,16 @@ namespace moiras
           child->parent = this;
         }
       }
+      ObjectRegistry::getInstance().replace(&other, this);
       other.parent = nullptr;
     }
     return *this;
   }
 
-  GameObject::~GameObject() = default;
+  GameObject::~GameObject()
+  {
+    ObjectRegistry::getInstance().remove(this);
+  }
 
   void GameObject::update()
   {
@@ -103,12 +115,76 @@ namespace moiras
     }
   }
 
+  GameObject::TransformKey GameObject::getTransformKey() const
+  {
+    return {position, {0.0f, 0.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 1.0f}};
+  }
+
+  Matrix GameObject::buildLocalMatrix() const
+  {
+    return MatrixTranslate(position.x, position.y, position.z);
+  }
+
+  void GameObject::updateTransforms(bool parentChanged)
+  {
+    TransformKey key = getTransformKey();
+    bool localChanged =
+        m_transformDirty || memcmp(&key, &m_transformKey, sizeof(key)) != 0;
+    if (localChanged)
+    {
+      m_transformKey = key;
+      m_localMatrix = buildLocalMatrix();
+    }
+
+    bool worldChanged = localChanged || parentChanged;
+    if (worldChanged)
+    {
+      m_worldMatrix = parent ? MatrixMultiply(m_localMatrix, parent->m_worldMatrix)
+                             : m_localMatrix;
+      m_transformDirty = false;
+    }
+
+    for (auto &child : children)
+    {
+      if (child)
+      {
+        child->updateTransforms(worldChanged);
+      }
+    }
+  }
+
+  const Matrix &GameObject::getLocalMatrix()
+  {
+    if (m_transformDirty)
+    {
+      m_localMatrix = buildLocalMatrix();
+    }
+    return m_localMatrix;
+  }
+
+  const Matrix &GameObject::getWorldMatrix()
+  {
+    // Oggetti aggiunti o marcati dopo l'ultimo updateTransforms(): calcolo
+    // immediato, ma il flag resta acceso cosi' il prossimo updateTransforms()
+    // propaga il cambiamento anche ai figli
+    if (m_transformDirty)
+    {
+      m_localMatrix = buildLocalMatrix();
+      m_worldMatrix = parent ? MatrixMultiply(m_localMatrix, parent->getWorldMatrix())
+                             : m_localMatrix;
+    }
+    return m_worldMatrix;
+  }
+
   void GameObject::addChild(std::unique_ptr<GameObject> child)
   {
     if (child)
     {
       child->parent = this; // AGGIUNTO: imposta il parent del child
+      child->markTransformDirty();
       std::cout << "Added child '" << child->name << "' to parent '" << this->name << "'\n";
+      // Entra (con i discendenti) nelle liste per tipo
+      ObjectRegistry::getInstance().addTree(child.get());
       children.push_back(std::move(child));
     }
   }
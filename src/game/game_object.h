@@ -2,6 +2,7 @@
 #include <memory>
 #include <raylib.h>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 using namespace std;
@@ -10,17 +11,53 @@ namespace moiras
 {
   class ScriptComponent;
 
+  // Tipi concreti riconosciuti dai sistemi senza RTTI. Ogni sottoclasse
+  // dichiara `static constexpr unsigned int TypeMask` e lo aggiunge a
+  // typeMask nel costruttore.
+  enum ObjectType : unsigned int
+  {
+    OBJECT_GENERIC = 0,
+    OBJECT_CHARACTER = 1u << 0,
+    OBJECT_STRUCTURE = 1u << 1,
+    OBJECT_LIGHT = 1u << 2,
+    OBJECT_CAMERA = 1u << 3,
+    OBJECT_MAP = 1u << 4,
+    OBJECT_ENVIRONMENT = 1u << 5,
+  };
+  constexpr int OBJECT_TYPE_COUNT = 6;
+
   class GameObject
   {
   private:
+    friend class ObjectRegistry;
     static unsigned int nextId;
     std::unique_ptr<ScriptComponent> m_scriptComponent;
+    // Posizione nelle liste di ObjectRegistry per ogni tipo (-1 = assente)
+    int m_registrySlots[OBJECT_TYPE_COUNT] = {-1, -1, -1, -1, -1, -1};
+
+  public:
+    // Input della matrice locale: se non cambiano tra un frame e l'altro la
+    // matrice non viene ricalcolata. rotation e' libera per la sottoclasse
+    // (quaternione, angoli di Eulero, ...).
+    struct TransformKey
+    {
+      Vector3 position;
+      Vector4 rotation;
+      Vector3 scale;
+    };
+
+  private:
+    TransformKey m_transformKey = {};
+    Matrix m_localMatrix = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    Matrix m_worldMatrix = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    bool m_transformDirty = true;
 
   public:
       vector<unique_ptr<GameObject>> children;
     unsigned int id;
     string name;
     string tag;
+    unsigned int typeMask = OBJECT_GENERIC;
     bool isVisible;
     Vector3 position;
     GameObject *parent; // CAMBIATO: raw pointer invece di unique_ptr
@@ -35,6 +72,17 @@ namespace moiras
     virtual void draw();
     virtual void gui();
 
+    // Transform: world = local * world del parent, in cache
+    virtual TransformKey getTransformKey() const;
+    virtual Matrix buildLocalMatrix() const;
+    // Ricalcola le matrici solo dove la key e' cambiata o e' cambiato un
+    // antenato. Chiamato una volta per frame sulla root prima del rendering.
+    void updateTransforms(bool parentChanged = false);
+    // Forza il ricalcolo (es. dopo modifiche non visibili nella key)
+    void markTransformDirty() { m_transformDirty = true; }
+    const Matrix &getLocalMatrix();
+    const Matrix &getWorldMatrix();
+
     void addChild(unique_ptr<GameObject> child);
     GameObject *getChild();
     GameObject *getChildByName(const string &name);
@@ -110,5 +158,24 @@ namespace moiras
     ScriptComponent *getScriptComponent() { return m_scriptComponent.get(); }
     const ScriptComponent *getScriptComponent() const { return m_scriptComponent.get(); }
   };
+
+  template <typename T>
+  constexpr unsigned int objectTypeMask()
+  {
+    if constexpr (std::is_same_v<T, GameObject>)
+      return OBJECT_GENERIC;
+    else
+      return T::TypeMask;
+  }
+
+  // static_cast verificato con typeMask (sostituisce dynamic_cast)
+  template <typename T>
+  T *objectCast(GameObject *object)
+  {
+    constexpr unsigned int mask = objectTypeMask<T>();
+    if (!object || (object->typeMask & mask) != mask)
+      return nullptr;
+    return static_cast<T *>(object);
+  }
   // Const version if needed
 } // namespace moiras
@@ -0,0 +1,75 @@
+#include "object_registry.h"
+#include "spatial_index.h"
+
+namespace moiras
+{
+
+  void ObjectRegistry::add(GameObject *object)
+  {
+    if (!object)
+      return;
+    for (int i = 0; i < OBJECT_TYPE_COUNT; i++)
+    {
+      if ((object->typeMask & (1u << i)) && object->m_registrySlots[i] < 0)
+      {
+        object->m_registrySlots[i] = (int)m_lists[i].size();
+        m_lists[i].push_back(object);
+        m_revisions[i]++;
+      }
+    }
+    if (m_spatialIndex)
+      m_spatialIndex->insert(object);
+  }
+
+  void ObjectRegistry::addTree(GameObject *object)
+  {
+    if (!object)
+      return;
+    add(object);
+    for (auto &child : object->children)
+    {
+      addTree(child.get());
+    }
+  }
+
+  void ObjectRegistry::remove(GameObject *object)
+  {
+    if (!object)
+      return;
+    if (m_spatialIndex)
+      m_spatialIndex->remove(object);
+    for (int i = 0; i < OBJECT_TYPE_COUNT; i++)
+    {
+      int slot = object->m_registrySlots[i];
+      if (slot < 0)
+        continue;
+
+      // Swap-remove: l'ultimo oggetto della lista prende lo slot liberato
+      auto &list = m_lists[i];
+      GameObject *last = list.back();
+      list[slot] = last;
+      last->m_registrySlots[i] = slot;
+      list.pop_back();
+      object->m_registrySlots[i] = -1;
+      m_revisions[i]++;
+    }
+  }
+
+  void ObjectRegistry::replace(GameObject *from, GameObject *to)
+  {
+    if (!from || !to || from == to)
+      return;
+    for (int i = 0; i < OBJECT_TYPE_COUNT; i++)
+    {
+      int slot = from->m_registrySlots[i];
+      if (slot < 0)
+        continue;
+      m_lists[i][slot] = to;
+      to->m_registrySlots[i] = slot;
+      from->m_registrySlots[i] = -1;
+    }
+    if (m_spatialIndex)
+      m_spatialIndex->replace(from, to);
+  }
+
+} // namespace moiras
@@ -0,0 +1,82 @@
+#pragma once
+#include "game_object.h"
+#include <bit>
+#include <vector>
+
+namespace moiras
+{
+  class SpatialIndex;
+
+  // Liste contigue di GameObject per tipo (vedi ObjectType). Gli oggetti
+  // entrano con addChild e escono nel distruttore di GameObject, cosi' i
+  // sistemi possono iterare i Character, le Structure, le luci ecc. senza
+  // visitare la scena ne' usare dynamic_cast. Gli stessi oggetti entrano ed
+  // escono dall'indice spaziale collegato con setSpatialIndex.
+  class ObjectRegistry
+  {
+  public:
+    static ObjectRegistry &getInstance()
+    {
+      static ObjectRegistry instance;
+      return instance;
+    }
+
+    ObjectRegistry(const ObjectRegistry &) = delete;
+    ObjectRegistry &operator=(const ObjectRegistry &) = delete;
+
+    // Registra object per ogni bit di typeMask (idempotente)
+    void add(GameObject *object);
+    // Registra object e tutti i suoi discendenti
+    void addTree(GameObject *object);
+    void remove(GameObject *object);
+    // Sposta le registrazioni di from su to (move di GameObject)
+    void replace(GameObject *from, GameObject *to);
+    // Indice che segue add/remove/replace (nullptr = nessuno)
+    void setSpatialIndex(SpatialIndex *index) { m_spatialIndex = index; }
+
+    const std::vector<GameObject *> &getObjects(unsigned int type) const
+    {
+      return m_lists[typeIndex(type)];
+    }
+
+    template <typename T>
+    size_t count() const
+    {
+      return m_lists[typeIndex(T::TypeMask)].size();
+    }
+
+    // Incrementata a ogni add/remove di un oggetto del tipo: chi tiene
+    // cache derivate dagli oggetti di un tipo la confronta fra un frame e
+    // l'altro
+    template <typename T>
+    unsigned int revision() const
+    {
+      return m_revisions[typeIndex(T::TypeMask)];
+    }
+
+    template <typename T>
+    T *getFirst() const
+    {
+      const auto &list = m_lists[typeIndex(T::TypeMask)];
+      return list.empty() ? nullptr : static_cast<T *>(list.front());
+    }
+
+    template <typename T, typename F>
+    void forEach(F &&fn) const
+    {
+      for (GameObject *object : m_lists[typeIndex(T::TypeMask)])
+      {
+        fn(static_cast<T *>(object));
+      }
+    }
+
+  private:
+    ObjectRegistry() = default;
+
+    std::vector<GameObject *> m_lists[OBJECT_TYPE_COUNT];
+    unsigned int m_revisions[OBJECT_TYPE_COUNT] = {};
+    SpatialIndex *m_spatialIndex = nullptr;
+
+    static int typeIndex(unsigned int type) { return std::countr_zero(type); }
+  };
+} // namespace moiras
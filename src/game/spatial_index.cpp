@@ -0,0 +1,316 @@
+#include "spatial_index.h"
+#include <algorithm>
+#include <cmath>
+#include <raymath.h>
+
+namespace moiras
+{
+
+  SpatialIndex::SpatialIndex(float cellSize)
+      : m_cellSize(cellSize > 0.0f ? cellSize : 16.0f),
+        m_invCellSize(1.0f / m_cellSize)
+  {
+  }
+
+  int SpatialIndex::cellCoord(float v) const
+  {
+    return (int)floorf(v * m_invCellSize);
+  }
+
+  long long SpatialIndex::cellKey(int cx, int cz)
+  {
+    return ((long long)cx << 32) | (unsigned int)cz;
+  }
+
+  void SpatialIndex::addToCell(int entryIdx)
+  {
+    Entry &e = m_entries[entryIdx];
+    auto &cell = m_cells[e.cell];
+    e.slot = (int)cell.size();
+    cell.push_back(entryIdx);
+  }
+
+  void SpatialIndex::removeFromCell(int entryIdx)
+  {
+    Entry &e = m_entries[entryIdx];
+    auto it = m_cells.find(e.cell);
+    if (it == m_cells.end())
+      return;
+
+    // Swap-remove: l'ultimo elemento della cella prende lo slot liberato
+    auto &cell = it->second;
+    int last = cell.back();
+    cell[e.slot] = last;
+    m_entries[last].slot = e.slot;
+    cell.pop_back();
+    if (cell.empty())
+    {
+      m_cells.erase(it);
+    }
+  }
+
+  void SpatialIndex::insert(GameObject *object)
+  {
+    if (!object)
+      return;
+    if (m_idToEntry.count(object->id))
+    {
+      update(object);
+      return;
+    }
+
+    Entry e;
+    e.object = object;
+    e.position = object->position;
+    e.cell = cellKey(cellCoord(e.position.x), cellCoord(e.position.z));
+    e.slot = -1;
+
+    int idx = (int)m_entries.size();
+    m_entries.push_back(e);
+    m_idToEntry[object->id] = idx;
+    addToCell(idx);
+  }
+
+  void SpatialIndex::remove(GameObject *object)
+  {
+    if (!object)
+      return;
+    auto it = m_idToEntry.find(object->id);
+    if (it != m_idToEntry.end() && m_entries[it->second].object == object)
+    {
+      remove(object->id);
+    }
+  }
+
+  void SpatialIndex::replace(GameObject *from, GameObject *to)
+  {
+    if (!from || !to)
+      return;
+    auto it = m_idToEntry.find(to->id);
+    if (it != m_idToEntry.end() && m_entries[it->second].object == from)
+    {
+      m_entries[it->second].object = to;
+    }
+  }
+
+  void SpatialIndex::remove(unsigned int id)
+  {
+    auto it = m_idToEntry.find(id);
+    if (it == m_idToEntry.end())
+      return;
+
+    int idx = it->second;
+    removeFromCell(idx);
+    m_idToEntry.erase(it);
+
+    // Swap-remove dell'entry, aggiornando i riferimenti di quella spostata
+    int last = (int)m_entries.size() - 1;
+    if (idx != last)
+    {
+      m_entries[idx] = m_entries[last];
+      Entry &moved = m_entries[idx];
+      m_idToEntry[moved.object->id] = idx;
+      m_cells[moved.cell][moved.slot] = idx;
+    }
+    m_entries.pop_back();
+  }
+
+  void SpatialIndex::update(GameObject *object)
+  {
+    if (!object)
+      return;
+    auto it = m_idToEntry.find(object->id);
+    if (it == m_idToEntry.end())
+      return;
+
+    int idx = it->second;
+    Entry &e = m_entries[idx];
+    e.position = object->position;
+    long long cell = cellKey(cellCoord(e.position.x), cellCoord(e.position.z));
+    if (cell != e.cell)
+    {
+      removeFromCell(idx);
+      e.cell = cell;
+      addToCell(idx);
+    }
+  }
+
+  void SpatialIndex::updateAll()
+  {
+    for (int i = 0; i < (int)m_entries.size(); i++)
+    {
+      Entry &e = m_entries[i];
+      e.position = e.object->position;
+      long long cell = cellKey(cellCoord(e.position.x), cellCoord(e.position.z));
+      if (cell != e.cell)
+      {
+        removeFromCell(i);
+        e.cell = cell;
+        addToCell(i);
+      }
+    }
+  }
+
+  void SpatialIndex::clear()
+  {
+    m_entries.clear();
+    m_idToEntry.clear();
+    m_cells.clear();
+  }
+
+  void SpatialIndex::queryRadius(Vector3 center, float radius,
+                                 unsigned int typeMask,
+                                 std::vector<GameObject *> &out) const
+  {
+    const float r2 = radius * radius;
+    auto test = [&](int idx)
+    {
+      const Entry &e = m_entries[idx];
+      if (Vector3DistanceSqr(e.position, center) <= r2 &&
+          matches(e.object, typeMask))
+      {
+        out.push_back(e.object);
+      }
+    };
+
+    int cx0 = cellCoord(center.x - radius), cx1 = cellCoord(center.x + radius);
+    int cz0 = cellCoord(center.z - radius), cz1 = cellCoord(center.z + radius);
+
+    // Raggi molto grandi: piu' economico scorrere le celle occupate
+    long long span = (long long)(cx1 - cx0 + 1) * (cz1 - cz0 + 1);
+    if (span > (long long)m_cells.size())
+    {
+      for (int i = 0; i < (int)m_entries.size(); i++)
+        test(i);
+      return;
+    }
+
+    for (int cz = cz0; cz <= cz1; cz++)
+    {
+      for (int cx = cx0; cx <= cx1; cx++)
+      {
+        auto it = m_cells.find(cellKey(cx, cz));
+        if (it == m_cells.end())
+          continue;
+        for (int idx : it->second)
+          test(idx);
+      }
+    }
+  }
+
+  void SpatialIndex::queryAABB(BoundingBox box, unsigned int typeMask,
+                               std::vector<GameObject *> &out) const
+  {
+    auto test = [&](int idx)
+    {
+      const Entry &e = m_entries[idx];
+      const Vector3 &p = e.position;
+      if (p.x >= box.min.x && p.x <= box.max.x && p.y >= box.min.y &&
+          p.y <= box.max.y && p.z >= box.min.z && p.z <= box.max.z &&
+          matches(e.object, typeMask))
+      {
+        out.push_back(e.object);
+      }
+    };
+
+    int cx0 = cellCoord(box.min.x), cx1 = cellCoord(box.max.x);
+    int cz0 = cellCoord(box.min.z), cz1 = cellCoord(box.max.z);
+
+    long long span = (long long)(cx1 - cx0 + 1) * (cz1 - cz0 + 1);
+    if (span > (long long)m_cells.size())
+    {
+      for (int i = 0; i < (int)m_entries.size(); i++)
+        test(i);
+      return;
+    }
+
+    for (int cz = cz0; cz <= cz1; cz++)
+    {
+      for (int cx = cx0; cx <= cx1; cx++)
+      {
+        auto it = m_cells.find(cellKey(cx, cz));
+        if (it == m_cells.end())
+          continue;
+        for (int idx : it->second)
+          test(idx);
+      }
+    }
+  }
+
+  void SpatialIndex::queryNearest(Vector3 center, int k, unsigned int typeMask,
+                                  std::vector<GameObject *> &out,
+                                  float maxRadius) const
+  {
+    if (k <= 0 || m_entries.empty())
+      return;
+
+    const float maxR2 = maxRadius < FLT_MAX ? maxRadius * maxRadius : FLT_MAX;
+
+    // Max-heap dei migliori k candidati (distanza^2, indice entry)
+    std::vector<std::pair<float, int>> heap;
+    heap.reserve(k + 1);
+    auto consider = [&](int idx)
+    {
+      const Entry &e = m_entries[idx];
+      float d2 = Vector3DistanceSqr(e.position, center);
+      if (d2 > maxR2 || !matches(e.object, typeMask))
+        return;
+      if ((int)heap.size() < k)
+      {
+        heap.push_back({d2, idx});
+        std::push_heap(heap.begin(), heap.end());
+      }
+      else if (d2 < heap.front().first)
+      {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = {d2, idx};
+        std::push_heap(heap.begin(), heap.end());
+      }
+    };
+
+    const int ccx = cellCoord(center.x);
+    const int ccz = cellCoord(center.z);
+
+    // Anelli di celle attorno a quella del centro. Dopo l'anello r, ogni cella
+    // non visitata dista almeno r * cellSize sul piano XZ.
+    for (int r = 0;; r++)
+    {
+      if (8LL * r > (long long)m_cells.size())
+      {
+        // Anelli piu' grandi delle celle occupate: scansione completa
+        heap.clear();
+        for (int i = 0; i < (int)m_entries.size(); i++)
+          consider(i);
+        break;
+      }
+
+      for (int cz = ccz - r; cz <= ccz + r; cz++)
+      {
+        for (int cx = ccx - r; cx <= ccx + r; cx++)
+        {
+          if (r > 0 && cz != ccz - r && cz != ccz + r && cx != ccx - r &&
+              cx != ccx + r)
+            continue; // Interno dell'anello, gia' visitato
+          auto it = m_cells.find(cellKey(cx, cz));
+          if (it == m_cells.end())
+            continue;
+          for (int idx : it->second)
+            consider(idx);
+        }
+      }
+
+      float ringDist = r * m_cellSize;
+      if (ringDist * ringDist > maxR2)
+        break;
+      if ((int)heap.size() == k && heap.front().first <= ringDist * ringDist)
+        break;
+    }
+
+    std::sort_heap(heap.begin(), heap.end());
+    for (const auto &[d2, idx] : heap)
+    {
+      out.push_back(m_entries[idx].object);
+    }
+  }
+
+} // namespace moiras
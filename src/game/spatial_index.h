@@ -0,0 +1,69 @@
+#pragma once
+#include "game_object.h"
+#include <cfloat>
+#include <raylib.h>
+#include <unordered_map>
+#include <vector>
+
+namespace moiras
+{
+  // Griglia uniforme sparsa (hash di celle XZ) sulle posizioni dei
+  // GameObject nella scena (alimentata da ObjectRegistry). Gli oggetti vengono spostati di cella solo quando
+  // la cella cambia, quindi updateAll() a ogni frame costa O(n) letture.
+  // Le query filtrano per typeMask (vedi ObjectType) senza dynamic_cast.
+  class SpatialIndex
+  {
+  public:
+    explicit SpatialIndex(float cellSize = 16.0f);
+
+    void insert(GameObject *object);
+    // Solo se l'entry e' proprio object: un oggetto spostato (move) con lo
+    // stesso id resta indicizzato
+    void remove(GameObject *object);
+    void remove(unsigned int id);
+    // L'oggetto e' stato spostato in memoria (move di GameObject)
+    void replace(GameObject *from, GameObject *to);
+    // Rilegge la posizione di un oggetto / di tutti gli oggetti indicizzati
+    void update(GameObject *object);
+    void updateAll();
+    void clear();
+
+    // Oggetti entro radius da center (distanza euclidea 3D)
+    void queryRadius(Vector3 center, float radius, unsigned int typeMask,
+                     std::vector<GameObject *> &out) const;
+    // Oggetti con posizione dentro box
+    void queryAABB(BoundingBox box, unsigned int typeMask,
+                   std::vector<GameObject *> &out) const;
+    // I k oggetti piu' vicini a center entro maxRadius, ordinati per distanza
+    void queryNearest(Vector3 center, int k, unsigned int typeMask,
+                      std::vector<GameObject *> &out,
+                      float maxRadius = FLT_MAX) const;
+
+    size_t size() const { return m_entries.size(); }
+    float getCellSize() const { return m_cellSize; }
+
+  private:
+    struct Entry
+    {
+      GameObject *object;
+      Vector3 position;
+      long long cell;
+      int slot; // indice dentro m_cells[cell]
+    };
+
+    float m_cellSize;
+    float m_invCellSize;
+    std::vector<Entry> m_entries;
+    std::unordered_map<unsigned int, int> m_idToEntry;
+    std::unordered_map<long long, std::vector<int>> m_cells;
+
+    int cellCoord(float v) const;
+    static long long cellKey(int cx, int cz);
+    void addToCell(int entryIdx);
+    void removeFromCell(int entryIdx);
+    static bool matches(const GameObject *object, unsigned int typeMask)
+    {
+      return (object->typeMask & typeMask) == typeMask;
+    }
+  };
+} // namespace moiras
@@ -356,7 +356,7 @@ public:
             // Find the Map in the scene
             auto map = root->getChildOfType<Map>();
             if (map) {
-                character->snapToGround(map->model);
+                character->snapToGround(*map);
             }
 
             // Add to scene
@@ -1,8 +1,12 @@
 // filepicker.cpp
 #include "sidebar.h"
 #include "../building/structure_builder.h"
+#include "../camera/occlusion.h"
 #include "../map/environment.hpp"
+#include "../navigation/crowd.h"
+#include "../navigation/path_service.h"
 #include "../time/time_manager.h"
+#include "../profiler/profiler.h"
 #include "script_editor.h"
 #include "../../rlImGui/rlImGui.h"
 #include <filesystem>
@@ -103,6 +107,12 @@ namespace moiras
                     EndTabItem();
                 }
 
+                if (BeginTabItem("Profiler"))
+                {
+                    drawProfilerTab();
+                    EndTabItem();
+                }
+
                 EndTabBar();
             }
 
@@ -468,7 +478,7 @@ namespace moiras
                     auto &p = environmentObject->getPatch(i);
                     bool isActive = (i == environmentObject->getActivePatch());
                     if (isActive) PushStyleColor(ImGuiCol_Text, ImVec4(0.3f, 1.0f, 0.3f, 1.0f));
-                    Text("  [%d] %s: %d", i, patchDisplayName(p), (int)p.transforms.size());
+                    Text("  [%d] %s: %d", i, patchDisplayName(p), p.instanceCount);
                     if (isActive) PopStyleColor();
                     // Allow clicking a patch to set it active
                     if (IsItemHovered() && IsMouseClicked(0)) {
@@ -555,6 +565,14 @@ namespace moiras
                     environmentObject->scanModelFiles();
                 }
 
+                Spacing();
+                Separator();
+                Text("Scatter Rules");
+                ScatterRules &rules = environmentObject->getScatterRules();
+                SliderFloat("Min Spacing", &rules.minSpacing, 0.0f, 10.0f, "%.1f");
+                SliderFloat("Max Slope", &rules.maxSlope, 0.0f, 90.0f, "%.0f deg");
+                DragFloatRange2("Height Range", &rules.minHeight, &rules.maxHeight,
+                                0.5f, -100.0f, 1000.0f, "Min: %.1f", "Max: %.1f");
                 Spacing();
                 Separator();
                 Text("Brush Tool");
@@ -613,6 +631,21 @@ namespace moiras
             }
         }
 
+        if (CollapsingHeader("Occlusion Culling"))
+        {
+            OcclusionCuller::getInstance().gui();
+        }
+
+        if (CollapsingHeader("Crowd"))
+        {
+            Crowd::getInstance().gui();
+        }
+
+        if (CollapsingHeader("Path Requests"))
+        {
+            PathService::getInstance().gui();
+        }
+
         if (CollapsingHeader("Model Cache"))
         {
             if (modelManager)
@@ -626,6 +659,11 @@ namespace moiras
         }
     }
 
+    void Sidebar::drawProfilerTab()
+    {
+        Profiler::getInstance().gui();
+    }
+
     void Sidebar::drawGameObjectTree(GameObject *obj)
     {
         if (!obj)
@@ -50,6 +50,7 @@ namespace moiras
         void drawBuildingTab();
         void drawScriptingTab();
         void drawSettingsTab();
+        void drawProfilerTab();
         void drawGameObjectTree(GameObject *obj);
     };
 
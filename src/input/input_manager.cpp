@@ -122,6 +122,7 @@ bool InputManager::isActionAvailable(InputAction action) const {
         case InputAction::UI_SPEED_NORMAL:
         case InputAction::UI_SPEED_MEDIUM:
         case InputAction::UI_SPEED_FAST:
+        case InputAction::UI_DUMP_PROFILE:
         case InputAction::UI_CONFIRM:
         case InputAction::UI_CANCEL:
             return true;
@@ -136,6 +137,7 @@ bool InputManager::isActionBlockedByUI(InputAction action) const {
     if (action == InputAction::UI_SPEED_NORMAL) return false;
     if (action == InputAction::UI_SPEED_MEDIUM) return false;
     if (action == InputAction::UI_SPEED_FAST) return false;
+    if (action == InputAction::UI_DUMP_PROFILE) return false;
     if (action == InputAction::UI_CONFIRM) return false;
     if (action == InputAction::UI_CANCEL) return false;
     
@@ -177,6 +179,7 @@ bool InputManager::isKeyboardAction(InputAction action) const {
         case InputAction::UI_SPEED_NORMAL:
         case InputAction::UI_SPEED_MEDIUM:
         case InputAction::UI_SPEED_FAST:
+        case InputAction::UI_DUMP_PROFILE:
         case InputAction::UI_CONFIRM:
         case InputAction::UI_CANCEL:
             return true;
@@ -242,6 +245,8 @@ bool InputManager::getRawActionState(InputAction action) const {
             return IsKeyDown(KEY_TWO);
         case InputAction::UI_SPEED_FAST:
             return IsKeyDown(KEY_THREE);
+        case InputAction::UI_DUMP_PROFILE:
+            return IsKeyDown(KEY_F11);
         case InputAction::UI_CONFIRM:
             return IsKeyDown(KEY_ENTER);
         case InputAction::UI_CANCEL:
@@ -309,6 +314,8 @@ bool InputManager::getRawActionJustPressed(InputAction action) const {
             return IsKeyPressed(KEY_TWO);
         case InputAction::UI_SPEED_FAST:
             return IsKeyPressed(KEY_THREE);
+        case InputAction::UI_DUMP_PROFILE:
+            return IsKeyPressed(KEY_F11);
         case InputAction::UI_CONFIRM:
             return IsKeyPressed(KEY_ENTER);
         case InputAction::UI_CANCEL:
@@ -376,6 +383,8 @@ bool InputManager::getRawActionJustReleased(InputAction action) const {
             return IsKeyReleased(KEY_TWO);
         case InputAction::UI_SPEED_FAST:
             return IsKeyReleased(KEY_THREE);
+        case InputAction::UI_DUMP_PROFILE:
+            return IsKeyReleased(KEY_F11);
         case InputAction::UI_CONFIRM:
             return IsKeyReleased(KEY_ENTER);
         case InputAction::UI_CANCEL:
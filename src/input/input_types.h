@@ -36,6 +36,7 @@ enum class InputAction {
     UI_SPEED_NORMAL,      // 1 - set speed to 1x
     UI_SPEED_MEDIUM,      // 2 - set speed to 2.5x
     UI_SPEED_FAST,        // 3 - set speed to 5x
+    UI_DUMP_PROFILE,      // F11 - dump profiler frames to Chrome trace
     UI_CONFIRM,
     UI_CANCEL
 };
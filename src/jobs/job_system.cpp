@@ -0,0 +1,203 @@
+#include "job_system.h"
+#include "../profiler/profiler.h"
+#include <cstdio>
+#include <raylib.h>
+
+namespace moiras
+{
+  // Indice della deque del thread corrente: 0 per il main thread (e per
+  // qualsiasi thread esterno), 1..N per i worker
+  static thread_local int t_queueIndex = 0;
+
+  JobSystem::~JobSystem() { shutdown(); }
+
+  void JobSystem::init(int workerCount)
+  {
+    if (isInitialized())
+      return;
+
+    if (workerCount <= 0)
+    {
+      int hw = (int)std::thread::hardware_concurrency();
+      workerCount = std::max(0, hw - 1);
+    }
+
+    m_queues.reserve(workerCount + 1);
+    for (int i = 0; i <= workerCount; i++)
+    {
+      m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    // Il chiamante (main thread) prende il buffer 0 del profiler prima che
+    // i worker registrino i propri
+    Profiler::getInstance().setThreadName("Main");
+
+    m_running = true;
+    m_workers.reserve(workerCount);
+    for (int i = 1; i <= workerCount; i++)
+    {
+      m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+
+    TraceLog(LOG_INFO, "JobSystem: Started %d worker threads", workerCount);
+  }
+
+  void JobSystem::shutdown()
+  {
+    if (!isInitialized())
+      return;
+
+    {
+      std::lock_guard<std::mutex> lock(m_wakeMutex);
+      m_running = false;
+    }
+    m_wakeCondition.notify_all();
+    for (auto &worker : m_workers)
+    {
+      worker.join();
+    }
+    m_workers.clear();
+    m_queues.clear();
+    m_queuedJobs = 0;
+  }
+
+  JobHandle JobSystem::createJob(std::function<void()> function)
+  {
+    auto job = std::make_shared<Job>();
+    job->function = std::move(function);
+    return job;
+  }
+
+  JobHandle JobSystem::createChildJob(const JobHandle &parent,
+                                      std::function<void()> function)
+  {
+    auto job = createJob(std::move(function));
+    if (parent)
+    {
+      parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+      job->parent = parent;
+    }
+    return job;
+  }
+
+  int JobSystem::queueIndex() const
+  {
+    return t_queueIndex < (int)m_queues.size() ? t_queueIndex : 0;
+  }
+
+  void JobSystem::run(const JobHandle &job)
+  {
+    if (!isInitialized())
+    {
+      // Senza worker il job viene eseguito subito sul chiamante
+      execute(job);
+      return;
+    }
+
+    WorkQueue &queue = *m_queues[queueIndex()];
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.jobs.push_back(job);
+    }
+
+    m_queuedJobs.fetch_add(1, std::memory_order_release);
+    {
+      // Il lock evita che un worker perda la notifica tra il controllo di
+      // m_queuedJobs e la wait
+      std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wakeCondition.notify_one();
+  }
+
+  JobHandle JobSystem::pop(int index)
+  {
+    WorkQueue &queue = *m_queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty())
+      return nullptr;
+    JobHandle job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    return job;
+  }
+
+  JobHandle JobSystem::steal(int thief)
+  {
+    const int count = (int)m_queues.size();
+    for (int i = 1; i < count; i++)
+    {
+      WorkQueue &queue = *m_queues[(thief + i) % count];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.jobs.empty())
+        continue;
+      JobHandle job = std::move(queue.jobs.front());
+      queue.jobs.pop_front();
+      return job;
+    }
+    return nullptr;
+  }
+
+  JobHandle JobSystem::getJob(int index)
+  {
+    JobHandle job = pop(index);
+    if (!job)
+      job = steal(index);
+    if (job)
+      m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+  }
+
+  void JobSystem::execute(const JobHandle &job)
+  {
+    if (job->function)
+      job->function();
+    finish(job);
+  }
+
+  void JobSystem::finish(const JobHandle &job)
+  {
+    if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1 &&
+        job->parent)
+    {
+      finish(job->parent);
+    }
+  }
+
+  void JobSystem::wait(const JobHandle &job)
+  {
+    if (!isInitialized())
+      return;
+
+    const int index = queueIndex();
+    while (!isFinished(job))
+    {
+      if (JobHandle next = getJob(index))
+        execute(next);
+      else
+        std::this_thread::yield();
+    }
+  }
+
+  void JobSystem::workerLoop(int index)
+  {
+    t_queueIndex = index;
+    // Non TextFormat: il suo buffer statico non e' thread-safe
+    char name[32];
+    snprintf(name, sizeof(name), "Worker %d", index);
+    Profiler::getInstance().setThreadName(name);
+    while (true)
+    {
+      if (JobHandle job = getJob(index))
+      {
+        execute(job);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(m_wakeMutex);
+      m_wakeCondition.wait(lock, [this]()
+                           { return !m_running ||
+                                    m_queuedJobs.load(std::memory_order_acquire) > 0; });
+      if (!m_running)
+        break;
+    }
+  }
+} // namespace moiras
@@ -0,0 +1,118 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace moiras
+{
+  // Un job e' completo quando la sua funzione e' stata eseguita e tutti i
+  // figli creati con createChildJob sono completi.
+  struct Job
+  {
+    std::function<void()> function;
+    std::shared_ptr<Job> parent;
+    // 1 per la funzione del job + 1 per ogni figlio non ancora completo
+    std::atomic<int> unfinished{1};
+  };
+
+  using JobHandle = std::shared_ptr<Job>;
+
+  // Job system work-stealing: ogni thread (main = 0, worker = 1..N) ha la sua
+  // deque. Il proprietario inserisce e preleva in coda (LIFO, cache calda),
+  // gli altri rubano dalla testa (FIFO, job piu' grossi). wait() esegue altri
+  // job mentre aspetta, quindi si puo' chiamare anche da dentro un job.
+  class JobSystem
+  {
+  public:
+    static JobSystem &getInstance()
+    {
+      static JobSystem instance;
+      return instance;
+    }
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // workerCount <= 0: hardware_concurrency - 1 (il main thread lavora in wait)
+    void init(int workerCount = 0);
+    void shutdown();
+    bool isInitialized() const { return !m_queues.empty(); }
+    int getWorkerCount() const { return (int)m_workers.size(); }
+    // Thread che possono eseguire job in parallelo (worker + chiamante)
+    int getConcurrency() const { return getWorkerCount() + 1; }
+
+    JobHandle createJob(std::function<void()> function);
+    // Il parent non si completa finche' il figlio non e' completo. Va creato
+    // prima di run(parent) o da dentro la funzione del parent.
+    JobHandle createChildJob(const JobHandle &parent,
+                             std::function<void()> function);
+    void run(const JobHandle &job);
+    // Blocca finche' job non e' completo, eseguendo altri job nel frattempo
+    void wait(const JobHandle &job);
+    static bool isFinished(const JobHandle &job)
+    {
+      return job->unfinished.load(std::memory_order_acquire) == 0;
+    }
+
+    // Chiama fn(begin, end) su intervalli di al piu' grain elementi di
+    // [0, count), in parallelo, e ritorna quando sono tutti completi.
+    // grain <= 0 sceglie circa 4 intervalli per thread.
+    template <typename F>
+    void parallel_for(int count, int grain, F &&fn)
+    {
+      if (count <= 0)
+        return;
+      if (grain <= 0)
+        grain = std::max(1, count / (getConcurrency() * 4));
+      if (!isInitialized() || m_workers.empty() || count <= grain)
+      {
+        for (int begin = 0; begin < count; begin += grain)
+          fn(begin, std::min(begin + grain, count));
+        return;
+      }
+
+      JobHandle root = createJob(nullptr);
+      for (int begin = 0; begin < count; begin += grain)
+      {
+        int end = std::min(begin + grain, count);
+        run(createChildJob(root, [&fn, begin, end]()
+                           { fn(begin, end); }));
+      }
+      run(root);
+      wait(root);
+    }
+
+  private:
+    JobSystem() = default;
+    ~JobSystem();
+
+    struct WorkQueue
+    {
+      std::mutex mutex;
+      std::deque<JobHandle> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<bool> m_running{false};
+
+    // Risveglio dei worker inattivi
+    std::atomic<int> m_queuedJobs{0};
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCondition;
+
+    int queueIndex() const;
+    JobHandle pop(int index);
+    JobHandle steal(int thief);
+    JobHandle getJob(int index);
+    void execute(const JobHandle &job);
+    void finish(const JobHandle &job);
+    void workerLoop(int index);
+  };
+} // namespace moiras
@@ -0,0 +1,51 @@
+#include "jolt_job_system.h"
+#include "job_system.h"
+
+namespace moiras
+{
+  JoltJobSystem::JoltJobSystem(JobSystem &jobs, JPH::uint maxBarriers)
+      : JPH::JobSystemWithBarrier(maxBarriers), m_jobs(jobs)
+  {
+  }
+
+  int JoltJobSystem::GetMaxConcurrency() const
+  {
+    return m_jobs.getConcurrency();
+  }
+
+  JPH::JobHandle JoltJobSystem::CreateJob(const char *inName,
+                                          JPH::ColorArg inColor,
+                                          const JobFunction &inJobFunction,
+                                          JPH::uint32 inNumDependencies)
+  {
+    // Il job si libera da solo (FreeJob) quando l'ultimo riferimento cade
+    Job *job = new Job(inName, inColor, this, inJobFunction, inNumDependencies);
+    JobHandle handle(job);
+
+    // Con dipendenze, Jolt chiama QueueJob quando l'ultima si risolve
+    if (inNumDependencies == 0)
+      QueueJob(job);
+    return handle;
+  }
+
+  void JoltJobSystem::QueueJob(Job *inJob)
+  {
+    // Il riferimento tiene vivo il job finche' un worker non lo esegue
+    inJob->AddRef();
+    m_jobs.run(m_jobs.createJob([inJob]()
+                                {
+                                  inJob->Execute();
+                                  inJob->Release();
+                                }));
+  }
+
+  void JoltJobSystem::QueueJobs(Job **inJobs, JPH::uint inNumJobs)
+  {
+    for (JPH::uint i = 0; i < inNumJobs; i++)
+    {
+      QueueJob(inJobs[i]);
+    }
+  }
+
+  void JoltJobSystem::FreeJob(Job *inJob) { delete inJob; }
+} // namespace moiras
@@ -0,0 +1,32 @@
+#pragma once
+// Jolt.h deve precedere qualsiasi altro header di Jolt
+#include <Jolt/Jolt.h>
+#include <Jolt/Core/JobSystemWithBarrier.h>
+
+namespace moiras
+{
+  class JobSystem;
+
+  // Implementa JPH::JobSystem sopra i worker di moiras::JobSystem, cosi' la
+  // fisica non crea un proprio thread pool. Le barriere e le dipendenze fra
+  // job di Jolt sono gestite da JobSystemWithBarrier e da JPH::JobSystem::Job:
+  // qui si accodano solo i job pronti.
+  class JoltJobSystem final : public JPH::JobSystemWithBarrier
+  {
+  public:
+    explicit JoltJobSystem(JobSystem &jobs, JPH::uint maxBarriers = 8);
+
+    int GetMaxConcurrency() const override;
+    JobHandle CreateJob(const char *inName, JPH::ColorArg inColor,
+                        const JobFunction &inJobFunction,
+                        JPH::uint32 inNumDependencies = 0) override;
+
+  protected:
+    void QueueJob(Job *inJob) override;
+    void QueueJobs(Job **inJobs, JPH::uint inNumJobs) override;
+    void FreeJob(Job *inJob) override;
+
+  private:
+    JobSystem &m_jobs;
+  };
+} // namespace moiras
@@ -1,15 +1,42 @@
 #include "lightmanager.h"
 #include "imgui.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <raylib.h>
 
 namespace moiras {
 
+// GL_DEPTH_BUFFER_BIT per rlBlitFramebuffer
+static const int DEPTH_BUFFER_BIT = 0x00000100;
+
+// FBO con sola texture di profondita' SHADOW_ATLAS_SIZE^2
+static bool createDepthAtlas(unsigned int &fbo, unsigned int &depthTex) {
+    fbo = rlLoadFramebuffer();
+    if (fbo == 0) return false;
+
+    rlEnableFramebuffer(fbo);
+    depthTex = rlLoadTextureDepth(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, false);
+    rlFramebufferAttach(fbo, depthTex, RL_ATTACHMENT_DEPTH,
+                        RL_ATTACHMENT_TEXTURE2D, 0);
+
+    bool complete = rlFramebufferComplete(fbo);
+    rlDisableFramebuffer();
+    if (!complete) {
+        rlUnloadFramebuffer(fbo);
+        rlUnloadTexture(depthTex);
+        fbo = 0;
+        depthTex = 0;
+    }
+    return complete;
+}
+
 LightManager::LightManager() {
     for (int i = 0; i < MAX_LIGHTS; i++) {
         lights[i] = nullptr;
     }
+    rebuildShadowSchedule();
 }
 
 void LightManager::loadShader(const std::string &vsPath,
@@ -65,7 +92,8 @@ void LightManager::loadShader(const std::string &vsPath,
 }
 
 void LightManager::setupShadowMap(const std::string &depthVsPath,
-                                   const std::string &depthFsPath) {
+                                   const std::string &depthFsPath,
+                                   const std::string &instancedDepthVsPath) {
     // Load depth shader
     shadowDepthShader = LoadShader(depthVsPath.c_str(), depthFsPath.c_str());
     if (shadowDepthShader.id == 0) {
@@ -77,26 +105,30 @@ void LightManager::setupShadowMap(const std::string &depthVsPath,
     shadowMaterial = LoadMaterialDefault();
     shadowMaterial.shader = shadowDepthShader;
 
-    // Create shadow atlas FBO (SHADOW_ATLAS_SIZE x SHADOW_ATLAS_SIZE)
-    shadowMapFBO = rlLoadFramebuffer();
-    if (shadowMapFBO == 0) {
-        TraceLog(LOG_ERROR, "LightManager: Failed to create shadow FBO!");
-        return;
+    // Instanced variant: same fragment shader, per-instance transform
+    // reconstructed from the packed rock instance attributes
+    if (!instancedDepthVsPath.empty()) {
+        shadowDepthInstancedShader = LoadShader(instancedDepthVsPath.c_str(), depthFsPath.c_str());
+        if (shadowDepthInstancedShader.id > 0) {
+            shadowDepthInstancedShader.locs[SHADER_LOC_MATRIX_MVP] =
+                GetShaderLocation(shadowDepthInstancedShader, "mvp");
+            shadowInstancedMaterial = LoadMaterialDefault();
+            shadowInstancedMaterial.shader = shadowDepthInstancedShader;
+        } else {
+            TraceLog(LOG_WARNING, "LightManager: Failed to load instanced shadow depth shader");
+        }
     }
 
-    // Create depth texture atlas
-    rlEnableFramebuffer(shadowMapFBO);
-    shadowMapDepthTex = rlLoadTextureDepth(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, false);
-    rlFramebufferAttach(shadowMapFBO, shadowMapDepthTex, RL_ATTACHMENT_DEPTH,
-                        RL_ATTACHMENT_TEXTURE2D, 0);
-
-    if (!rlFramebufferComplete(shadowMapFBO)) {
+    // Create shadow atlas FBO (SHADOW_ATLAS_SIZE x SHADOW_ATLAS_SIZE)
+    if (!createDepthAtlas(shadowMapFBO, shadowMapDepthTex)) {
         TraceLog(LOG_ERROR, "LightManager: Shadow FBO is not complete!");
-        rlUnloadFramebuffer(shadowMapFBO);
-        shadowMapFBO = 0;
         return;
     }
-    rlDisableFramebuffer();
+
+    // Atlas dei caster statici, copiato nell'atlas principale a ogni update
+    if (!createDepthAtlas(staticShadowFBO, staticShadowDepthTex)) {
+        TraceLog(LOG_WARNING, "LightManager: Static shadow cache unavailable");
+    }
 
     // LINEAR filtering enables hardware interpolation for smoother PCF
     rlTextureParameters(shadowMapDepthTex, RL_TEXTURE_MIN_FILTER, RL_TEXTURE_FILTER_LINEAR);
@@ -105,6 +137,7 @@ void LightManager::setupShadowMap(const std::string &depthVsPath,
     rlTextureParameters(shadowMapDepthTex, RL_TEXTURE_WRAP_T, RL_TEXTURE_WRAP_CLAMP);
 
     shadowMapReady = true;
+    invalidateShadowCascades();
 
     // Bind shadow map sampler to all already-registered shadow shaders
     for (int i = 0; i < shadowShaderCount; i++) {
@@ -120,8 +153,9 @@ void LightManager::setupShadowMap(const std::string &depthVsPath,
     // Push initial shadow state
     updateShadowUniforms();
 
-    TraceLog(LOG_INFO, "LightManager: Shadow atlas initialized (%dx%d, %d cascades, FBO: %u, Depth: %u)",
-             SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, NUM_CASCADES, shadowMapFBO, shadowMapDepthTex);
+    TraceLog(LOG_INFO, "LightManager: Shadow atlas initialized (%dx%d, %d cascades, FBO: %u, Depth: %u, static cache FBO: %u)",
+             SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, NUM_CASCADES, shadowMapFBO, shadowMapDepthTex,
+             staticShadowFBO);
 }
 
 void LightManager::updateCascadeMatrices(const Camera3D &camera, float cameraNear, float screenAspect) {
@@ -211,6 +245,22 @@ void LightManager::updateCascadeMatrices(const Camera3D &camera, float cameraNea
         // Round up radius to reduce jitter
         radius = ceilf(radius * 16.0f) / 16.0f;
 
+        // Con la cache statica il volume e' piu' largo della fetta e resta
+        // ancorato (stessa matrice, cache valida) finche' la fetta ci sta dentro
+        bool cached = isStaticCacheActive();
+        float sliceRadius = radius;
+        if (cached) {
+            radius = ceilf(radius * (1.0f + staticShadowMargin) * 16.0f) / 16.0f;
+        }
+        CascadeAnchor &anchor = cascadeAnchors[c];
+        if (cached && anchor.valid && anchor.extent == radius &&
+            Vector3DotProduct(anchor.lightDir, lightDir) > 0.99999f) {
+            // Il centro sta a distanza 2 * radius dalla luce lungo -Z
+            Vector3 p = Vector3Transform(center, pendingCascadeBounds[c].lightView);
+            float drift = fmaxf(fmaxf(fabsf(p.x), fabsf(p.y)), fabsf(p.z + radius * 2.0f));
+            if (drift + sliceRadius <= radius) continue;
+        }
+
         // Build light view matrix: position the light just far enough behind
         // the cascade center to capture objects within the bounding sphere.
         // Using a tight offset (2x radius) instead of shadowFar gives much
@@ -239,22 +289,149 @@ void LightManager::updateCascadeMatrices(const Camera3D &camera, float cameraNea
         lightView.m12 -= dx;
         lightView.m13 -= dy;
 
-        cascadeMatrices[c] = MatrixMultiply(lightView, lightProj);
+        pendingCascadeMatrices[c] = MatrixMultiply(lightView, lightProj);
+        pendingCascadeBounds[c].lightView = lightView;
+        pendingCascadeBounds[c].halfExtent = radius;
+        pendingCascadeBounds[c].farDist = projFar;
+
+        anchor.valid = true;
+        anchor.lightDir = lightDir;
+        anchor.extent = radius;
+        staticCascadeDirty[c] = true;
+    }
+}
+
+bool LightManager::cascadeIntersectsSphere(int cascade, Vector3 center, float radius) const {
+    if (!shadowCasterCulling) return true;
+
+    const CascadeBounds &bounds = cascadeBounds[cascade];
+    Vector3 p = Vector3Transform(center, bounds.lightView);
+    if (fabsf(p.x) - radius > bounds.halfExtent) return false;
+    if (fabsf(p.y) - radius > bounds.halfExtent) return false;
+    // Solo il lato lontano dalla luce scarta
+    return p.z + radius >= -bounds.farDist;
+}
+
+float LightManager::getCascadeLodScale(int cascade) const {
+    const float referenceHalfHeight = 540.0f;
+    float halfExtent = fmaxf(cascadeBounds[cascade].halfExtent, 0.001f);
+    return (CASCADE_SIZE * 0.5f) / (referenceHalfHeight * halfExtent);
+}
+
+bool LightManager::cascadeIntersectsBox(int cascade, const BoundingBox &box,
+                                        const Matrix &transform) const {
+    if (!shadowCasterCulling) return true;
+
+    const CascadeBounds &bounds = cascadeBounds[cascade];
+    Matrix m = MatrixMultiply(transform, bounds.lightView);
+
+    // AABB in light space: centro trasformato + estensioni proiettate
+    Vector3 c = Vector3Scale(Vector3Add(box.min, box.max), 0.5f);
+    Vector3 e = Vector3Scale(Vector3Subtract(box.max, box.min), 0.5f);
+    Vector3 p = Vector3Transform(c, m);
+    float ex = fabsf(m.m0) * e.x + fabsf(m.m4) * e.y + fabsf(m.m8) * e.z;
+    float ey = fabsf(m.m1) * e.x + fabsf(m.m5) * e.y + fabsf(m.m9) * e.z;
+    float ez = fabsf(m.m2) * e.x + fabsf(m.m6) * e.y + fabsf(m.m10) * e.z;
+
+    if (fabsf(p.x) - ex > bounds.halfExtent) return false;
+    if (fabsf(p.y) - ey > bounds.halfExtent) return false;
+    return p.z + ez >= -bounds.farDist;
+}
+
+void LightManager::rebuildShadowSchedule() {
+    // Fase greedy: ogni cascata lontana va nei frame del suo periodo meno
+    // carichi. Con intervalli potenze di due l'iperperiodo e' il massimo.
+    int period = 1;
+    for (int c = 0; c < NUM_CASCADES; c++) {
+        int interval = 1;
+        while (interval < cascadeInterval[c] && interval < 64) interval <<= 1;
+        cascadeInterval[c] = interval;
+        if (interval > period) period = interval;
+    }
+
+    int load[64] = {};
+    for (int c = 0; c < NUM_CASCADES; c++) {
+        int interval = cascadeInterval[c];
+        cascadePhase[c] = 0;
+        if (interval == 1) continue;
+
+        int bestLoad = INT32_MAX;
+        for (int phase = 0; phase < interval; phase++) {
+            int maxLoad = 0;
+            for (int f = phase; f < period; f += interval) {
+                if (load[f] > maxLoad) maxLoad = load[f];
+            }
+            if (maxLoad < bestLoad) {
+                bestLoad = maxLoad;
+                cascadePhase[c] = phase;
+            }
+        }
+        for (int f = cascadePhase[c]; f < period; f += interval) {
+            load[f]++;
+        }
     }
 }
 
+void LightManager::invalidateShadowCascades() {
+    for (int c = 0; c < NUM_CASCADES; c++) {
+        cascadeDirty[c] = true;
+        staticCascadeDirty[c] = true;
+    }
+}
+
+void LightManager::invalidateStaticShadows() {
+    invalidateShadowCascades();
+}
+
+unsigned int LightManager::scheduleShadowCascades() {
+    shadowFrameCounter++;
+    scheduledCascades = 0;
+    int farCandidates[NUM_CASCADES];
+    int farCount = 0;
+
+    for (int c = 0; c < NUM_CASCADES; c++) {
+        bool due = cascadeDirty[c] ||
+                   (shadowFrameCounter % cascadeInterval[c]) == cascadePhase[c];
+        if (!due) continue;
+        if (cascadeInterval[c] == 1) {
+            scheduledCascades |= 1u << c;
+        } else {
+            farCandidates[farCount++] = c;
+        }
+    }
+
+    // Budget: prima le cascate aggiornate meno di recente
+    std::sort(farCandidates, farCandidates + farCount, [this](int a, int b) {
+        return shadowStats.cascadeLastFrame[a] < shadowStats.cascadeLastFrame[b];
+    });
+    int budget = shadowMaxFarCascades > 0 ? shadowMaxFarCascades : NUM_CASCADES;
+    for (int i = 0; i < farCount; i++) {
+        int c = farCandidates[i];
+        if (i < budget) {
+            scheduledCascades |= 1u << c;
+        } else {
+            // Rimandata: resta dovuta finche' non viene renderizzata
+            cascadeDirty[c] = true;
+            shadowStats.deferred++;
+        }
+    }
+
+    return scheduledCascades;
+}
+
 void LightManager::beginShadowPass() {
     if (!shadowMapReady || !shadowsEnabled) return;
 
+    shadowPassStart = GetTime();
+
     // Save current matrices
     savedProjection = rlGetMatrixProjection();
     savedModelview = rlGetMatrixModelview();
 
-    // Enable shadow atlas FBO and clear entire atlas once
+    // Le cascate non aggiornate in questo frame restano nell'atlas: ogni
+    // cascata pulisce solo la sua regione in setCascade()
     rlEnableFramebuffer(shadowMapFBO);
-    rlViewport(0, 0, SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE);
     rlClearColor(255, 255, 255, 255);
-    rlClearScreenBuffers();
 
     rlEnableDepthTest();
     rlEnableDepthMask();
@@ -264,13 +441,59 @@ void LightManager::beginShadowPass() {
     rlDisableBackfaceCulling();
 }
 
+void LightManager::beginStaticCascade(int cascade) {
+    if (cascade < 0 || cascade >= NUM_CASCADES || !isStaticCacheActive()) return;
+
+    int x = (cascade % 2) * CASCADE_SIZE;
+    int y = (cascade / 2) * CASCADE_SIZE;
+    rlEnableFramebuffer(staticShadowFBO);
+    rlViewport(x, y, CASCADE_SIZE, CASCADE_SIZE);
+
+    rlEnableScissorTest();
+    rlScissor(x, y, CASCADE_SIZE, CASCADE_SIZE);
+    rlClearScreenBuffers();
+    rlDisableScissorTest();
+
+    staticCascadeDirty[cascade] = false;
+    shadowStats.staticRebuilds[cascade]++;
+
+    // Il culling dei caster statici deve gia' usare il volume di questo
+    // frame (setCascade lo ricommitta subito dopo)
+    cascadeBounds[cascade] = pendingCascadeBounds[cascade];
+    rlSetMatrixModelview(pendingCascadeMatrices[cascade]);
+    rlSetMatrixProjection(MatrixIdentity());
+}
+
 void LightManager::setCascade(int cascade) {
     if (cascade < 0 || cascade >= NUM_CASCADES) return;
 
     // Set viewport to correct quadrant in the 2x2 atlas
     int x = (cascade % 2) * CASCADE_SIZE;
     int y = (cascade / 2) * CASCADE_SIZE;
-    rlViewport(x, y, CASCADE_SIZE, CASCADE_SIZE);
+
+    if (isStaticCacheActive()) {
+        // Parte dalla profondita' statica della cascata
+        rlBindFramebuffer(RL_READ_FRAMEBUFFER, staticShadowFBO);
+        rlBindFramebuffer(RL_DRAW_FRAMEBUFFER, shadowMapFBO);
+        rlBlitFramebuffer(x, y, CASCADE_SIZE, CASCADE_SIZE,
+                          x, y, CASCADE_SIZE, CASCADE_SIZE, DEPTH_BUFFER_BIT);
+        rlEnableFramebuffer(shadowMapFBO);
+        rlViewport(x, y, CASCADE_SIZE, CASCADE_SIZE);
+    } else {
+        rlEnableFramebuffer(shadowMapFBO);
+        rlViewport(x, y, CASCADE_SIZE, CASCADE_SIZE);
+        rlEnableScissorTest();
+        rlScissor(x, y, CASCADE_SIZE, CASCADE_SIZE);
+        rlClearScreenBuffers();
+        rlDisableScissorTest();
+    }
+
+    // La cascata usa da ora le matrici calcolate in questo frame
+    cascadeMatrices[cascade] = pendingCascadeMatrices[cascade];
+    cascadeBounds[cascade] = pendingCascadeBounds[cascade];
+    cascadeDirty[cascade] = false;
+    shadowStats.cascadeUpdates[cascade]++;
+    shadowStats.cascadeLastFrame[cascade] = shadowFrameCounter;
 
     // Set the light-space matrix for this cascade
     rlSetMatrixModelview(cascadeMatrices[cascade]);
@@ -280,6 +503,14 @@ void LightManager::setCascade(int cascade) {
 void LightManager::endShadowPass() {
     if (!shadowMapReady || !shadowsEnabled) return;
 
+    int rendered = 0;
+    for (int c = 0; c < NUM_CASCADES; c++) {
+        if (scheduledCascades & (1u << c)) rendered++;
+    }
+    shadowStats.cascadesPerFrame[shadowStats.head] = (float)rendered;
+    shadowStats.passMs[shadowStats.head] = (float)((GetTime() - shadowPassStart) * 1000.0);
+    shadowStats.head = (shadowStats.head + 1) % SHADOW_STATS_FRAMES;
+
     // Restore culling and blending state
     rlEnableBackfaceCulling();
     rlEnableColorBlend();
@@ -489,17 +720,85 @@ void LightManager::gui() {
 
     // Shadow settings (CSM)
     if (ImGui::CollapsingHeader("Shadows")) {
-        ImGui::Checkbox("Enable Shadows", &shadowsEnabled);
-        ImGui::SliderInt("Update Interval", &shadowUpdateInterval, 1, 6);
-        ImGui::SliderFloat("Cascade Lambda", &cascadeLambda, 0.0f, 1.0f, "%.2f");
+        if (ImGui::Checkbox("Enable Shadows", &shadowsEnabled)) {
+            invalidateShadowCascades();
+        }
+        if (ImGui::SliderFloat("Cascade Lambda", &cascadeLambda, 0.0f, 1.0f, "%.2f")) {
+            invalidateShadowCascades();
+        }
         ImGui::SliderFloat("Shadow Bias", &shadowBias, 0.0001f, 0.1f, "%.4f");
         ImGui::SliderFloat("Normal Offset", &shadowNormalOffset, 0.0f, 2.0f, "%.2f");
-        ImGui::SliderFloat("Shadow Far", &shadowFar, 100.0f, 20000.0f);
+        if (ImGui::SliderFloat("Shadow Far", &shadowFar, 100.0f, 20000.0f)) {
+            invalidateShadowCascades();
+        }
+
+        // Scheduling per cascata
+        if (ImGui::TreeNode("Cascade Schedule")) {
+            static const char *intervalNames[] = {"1", "2", "4", "8", "16", "32"};
+            bool changed = false;
+            for (int c = 0; c < NUM_CASCADES; c++) {
+                int sel = 0;
+                while ((1 << sel) < cascadeInterval[c] && sel < 5) sel++;
+                ImGui::PushID(c);
+                if (ImGui::Combo(TextFormat("Cascade %d interval", c), &sel, intervalNames, 6)) {
+                    cascadeInterval[c] = 1 << sel;
+                    changed = true;
+                }
+                ImGui::PopID();
+            }
+            if (changed) rebuildShadowSchedule();
+            ImGui::SliderInt("Max far cascades/frame", &shadowMaxFarCascades, 0, NUM_CASCADES - 1,
+                             shadowMaxFarCascades == 0 ? "unlimited" : "%d");
+            if (ImGui::Button("Refresh All Cascades")) {
+                invalidateShadowCascades();
+            }
+
+            // Budget
+            const ShadowScheduleStats &stats = shadowStats;
+            float avgCascades = 0.0f, maxCascades = 0.0f, avgMs = 0.0f, maxMs = 0.0f;
+            for (int i = 0; i < SHADOW_STATS_FRAMES; i++) {
+                avgCascades += stats.cascadesPerFrame[i];
+                avgMs += stats.passMs[i];
+                if (stats.cascadesPerFrame[i] > maxCascades) maxCascades = stats.cascadesPerFrame[i];
+                if (stats.passMs[i] > maxMs) maxMs = stats.passMs[i];
+            }
+            avgCascades /= SHADOW_STATS_FRAMES;
+            avgMs /= SHADOW_STATS_FRAMES;
+            ImGui::Text("Cascades/frame: avg %.2f, max %.0f", avgCascades, maxCascades);
+            ImGui::Text("Shadow pass CPU: avg %.2f ms, max %.2f ms", avgMs, maxMs);
+            ImGui::PlotLines("##shadowms", stats.passMs, SHADOW_STATS_FRAMES, stats.head,
+                             "pass ms", 0.0f, maxMs > 0.0f ? maxMs * 1.2f : 1.0f, ImVec2(0, 50));
+            for (int c = 0; c < NUM_CASCADES; c++) {
+                ImGui::Text("Cascade %d: every %d (phase %d), %d updates, %d frames ago", c,
+                            cascadeInterval[c], cascadePhase[c], stats.cascadeUpdates[c],
+                            shadowFrameCounter - stats.cascadeLastFrame[c]);
+            }
+            ImGui::Text("Deferred by budget: %d", stats.deferred);
+            ImGui::Text("Static cache rebuilds: %d | %d | %d | %d",
+                        stats.staticRebuilds[0], stats.staticRebuilds[1],
+                        stats.staticRebuilds[2], stats.staticRebuilds[3]);
+            ImGui::TreePop();
+        }
         if (shadowMapReady) {
             ImGui::TextColored(ImVec4(0, 1, 0, 1), "Shadow Atlas: %dx%d (%d cascades)",
                               SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, NUM_CASCADES);
             ImGui::Text("Cascade splits: %.1f | %.1f | %.1f | %.1f",
                         cascadeSplits[0], cascadeSplits[1], cascadeSplits[2], cascadeSplits[3]);
+            ImGui::Checkbox("Cull Casters Per Cascade", &shadowCasterCulling);
+            if (ImGui::Checkbox("Static Caster Cache", &staticShadowCache)) {
+                invalidateShadowCascades();
+            }
+            if (staticShadowFBO == 0) {
+                ImGui::SameLine();
+                ImGui::TextDisabled("(unavailable)");
+            }
+            if (ImGui::SliderFloat("Static Margin", &staticShadowMargin, 0.0f, 0.5f, "%.2f")) {
+                invalidateShadowCascades();
+            }
+            for (int c = 0; c < NUM_CASCADES; c++) {
+                ImGui::Text("Cascade %d: %d drawn, %d culled", c,
+                            shadowCastersDrawn[c], shadowCastersCulled[c]);
+            }
         } else {
             ImGui::TextColored(ImVec4(1, 0, 0, 1), "Shadow Map: Not initialized");
         }
@@ -531,6 +830,13 @@ void LightManager::unload() {
     if (shadowMaterial.shader.id > 0) {
         shadowMaterial = {0};
     }
+    if (shadowDepthInstancedShader.id > 0) {
+        UnloadShader(shadowDepthInstancedShader);
+        shadowDepthInstancedShader = {0};
+    }
+    if (shadowInstancedMaterial.shader.id > 0) {
+        shadowInstancedMaterial = {0};
+    }
     if (shadowMapFBO > 0) {
         rlUnloadFramebuffer(shadowMapFBO);
         shadowMapFBO = 0;
@@ -539,6 +845,14 @@ void LightManager::unload() {
         rlUnloadTexture(shadowMapDepthTex);
         shadowMapDepthTex = 0;
     }
+    if (staticShadowFBO > 0) {
+        rlUnloadFramebuffer(staticShadowFBO);
+        staticShadowFBO = 0;
+    }
+    if (staticShadowDepthTex > 0) {
+        rlUnloadTexture(staticShadowDepthTex);
+        staticShadowDepthTex = 0;
+    }
     shadowMapReady = false;
 
     for (int i = 0; i < MAX_LIGHTS; i++) {
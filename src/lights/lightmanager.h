@@ -14,6 +14,15 @@ constexpr int CASCADE_SIZE = 2048;
 constexpr int SHADOW_ATLAS_SIZE = CASCADE_SIZE * 2; // 4096 = 2x2 grid
 constexpr int SHADOW_TEXTURE_SLOT = 14;
 
+// Volume ortografico di una cascata nello spazio vista della luce: la luce
+// guarda verso -Z, il volume copre x/y in [-halfExtent, halfExtent] e
+// z in [-farDist, -near]
+struct CascadeBounds {
+  Matrix lightView = {0};
+  float halfExtent = 0.0f;
+  float farDist = 0.0f;
+};
+
 class LightManager {
 public:
   LightManager();
@@ -31,18 +40,57 @@ public:
   void applyMaterial(const Material &material);
 
   // Shadow mapping (CSM)
-  void setupShadowMap(const std::string &depthVsPath, const std::string &depthFsPath);
+  void setupShadowMap(const std::string &depthVsPath, const std::string &depthFsPath,
+                      const std::string &instancedDepthVsPath = "");
   void registerShadowShader(Shader targetShader);
   void updateCascadeMatrices(const Camera3D &camera, float cameraNear, float screenAspect);
   void updateShadowUniforms();
+  // Maschera (bit c = cascata c) delle cascate da ri-renderizzare in questo
+  // frame; avanza il contatore dei frame. Chiamare una volta per frame.
+  unsigned int scheduleShadowCascades();
+  // Forza il re-render di tutte le cascate al prossimo frame
+  void invalidateShadowCascades();
   void beginShadowPass();
+  // Prepara la regione della cascata nell'atlas (copia della profondita'
+  // statica in cache, oppure clear) e ne attiva la matrice
   void setCascade(int cascade);
   void endShadowPass();
   void bindShadowMap();
   Shader getShadowDepthShader() const { return shadowDepthShader; }
   Material getShadowMaterial() const { return shadowMaterial; }
+  // Depth-only material for DrawMeshInstanced (shader id 0 if not loaded)
+  Material getShadowInstancedMaterial() const { return shadowInstancedMaterial; }
   bool areShadowsEnabled() const { return shadowsEnabled && shadowMapReady; }
-  int shadowUpdateInterval = 1;
+
+  // Culling dei caster per cascata. Il volume e' esteso all'infinito verso
+  // la luce: un caster tra la luce e la cascata proietta ombra dentro di essa.
+  const CascadeBounds &getCascadeBounds(int cascade) const { return cascadeBounds[cascade]; }
+  bool cascadeIntersectsSphere(int cascade, Vector3 center, float radius) const;
+  // box in spazio locale, trasformato da transform (world matrix del caster)
+  bool cascadeIntersectsBox(int cascade, const BoundingBox &box,
+                            const Matrix &transform) const;
+  // Raggio * scala = dimensione per selectMeshLod nel depth pass: texel
+  // della cascata rispetto ai pixel di uno schermo alto 1080
+  float getCascadeLodScale(int cascade) const;
+  bool shadowCasterCulling = true;
+
+  // Cache della profondita' dei caster statici (terreno, rocce, strutture) in
+  // un secondo atlas. Ogni cascata resta ancorata a un volume piu' largo di
+  // staticShadowMargin (frazione del raggio) finche' la fetta di frustum ci
+  // sta dentro e la luce non ruota; a ogni update si copia la cache e sopra
+  // si disegnano solo i caster dinamici.
+  bool staticShadowCache = true;
+  float staticShadowMargin = 0.15f;
+  bool isStaticCacheActive() const { return staticShadowCache && staticShadowFBO != 0; }
+  bool isStaticCascadeDirty(int cascade) const { return staticCascadeDirty[cascade]; }
+  // Rende attiva la regione della cascata nell'atlas statico (da chiamare
+  // prima di setCascade, solo se isStaticCascadeDirty)
+  void beginStaticCascade(int cascade);
+  // Strutture piazzate/rimosse, rocce modificate: ridisegna la cache
+  void invalidateStaticShadows();
+  // Caster disegnati / scartati per cascata nell'ultimo shadow pass
+  int shadowCastersDrawn[NUM_CASCADES] = {};
+  int shadowCastersCulled[NUM_CASCADES] = {};
 
   // GUI per ImGui
   void gui();
@@ -80,6 +128,27 @@ public:
   float cascadeLambda = 0.5f; // 0=uniform splits, 1=logarithmic splits
   int shadowFrameCounter = 0;
 
+  // Scheduling per cascata: la cascata c si aggiorna ogni cascadeInterval[c]
+  // frame (potenze di due), con fase scelta da rebuildShadowSchedule() per
+  // non far coincidere le cascate lontane. Oltre shadowMaxFarCascades per
+  // frame le cascate lontane vengono rimandate, la piu' vecchia per prima.
+  int cascadeInterval[NUM_CASCADES] = {1, 2, 4, 8};
+  int shadowMaxFarCascades = 1;
+  void rebuildShadowSchedule();
+
+  // Statistiche del budget (ultimi SHADOW_STATS_FRAMES frame)
+  static constexpr int SHADOW_STATS_FRAMES = 120;
+  struct ShadowScheduleStats {
+    float cascadesPerFrame[SHADOW_STATS_FRAMES] = {};
+    float passMs[SHADOW_STATS_FRAMES] = {}; // CPU, submit dello shadow pass
+    int head = 0;
+    int cascadeUpdates[NUM_CASCADES] = {};
+    int cascadeLastFrame[NUM_CASCADES] = {};
+    int deferred = 0; // cascate rimandate per budget
+    int staticRebuilds[NUM_CASCADES] = {};
+  };
+  const ShadowScheduleStats &getShadowStats() const { return shadowStats; }
+
 private:
   Shader shader = {0};
 
@@ -105,9 +174,18 @@ private:
   // Shadow map resources (CSM)
   Shader shadowDepthShader = {0};
   Material shadowMaterial = {0};
+  Shader shadowDepthInstancedShader = {0};
+  Material shadowInstancedMaterial = {0};
   unsigned int shadowMapFBO = 0;
   unsigned int shadowMapDepthTex = 0;
+  unsigned int staticShadowFBO = 0;
+  unsigned int staticShadowDepthTex = 0;
+  // Matrici attive (usate nel sampling) e quelle appena calcolate, copiate
+  // nelle attive solo quando la cascata viene ri-renderizzata
   Matrix cascadeMatrices[NUM_CASCADES] = {};
+  CascadeBounds cascadeBounds[NUM_CASCADES];
+  Matrix pendingCascadeMatrices[NUM_CASCADES] = {};
+  CascadeBounds pendingCascadeBounds[NUM_CASCADES];
   float cascadeSplits[NUM_CASCADES] = {};
   bool shadowMapReady = false;
 
@@ -129,6 +207,22 @@ private:
   Matrix savedProjection = {0};
   Matrix savedModelview = {0};
 
+  // Volume a cui e' ancorata ogni cascata con la cache statica attiva
+  struct CascadeAnchor {
+    bool valid = false;
+    Vector3 lightDir = {0, 0, 0};
+    float extent = 0.0f;
+  };
+  CascadeAnchor cascadeAnchors[NUM_CASCADES];
+  bool staticCascadeDirty[NUM_CASCADES] = {};
+
+  // Stato dello scheduling
+  int cascadePhase[NUM_CASCADES] = {};
+  bool cascadeDirty[NUM_CASCADES] = {};
+  unsigned int scheduledCascades = 0;
+  double shadowPassStart = 0.0;
+  ShadowScheduleStats shadowStats;
+
   void updatePBRUniforms();
 };
 
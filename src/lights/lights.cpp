@@ -9,6 +9,7 @@ namespace moiras {
 
 Light::Light(const std::string& name) {
     this->name = name;
+    typeMask |= TypeMask;
     normalizeColor();
 }
 
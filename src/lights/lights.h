@@ -10,6 +10,8 @@ enum class LightType { DIRECTIONAL = 0, POINT = 1, SPOT = 2 };
 
 class Light : public GameObject {
 public:
+  static constexpr unsigned int TypeMask = OBJECT_LIGHT;
+
   bool enabled = true;
   Vector3 target = {0, 0, 0};
   Color color = WHITE;
@@ -4,13 +4,60 @@
 #include "game/game.h"
 #include "raylib.h"
 #include "rcamera.h"
+#include <cstdlib>
+#include <cstring>
 
 const int screenWidth = 1920;
 const int screenHeight = 1080;
 string title = "Moiras";
 
 using namespace moiras;
-int main(void) {
+
+// --headless [--frames N] [--duration S] [--dt S] [--rate HZ] [--agents N]
+//            [--seed N]
+static bool parseHeadlessArgs(int argc, char **argv, HeadlessConfig &config) {
+  bool headless = false;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--headless") == 0) {
+      headless = true;
+    } else if (value && strcmp(arg, "--frames") == 0) {
+      config.maxFrames = atoi(value);
+      i++;
+    } else if (value && strcmp(arg, "--duration") == 0) {
+      config.maxSeconds = (float)atof(value);
+      i++;
+    } else if (value && strcmp(arg, "--dt") == 0) {
+      config.fixedDeltaTime = (float)atof(value);
+      i++;
+    } else if (value && strcmp(arg, "--rate") == 0) {
+      config.tickRate = (float)atof(value);
+      i++;
+    } else if (value && strcmp(arg, "--agents") == 0) {
+      config.agentCount = atoi(value);
+      i++;
+    } else if (value && strcmp(arg, "--seed") == 0) {
+      config.seed = (unsigned int)strtoul(value, nullptr, 10);
+      i++;
+    } else {
+      TraceLog(LOG_WARNING, "Unknown argument: %s", arg);
+    }
+  }
+  if (config.fixedDeltaTime <= 0.0f)
+    config.fixedDeltaTime = 1.0f / 60.0f;
+  return headless;
+}
+
+int main(int argc, char **argv) {
+  HeadlessConfig headlessConfig;
+  if (parseHeadlessArgs(argc, argv, headlessConfig)) {
+    Game game = Game();
+    game.setupHeadless(headlessConfig);
+    game.runHeadless(headlessConfig);
+    return 0;
+  }
+
   Game game = Game();
   Window window = Window(screenWidth, screenHeight, title, KEY_END, 144, true);
   window.init();
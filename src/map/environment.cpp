@@ -1,15 +1,107 @@
 #include "environment.hpp"
+#include "../camera/frustum.h"
+#include "../camera/occlusion.h"
+#include "../profiler/profiler.h"
 #include <imgui.h>
 #include <raylib.h>
 #include <raymath.h>
 #include <rlgl.h>
-#include <cstdlib>
+#include <cfloat>
+#include <cstring>
 #include <cmath>
 #include <algorithm>
 #include <filesystem>
 
 namespace moiras {
 
+// Scala massima generata da generate/paintAt (scaleVar in [0.5, 2.0])
+static const float MAX_INSTANCE_SCALE = 2.0f;
+
+static float instanceBoundingRadius(const Mesh &mesh)
+{
+    float maxDist2 = 0.0f;
+    if (mesh.vertices) {
+        for (int v = 0; v < mesh.vertexCount; v++) {
+            const float *p = &mesh.vertices[v * 3];
+            maxDist2 = fmaxf(maxDist2, p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        }
+    }
+    return sqrtf(maxDist2) * MAX_INSTANCE_SCALE;
+}
+
+// Tipi GL per gli attributi per istanza
+static const int ATTRIB_UNSIGNED_SHORT = 0x1403;
+static const int ATTRIB_HALF_FLOAT = 0x140B;
+
+static uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x007FFFFF;
+
+    if (exponent <= 0) return (uint16_t)sign; // troppo piccolo: zero
+    if (exponent >= 31) return (uint16_t)(sign | 0x7C00);
+    // Arrotondamento al piu' vicino sul bit scartato piu' alto
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) half++;
+    return (uint16_t)half;
+}
+
+static float halfToFloat(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    int exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+
+    uint32_t bits;
+    if (exponent == 0) {
+        bits = sign; // denormali non usati dalle scale delle rocce
+    } else if (exponent == 31) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((uint32_t)(exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+RockInstance packRockInstance(Vector3 position, float yaw, float tiltX,
+                              float tiltZ, float scale)
+{
+    float turns = yaw / (2.0f * PI);
+    turns -= floorf(turns);
+    int yawQ = (int)lroundf(turns * 256.0f) & 0xFF;
+    int tiltXQ = (int)lroundf(Clamp(tiltX / ROCK_MAX_TILT, 0.0f, 1.0f) * 15.0f);
+    int tiltZQ = (int)lroundf(Clamp(tiltZ / ROCK_MAX_TILT, 0.0f, 1.0f) * 15.0f);
+
+    RockInstance instance;
+    instance.x = position.x;
+    instance.y = position.y;
+    instance.z = position.z;
+    instance.rotation = (uint16_t)((yawQ << 8) | (tiltXQ << 4) | tiltZQ);
+    instance.scale = floatToHalf(scale);
+    return instance;
+}
+
+Matrix rockInstanceMatrix(const RockInstance &instance)
+{
+    // Stessa ricostruzione di rockInstanceMatrix() in instancing.vs
+    float yaw = (float)(instance.rotation >> 8) * (2.0f * PI / 256.0f);
+    float tiltX = (float)((instance.rotation >> 4) & 0xF) * (ROCK_MAX_TILT / 15.0f);
+    float tiltZ = (float)(instance.rotation & 0xF) * (ROCK_MAX_TILT / 15.0f);
+    float scale = halfToFloat(instance.scale);
+
+    Matrix matScale = MatrixScale(scale, scale * ROCK_Y_SQUASH, scale);
+    Matrix matRotation = MatrixMultiply(
+        MatrixMultiply(MatrixRotateX(tiltX), MatrixRotateY(yaw)),
+        MatrixRotateZ(tiltZ));
+    Matrix matTranslation = MatrixTranslate(instance.x, instance.y, instance.z);
+    return MatrixMultiply(MatrixMultiply(matScale, matRotation), matTranslation);
+}
+
 const char *rockMeshTypeName(RockMeshType type)
 {
     switch (type) {
@@ -39,19 +131,32 @@ EnvironmentalObject::EnvironmentalObject(float rockSize, float spawnRadius)
       m_spawnRadius(spawnRadius),
       m_initialized(false),
       m_shaderLoaded(false),
+      m_revision(0),
       m_cameraPos{0},
       m_cullDistance(150.0f),
+      m_chunkSize(32.0f),
+      m_visibleChunks(0),
+      m_visibleInstances(0),
+      m_occludedChunks(0),
+      m_visibleLodInstances{},
+      m_uploadedBytes(0),
+      m_frameUploadBytes(0),
+      m_bufferRebuilds(0),
       m_brushMode(false),
       m_brushRadius(10.0f),
       m_brushDensity(5),
-      m_activePatch(0)
+      m_activePatch(0),
+      m_brushStroke(0)
 {
+    typeMask |= TypeMask;
     scanModelFiles();
 }
 
 EnvironmentalObject::~EnvironmentalObject()
 {
     for (auto &patch : m_patches) {
+        releaseInstanceBuffer(patch);
+        unloadMeshLods(patch.lods);
         UnloadMesh(patch.mesh);
         UnloadMaterial(patch.material);
     }
@@ -85,8 +190,6 @@ void EnvironmentalObject::loadShader()
                                     "../assets/shaders/instancing.fs");
     m_instancingShader.locs[SHADER_LOC_MATRIX_MVP] =
         GetShaderLocation(m_instancingShader, "mvp");
-    m_instancingShader.locs[SHADER_LOC_MATRIX_MODEL] =
-        GetShaderLocationAttrib(m_instancingShader, "instanceTransform");
     m_shaderLoaded = true;
 }
 
@@ -127,6 +230,103 @@ int EnvironmentalObject::findOrCreatePatch(RockMeshType type)
     return addPatch(type);
 }
 
+void EnvironmentalObject::addInstance(RockPatch &patch, const RockInstance &instance)
+{
+    int cx = chunkCoord(instance.x);
+    int cz = chunkCoord(instance.z);
+    long long key = chunkKey(cx, cz);
+
+    auto it = patch.chunkIndex.find(key);
+    int idx;
+    if (it == patch.chunkIndex.end()) {
+        idx = (int)patch.chunks.size();
+        patch.chunks.emplace_back(cx, cz);
+        patch.chunkIndex[key] = idx;
+    } else {
+        idx = it->second;
+    }
+
+    RockChunk &chunk = patch.chunks[idx];
+    Vector3 pos = {instance.x, instance.y, instance.z};
+    Vector3 r = {patch.boundingRadius, patch.boundingRadius, patch.boundingRadius};
+    if (chunk.instances.empty()) {
+        chunk.bounds = {Vector3Subtract(pos, r), Vector3Add(pos, r)};
+    } else {
+        chunk.bounds.min = Vector3Min(chunk.bounds.min, Vector3Subtract(pos, r));
+        chunk.bounds.max = Vector3Max(chunk.bounds.max, Vector3Add(pos, r));
+    }
+    chunk.instances.push_back(instance);
+    chunk.dirty = true;
+    patch.dirty = true;
+    patch.instanceCount++;
+}
+
+bool EnvironmentalObject::isNearInstance(const RockPatch &patch, Vector3 position,
+                                         float distance) const
+{
+    float d2 = distance * distance;
+    int cx0 = chunkCoord(position.x - distance);
+    int cx1 = chunkCoord(position.x + distance);
+    int cz0 = chunkCoord(position.z - distance);
+    int cz1 = chunkCoord(position.z + distance);
+    for (int cz = cz0; cz <= cz1; cz++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            auto it = patch.chunkIndex.find(chunkKey(cx, cz));
+            if (it == patch.chunkIndex.end()) continue;
+            for (auto &inst : patch.chunks[it->second].instances) {
+                float dx = inst.x - position.x;
+                float dz = inst.z - position.z;
+                if (dx * dx + dz * dz < d2) return true;
+            }
+        }
+    }
+    return false;
+}
+
+int EnvironmentalObject::scatter(RockPatch &patch, const ScatterArea &area, int count,
+                                 uint64_t seed)
+{
+    // La spaziatura vale anche rispetto alle rocce gia' nella patch; la
+    // lambda gira sui worker e legge soltanto
+    std::function<bool(Vector3)> reject;
+    if (m_scatterRules.minSpacing > 0.0f && patch.instanceCount > 0) {
+        reject = [this, &patch](Vector3 p) {
+            return isNearInstance(patch, p, m_scatterRules.minSpacing);
+        };
+    }
+
+    std::vector<ScatterPoint> points =
+        scatterPoints(*m_terrain, area, count, seed, m_scatterRules, reject);
+    for (const ScatterPoint &point : points) {
+        float scaleVar = 0.5f + scatterRandom(seed, point.index, SCATTER_USER + 0) * 1.5f;
+        float rotY = scatterRandom(seed, point.index, SCATTER_USER + 1) * 2.0f * PI;
+        float rotX = scatterRandom(seed, point.index, SCATTER_USER + 2) * ROCK_MAX_TILT;
+        float rotZ = scatterRandom(seed, point.index, SCATTER_USER + 3) * ROCK_MAX_TILT;
+
+        Vector3 pos = point.position;
+        pos.y -= m_rockSize * scaleVar * 0.15f;
+        addInstance(patch, packRockInstance(pos, rotY, rotX, rotZ, scaleVar));
+    }
+    return (int)points.size();
+}
+
+void EnvironmentalObject::updateChunkBounds(RockChunk &chunk, float radius)
+{
+    if (chunk.instances.empty()) {
+        chunk.bounds = {{0, 0, 0}, {0, 0, 0}};
+        return;
+    }
+    Vector3 r = {radius, radius, radius};
+    Vector3 bmin = {FLT_MAX, FLT_MAX, FLT_MAX};
+    Vector3 bmax = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (auto &inst : chunk.instances) {
+        Vector3 pos = {inst.x, inst.y, inst.z};
+        bmin = Vector3Min(bmin, pos);
+        bmax = Vector3Max(bmax, pos);
+    }
+    chunk.bounds = {Vector3Subtract(bmin, r), Vector3Add(bmax, r)};
+}
+
 int EnvironmentalObject::addPatch(RockMeshType type)
 {
     loadShader();
@@ -134,6 +334,9 @@ int EnvironmentalObject::addPatch(RockMeshType type)
     RockPatch patch;
     patch.meshType = type;
     patch.mesh = generateMesh(type, m_rockSize);
+    patch.lods = generateMeshLods(patch.mesh);
+    uploadMeshLods(patch.lods);
+    patch.boundingRadius = instanceBoundingRadius(patch.mesh);
     patch.material = LoadMaterialDefault();
     patch.material.shader = m_instancingShader;
 
@@ -203,6 +406,9 @@ int EnvironmentalObject::addPatchFromModel(const std::string &modelPath)
     patch.meshType = RockMeshType::CUSTOM;
     patch.customName = fileName;
     patch.mesh = mesh;
+    patch.lods = generateMeshLods(mesh);
+    uploadMeshLods(patch.lods);
+    patch.boundingRadius = instanceBoundingRadius(mesh);
     patch.material = LoadMaterialDefault();
     patch.material.shader = m_instancingShader;
     patch.material.maps[MATERIAL_MAP_DIFFUSE].color = {220, 220, 220, 255};
@@ -220,12 +426,12 @@ int EnvironmentalObject::addPatchFromModel(const std::string &modelPath)
     m_patches.push_back(std::move(patch));
     int idx = (int)m_patches.size() - 1;
 
-    TraceLog(LOG_INFO, "Rocks: Created custom patch %d from %s (%d verts)",
-             idx, fileName.c_str(), mesh.vertexCount);
+    TraceLog(LOG_INFO, "Rocks: Created custom patch %d from %s (%d verts, %d LODs)",
+             idx, fileName.c_str(), mesh.vertexCount, m_patches[idx].lods.count);
     return idx;
 }
 
-void EnvironmentalObject::generate(const Model &terrain, int count, RockMeshType type)
+void EnvironmentalObject::generate(const Map &terrain, int count, RockMeshType type)
 {
     m_terrain = &terrain;
     m_initialized = true;
@@ -234,61 +440,27 @@ void EnvironmentalObject::generate(const Model &terrain, int count, RockMeshType
     if (patchIdx < 0) return;
     auto &patch = m_patches[patchIdx];
 
-    BoundingBox bounds = GetMeshBoundingBox(terrain.meshes[0]);
-    Vector3 boundsMin = Vector3Transform(bounds.min, terrain.transform);
-    Vector3 boundsMax = Vector3Transform(bounds.max, terrain.transform);
+    // Bounds gia' in world space
+    BoundingBox bounds = terrain.raycaster.getBounds();
+    Vector3 boundsMin = bounds.min;
+    Vector3 boundsMax = bounds.max;
 
     float minX = fmaxf(boundsMin.x, -m_spawnRadius);
     float maxX = fminf(boundsMax.x, m_spawnRadius);
     float minZ = fmaxf(boundsMin.z, -m_spawnRadius);
     float maxZ = fminf(boundsMax.z, m_spawnRadius);
 
-    srand(42 + (int)type);
-
-    int placed = 0;
-    for (int i = 0; i < count; i++) {
-        float x = minX + ((float)rand() / RAND_MAX) * (maxX - minX);
-        float z = minZ + ((float)rand() / RAND_MAX) * (maxZ - minZ);
-
-        Ray ray;
-        ray.position = {x, 1000.0f, z};
-        ray.direction = {0.0f, -1.0f, 0.0f};
-
-        float y = 0.0f;
-        bool onGround = false;
-        for (int m = 0; m < terrain.meshCount; m++) {
-            RayCollision hit = GetRayCollisionMesh(ray, terrain.meshes[m], terrain.transform);
-            if (hit.hit) {
-                y = hit.point.y;
-                onGround = true;
-                break;
-            }
-        }
-
-        if (!onGround || y < 0.5f) continue;
-
-        float scaleVar = 0.5f + ((float)rand() / RAND_MAX) * 1.5f;
-        float rotY = ((float)rand() / RAND_MAX) * 360.0f * DEG2RAD;
-        float rotX = ((float)rand() / RAND_MAX) * 15.0f * DEG2RAD;
-        float rotZ = ((float)rand() / RAND_MAX) * 15.0f * DEG2RAD;
-
-        y -= m_rockSize * scaleVar * 0.15f;
-
-        Matrix matScale = MatrixScale(scaleVar, scaleVar * 0.6f, scaleVar);
-        Matrix matRotation = MatrixMultiply(
-            MatrixMultiply(MatrixRotateX(rotX), MatrixRotateY(rotY)),
-            MatrixRotateZ(rotZ));
-        Matrix matTranslation = MatrixTranslate(x, y, z);
-        Matrix transform = MatrixMultiply(MatrixMultiply(matScale, matRotation), matTranslation);
-
-        patch.transforms.push_back(transform);
-        placed++;
-    }
+    ScatterArea area = {{(minX + maxX) * 0.5f, (minZ + maxZ) * 0.5f},
+                        {(maxX - minX) * 0.5f, (maxZ - minZ) * 0.5f}, false};
+    double start = GetTime();
+    int placed = scatter(patch, area, count, 42 + (uint64_t)type);
 
     m_activePatch = patchIdx;
+    m_revision++;
 
-    TraceLog(LOG_INFO, "Rocks: Generated %d instances in patch %d (%s)",
-             placed, patchIdx, rockMeshTypeName(type));
+    TraceLog(LOG_INFO, "Rocks: Generated %d/%d instances in patch %d (%s) in %.2f ms",
+             placed, count, patchIdx, rockMeshTypeName(type),
+             (GetTime() - start) * 1000.0);
 }
 
 void EnvironmentalObject::setActivePatch(int idx)
@@ -320,45 +492,9 @@ void EnvironmentalObject::paintAt(Vector3 center)
 
     auto &patch = m_patches[m_activePatch];
 
-    for (int i = 0; i < m_brushDensity; i++) {
-        float angle = ((float)rand() / RAND_MAX) * 2.0f * PI;
-        float dist = sqrtf((float)rand() / RAND_MAX) * m_brushRadius;
-        float x = center.x + cosf(angle) * dist;
-        float z = center.z + sinf(angle) * dist;
-
-        Ray ray;
-        ray.position = {x, 1000.0f, z};
-        ray.direction = {0.0f, -1.0f, 0.0f};
-
-        float y = 0.0f;
-        bool onGround = false;
-        for (int m = 0; m < m_terrain->meshCount; m++) {
-            RayCollision hit = GetRayCollisionMesh(ray, m_terrain->meshes[m], m_terrain->transform);
-            if (hit.hit) {
-                y = hit.point.y;
-                onGround = true;
-                break;
-            }
-        }
-
-        if (!onGround || y < 0.5f) continue;
-
-        float scaleVar = 0.5f + ((float)rand() / RAND_MAX) * 1.5f;
-        float rotY = ((float)rand() / RAND_MAX) * 360.0f * DEG2RAD;
-        float rotX = ((float)rand() / RAND_MAX) * 15.0f * DEG2RAD;
-        float rotZ = ((float)rand() / RAND_MAX) * 15.0f * DEG2RAD;
-
-        y -= m_rockSize * scaleVar * 0.15f;
-
-        Matrix matScale = MatrixScale(scaleVar, scaleVar * 0.6f, scaleVar);
-        Matrix matRotation = MatrixMultiply(
-            MatrixMultiply(MatrixRotateX(rotX), MatrixRotateY(rotY)),
-            MatrixRotateZ(rotZ));
-        Matrix matTranslation = MatrixTranslate(x, y, z);
-        Matrix transform = MatrixMultiply(MatrixMultiply(matScale, matRotation), matTranslation);
-
-        patch.transforms.push_back(transform);
-    }
+    ScatterArea area = {{center.x, center.z}, {m_brushRadius, m_brushRadius}, true};
+    uint64_t seed = 0xB5A3C0DEull ^ (m_brushStroke++ << 16);
+    if (scatter(patch, area, m_brushDensity, seed) > 0) m_revision++;
 }
 
 void EnvironmentalObject::eraseAt(Vector3 center)
@@ -366,57 +502,372 @@ void EnvironmentalObject::eraseAt(Vector3 center)
     if (!m_initialized) return;
 
     float r2 = m_brushRadius * m_brushRadius;
+    bool changed = false;
+
+    // Solo i chunk che toccano il cerchio del pennello
+    int cx0 = chunkCoord(center.x - m_brushRadius);
+    int cx1 = chunkCoord(center.x + m_brushRadius);
+    int cz0 = chunkCoord(center.z - m_brushRadius);
+    int cz1 = chunkCoord(center.z + m_brushRadius);
 
     for (auto &patch : m_patches) {
-        patch.transforms.erase(
-            std::remove_if(patch.transforms.begin(), patch.transforms.end(),
-                [&](const Matrix &mat) {
-                    float dx = mat.m12 - center.x;
-                    float dz = mat.m14 - center.z;
-                    return (dx * dx + dz * dz) <= r2;
-                }),
-            patch.transforms.end());
+        for (int cz = cz0; cz <= cz1; cz++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                auto it = patch.chunkIndex.find(chunkKey(cx, cz));
+                if (it == patch.chunkIndex.end()) continue;
+
+                RockChunk &chunk = patch.chunks[it->second];
+                size_t before = chunk.instances.size();
+                chunk.instances.erase(
+                    std::remove_if(chunk.instances.begin(), chunk.instances.end(),
+                        [&](const RockInstance &inst) {
+                            float dx = inst.x - center.x;
+                            float dz = inst.z - center.z;
+                            return (dx * dx + dz * dz) <= r2;
+                        }),
+                    chunk.instances.end());
+
+                size_t removed = before - chunk.instances.size();
+                if (removed > 0) {
+                    patch.instanceCount -= (int)removed;
+                    updateChunkBounds(chunk, patch.boundingRadius);
+                    // Le istanze restano compatte nello slot del chunk
+                    chunk.dirty = true;
+                    patch.dirty = true;
+                    changed = true;
+                }
+            }
+        }
     }
+    if (changed) m_revision++;
 }
 
 void EnvironmentalObject::clearAll()
 {
     for (auto &patch : m_patches) {
-        patch.transforms.clear();
+        patch.chunks.clear();
+        patch.chunkIndex.clear();
+        patch.instanceCount = 0;
+        releaseInstanceBuffer(patch);
     }
+    m_revision++;
 }
 
 int EnvironmentalObject::getTotalInstanceCount() const
 {
     int total = 0;
     for (auto &patch : m_patches) {
-        total += (int)patch.transforms.size();
+        total += patch.instanceCount;
     }
     return total;
 }
 
+void EnvironmentalObject::appendRange(std::vector<InstanceRange> &ranges,
+                                      const RockChunk &chunk)
+{
+    int count = (int)chunk.instances.size();
+    // Chunk adiacenti nel buffer diventano un solo draw
+    if (!ranges.empty() && ranges.back().first + ranges.back().count == chunk.first) {
+        ranges.back().count += count;
+    } else {
+        ranges.push_back({chunk.first, count});
+    }
+}
+
+void EnvironmentalObject::releaseInstanceBuffer(RockPatch &patch)
+{
+    if (patch.instanceVbo != 0) {
+        rlUnloadVertexBuffer(patch.instanceVbo);
+    }
+    patch.instanceVbo = 0;
+    patch.vboCapacity = 0;
+    patch.vboUsed = 0;
+    patch.vboWasted = 0;
+    for (auto &chunk : patch.chunks) {
+        chunk.first = -1;
+        chunk.capacity = 0;
+        chunk.dirty = true;
+    }
+    patch.dirty = !patch.chunks.empty();
+}
+
+void EnvironmentalObject::rebuildInstanceBuffer(RockPatch &patch)
+{
+    // Rimuove i chunk vuoti e ordina per riga: chunk vicini in XZ finiscono
+    // contigui nel buffer e i loro draw si fondono
+    patch.chunks.erase(
+        std::remove_if(patch.chunks.begin(), patch.chunks.end(),
+                       [](const RockChunk &c) { return c.instances.empty(); }),
+        patch.chunks.end());
+    std::sort(patch.chunks.begin(), patch.chunks.end(),
+              [](const RockChunk &a, const RockChunk &b) {
+                  return a.cz != b.cz ? a.cz < b.cz : a.cx < b.cx;
+              });
+    patch.chunkIndex.clear();
+
+    m_uploadBuffer.clear();
+    m_uploadBuffer.reserve(patch.instanceCount);
+    for (int i = 0; i < (int)patch.chunks.size(); i++) {
+        RockChunk &chunk = patch.chunks[i];
+        patch.chunkIndex[chunkKey(chunk.cx, chunk.cz)] = i;
+        chunk.first = (int)m_uploadBuffer.size();
+        chunk.capacity = (int)chunk.instances.size();
+        chunk.dirty = false;
+        m_uploadBuffer.insert(m_uploadBuffer.end(),
+                              chunk.instances.begin(), chunk.instances.end());
+    }
+
+    // Spazio in coda per i chunk che il pennello fa crescere
+    int used = (int)m_uploadBuffer.size();
+    int capacity = used + used / 2 + 256;
+    if (patch.instanceVbo == 0 || capacity > patch.vboCapacity) {
+        if (patch.instanceVbo != 0) rlUnloadVertexBuffer(patch.instanceVbo);
+        patch.instanceVbo = rlLoadVertexBuffer(nullptr, capacity * (int)sizeof(RockInstance), true);
+        patch.vboCapacity = capacity;
+    }
+    if (used > 0) {
+        rlUpdateVertexBuffer(patch.instanceVbo, m_uploadBuffer.data(),
+                             used * (int)sizeof(RockInstance), 0);
+    }
+    patch.vboUsed = used;
+    patch.vboWasted = 0;
+    patch.dirty = false;
+    m_frameUploadBytes += used * (int)sizeof(RockInstance);
+    m_bufferRebuilds++;
+}
+
+void EnvironmentalObject::uploadInstances(RockPatch &patch)
+{
+    if (patch.instanceVbo == 0) {
+        rebuildInstanceBuffer(patch);
+        return;
+    }
+    if (!patch.dirty) return;
+
+    // Chunk nuovi o cresciuti oltre lo slot: nuovo slot in coda con margine
+    int needed = 0;
+    for (auto &chunk : patch.chunks) {
+        int count = (int)chunk.instances.size();
+        if (chunk.dirty && count > chunk.capacity) {
+            needed += std::max(count * 2, 16);
+        }
+    }
+    if (patch.vboUsed + needed > patch.vboCapacity ||
+        patch.vboWasted + needed > patch.vboCapacity / 2) {
+        rebuildInstanceBuffer(patch);
+        return;
+    }
+
+    for (auto &chunk : patch.chunks) {
+        if (!chunk.dirty) continue;
+        int count = (int)chunk.instances.size();
+        if (count > chunk.capacity) {
+            if (chunk.first >= 0) patch.vboWasted += chunk.capacity;
+            chunk.first = patch.vboUsed;
+            chunk.capacity = std::max(count * 2, 16);
+            patch.vboUsed += chunk.capacity;
+        }
+        if (count > 0) {
+            rlUpdateVertexBuffer(patch.instanceVbo, chunk.instances.data(),
+                                 count * (int)sizeof(RockInstance),
+                                 chunk.first * (int)sizeof(RockInstance));
+            m_frameUploadBytes += count * (int)sizeof(RockInstance);
+        }
+        chunk.dirty = false;
+    }
+    patch.dirty = false;
+}
+
+const EnvironmentalObject::InstanceLocs &EnvironmentalObject::instanceLocs(const Shader &shader)
+{
+    for (auto &locs : m_instanceLocs) {
+        if (locs.shaderId == shader.id) return locs;
+    }
+    InstanceLocs locs;
+    locs.shaderId = shader.id;
+    locs.position = GetShaderLocationAttrib(shader, "instancePosition");
+    locs.rotation = GetShaderLocationAttrib(shader, "instanceRotation");
+    locs.scale = GetShaderLocationAttrib(shader, "instanceScale");
+    m_instanceLocs.push_back(locs);
+    return m_instanceLocs.back();
+}
+
+void EnvironmentalObject::drawInstances(const RockPatch &patch, const Mesh &mesh,
+                                        const Material &material,
+                                        const std::vector<InstanceRange> &ranges)
+{
+    if (ranges.empty() || mesh.vaoId == 0 || patch.instanceVbo == 0) return;
+    const InstanceLocs &locs = instanceLocs(material.shader);
+
+    rlEnableShader(material.shader.id);
+
+    // Uniform del materiale come in DrawMeshInstanced
+    if (material.shader.locs[SHADER_LOC_COLOR_DIFFUSE] != -1) {
+        Color c = material.maps[MATERIAL_MAP_DIFFUSE].color;
+        float color[4] = {c.r / 255.0f, c.g / 255.0f, c.b / 255.0f, c.a / 255.0f};
+        rlSetUniform(material.shader.locs[SHADER_LOC_COLOR_DIFFUSE], color,
+                     SHADER_UNIFORM_VEC4, 1);
+    }
+    Matrix mvp = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    rlSetUniformMatrix(material.shader.locs[SHADER_LOC_MATRIX_MVP], mvp);
+
+    unsigned int texture = material.maps[MATERIAL_MAP_DIFFUSE].texture.id;
+    if (texture > 0 && material.shader.locs[SHADER_LOC_MAP_DIFFUSE] != -1) {
+        int slot = 0;
+        rlActiveTextureSlot(0);
+        rlEnableTexture(texture);
+        rlSetUniform(material.shader.locs[SHADER_LOC_MAP_DIFFUSE], &slot,
+                     SHADER_UNIFORM_INT, 1);
+    }
+
+    // Buffer per istanza: position (float3), rotation (ushort), scale (half)
+    rlEnableVertexArray(mesh.vaoId);
+    rlEnableVertexBuffer(patch.instanceVbo);
+    if (locs.position >= 0) {
+        rlSetVertexAttributeDivisor(locs.position, 1);
+        rlEnableVertexAttribute(locs.position);
+    }
+    if (locs.rotation >= 0) {
+        rlSetVertexAttributeDivisor(locs.rotation, 1);
+        rlEnableVertexAttribute(locs.rotation);
+    }
+    if (locs.scale >= 0) {
+        rlSetVertexAttributeDivisor(locs.scale, 1);
+        rlEnableVertexAttribute(locs.scale);
+    }
+
+    const int stride = (int)sizeof(RockInstance);
+    for (const InstanceRange &range : ranges) {
+        int base = range.first * stride;
+        if (locs.position >= 0) {
+            rlSetVertexAttribute(locs.position, 3, RL_FLOAT, false, stride, base);
+        }
+        if (locs.rotation >= 0) {
+            rlSetVertexAttribute(locs.rotation, 1, ATTRIB_UNSIGNED_SHORT, false, stride, base + 12);
+        }
+        if (locs.scale >= 0) {
+            rlSetVertexAttribute(locs.scale, 1, ATTRIB_HALF_FLOAT, false, stride, base + 14);
+        }
+
+        if (mesh.indices != nullptr) {
+            rlDrawVertexArrayElementsInstanced(0, mesh.triangleCount * 3, 0, range.count);
+        } else {
+            rlDrawVertexArrayInstanced(0, mesh.vertexCount, range.count);
+        }
+    }
+
+    // Il VAO della mesh e' condiviso con i draw non instanziati
+    if (locs.position >= 0) rlDisableVertexAttribute(locs.position);
+    if (locs.rotation >= 0) rlDisableVertexAttribute(locs.rotation);
+    if (locs.scale >= 0) rlDisableVertexAttribute(locs.scale);
+    rlDisableVertexArray();
+    rlDisableVertexBuffer();
+
+    if (texture > 0) {
+        rlActiveTextureSlot(0);
+        rlDisableTexture();
+    }
+    rlDisableShader();
+}
+
 void EnvironmentalObject::draw()
 {
     if (!isVisible || !m_initialized) return;
+    PROFILE_SCOPE("Rocks::draw");
 
     float cullDist2 = m_cullDistance * m_cullDistance;
+    Frustum frustum = Frustum::fromCurrentMatrices();
+    LodView view = LodView::fromCurrentMatrices();
+    OcclusionCuller &occlusion = OcclusionCuller::getInstance();
+    m_visibleChunks = 0;
+    m_occludedChunks = 0;
+    m_visibleInstances = 0;
+    for (int lod = 0; lod < MAX_MESH_LODS; lod++) {
+        m_visibleLodInstances[lod] = 0;
+    }
 
     for (auto &patch : m_patches) {
-        if (patch.transforms.empty()) continue;
-
-        m_visibleBuffer.clear();
-        for (auto &t : patch.transforms) {
-            float dx = t.m12 - m_cameraPos.x;
-            float dz = t.m14 - m_cameraPos.z;
-            if ((dx * dx + dz * dz) <= cullDist2) {
-                m_visibleBuffer.push_back(t);
+        if (patch.instanceCount == 0) continue;
+        uploadInstances(patch);
+
+        // Set visibile: intervalli dei chunk interi nel buffer della patch,
+        // separati per LOD
+        for (auto &ranges : m_visibleRanges) {
+            ranges.clear();
+        }
+        for (auto &chunk : patch.chunks) {
+            if (chunk.instances.empty()) continue;
+
+            // Distanza XZ dalla camera al punto piu' vicino del chunk
+            float dx = fmaxf(fmaxf(chunk.bounds.min.x - m_cameraPos.x, 0.0f),
+                             m_cameraPos.x - chunk.bounds.max.x);
+            float dz = fmaxf(fmaxf(chunk.bounds.min.z - m_cameraPos.z, 0.0f),
+                             m_cameraPos.z - chunk.bounds.max.z);
+            if (dx * dx + dz * dz > cullDist2) continue;
+            if (!frustum.intersectsBox(chunk.bounds)) continue;
+            if (!occlusion.isVisible(chunk.bounds)) {
+                m_occludedChunks++;
+                continue;
             }
+
+            // LOD dalla roccia piu' grande nel punto del chunk piu' vicino
+            Vector3 nearest = Vector3Clamp(view.eye, chunk.bounds.min, chunk.bounds.max);
+            float size = view.screenSize(Vector3Distance(view.eye, nearest), patch.boundingRadius);
+            int lod = selectMeshLod(size, patch.lods.count);
+
+            appendRange(m_visibleRanges[lod], chunk);
+            m_visibleChunks++;
+            m_visibleInstances += (int)chunk.instances.size();
+            m_visibleLodInstances[lod] += (int)chunk.instances.size();
+        }
+
+        for (int lod = 0; lod < patch.lods.count; lod++) {
+            drawInstances(patch, patch.lods.lods[lod], patch.material, m_visibleRanges[lod]);
         }
+    }
 
-        if (!m_visibleBuffer.empty()) {
-            DrawMeshInstanced(patch.mesh, patch.material,
-                              m_visibleBuffer.data(), (int)m_visibleBuffer.size());
+    // Comprende i caricamenti fatti dal depth pass di questo frame
+    m_uploadedBytes = m_frameUploadBytes;
+    m_frameUploadBytes = 0;
+}
+
+void EnvironmentalObject::drawShadow(LightManager &lights, int cascade,
+                                     const Material &shadowMat,
+                                     const Material &shadowInstancedMat)
+{
+    if (!isVisible || !m_initialized) return;
+
+    // Nessun culling per distanza dalla camera: le rocce fuori vista
+    // proiettano comunque ombra dentro la cascata
+    const Matrix identity = MatrixIdentity();
+    const bool instanced = shadowInstancedMat.shader.id > 0;
+    for (auto &patch : m_patches) {
+        if (patch.instanceCount == 0) continue;
+        // Il depth pass precede draw(): gli slot vanno aggiornati qui
+        if (instanced) uploadInstances(patch);
+        // Un solo LOD per cascata: la densita' di texel e' uniforme
+        const Mesh &mesh = patch.lods.lods[selectMeshLod(
+            patch.boundingRadius * lights.getCascadeLodScale(cascade), patch.lods.count)];
+
+        m_shadowRanges.clear();
+        int drawn = 0;
+        for (auto &chunk : patch.chunks) {
+            if (chunk.instances.empty()) continue;
+            if (!lights.cascadeIntersectsBox(cascade, chunk.bounds, identity)) continue;
+
+            drawn += (int)chunk.instances.size();
+            if (instanced) {
+                appendRange(m_shadowRanges, chunk);
+            } else {
+                for (auto &inst : chunk.instances) {
+                    DrawMesh(mesh, shadowMat, rockInstanceMatrix(inst));
+                }
+            }
         }
+        lights.shadowCastersDrawn[cascade] += drawn;
+        lights.shadowCastersCulled[cascade] += patch.instanceCount - drawn;
+
+        if (instanced) drawInstances(patch, mesh, shadowInstancedMat, m_shadowRanges);
     }
 }
 
@@ -427,12 +878,20 @@ void EnvironmentalObject::gui()
         ImGui::Text("Total instances: %d", getTotalInstanceCount());
         ImGui::Text("Patches: %d", (int)m_patches.size());
         ImGui::Text("Cull distance: %.0f", m_cullDistance);
+        ImGui::Text("Visible: %d chunks, %d instances", m_visibleChunks, m_visibleInstances);
+        ImGui::Text("Occluded: %d chunks", m_occludedChunks);
+        ImGui::Text("LOD instances: %d / %d / %d / %d", m_visibleLodInstances[0],
+                    m_visibleLodInstances[1], m_visibleLodInstances[2],
+                    m_visibleLodInstances[3]);
+        ImGui::Text("Instance upload: %d bytes/frame, %d rebuilds",
+                    m_uploadedBytes, m_bufferRebuilds);
         ImGui::Checkbox("Visible", &isVisible);
 
         for (int i = 0; i < (int)m_patches.size(); i++) {
             auto &p = m_patches[i];
-            ImGui::Text("  [%d] %s: %d instances", i,
-                        patchDisplayName(p), (int)p.transforms.size());
+            ImGui::Text("  [%d] %s: %d instances, %d chunks, %d LODs", i,
+                        patchDisplayName(p), p.instanceCount, (int)p.chunks.size(),
+                        p.lods.count);
         }
     }
     ImGui::PopID();
@@ -1,8 +1,15 @@
 #pragma once
 #include "../game/game_object.h"
+#include "map.h"
+#include "scatter.h"
+#include "../lights/lightmanager.h"
+#include "../resources/mesh_lod.h"
 #include <raylib.h>
-#include <vector>
+#include <cmath>
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace moiras {
 
@@ -16,36 +23,120 @@ enum class RockMeshType {
     COUNT
 };
 
+// Istanza compatta (16 byte). Il piazzamento produce solo posizione, yaw,
+// una piccola inclinazione su X/Z e scala uniforme con schiacciamento Y
+// fisso: la matrice viene ricostruita nel vertex shader (instancing.vs,
+// shadow_depth_instanced.vs) e da rockInstanceMatrix() sulla CPU.
+struct RockInstance {
+    float x, y, z;
+    uint16_t rotation; // yaw 8 bit | tilt X 4 bit | tilt Z 4 bit
+    uint16_t scale;    // half float
+};
+static_assert(sizeof(RockInstance) == 16, "RockInstance must stay 16 bytes");
+
+constexpr float ROCK_Y_SQUASH = 0.6f;
+constexpr float ROCK_MAX_TILT = 15.0f * DEG2RAD;
+
+RockInstance packRockInstance(Vector3 position, float yaw, float tiltX,
+                              float tiltZ, float scale);
+Matrix rockInstanceMatrix(const RockInstance &instance);
+
+// Istanze di una patch che cadono in una cella XZ di lato chunkSize
+struct RockChunk {
+    int cx, cz;
+    BoundingBox bounds; // AABB world delle sfere di bounding delle istanze
+    std::vector<RockInstance> instances;
+    // Slot [first, first + capacity) nel buffer GPU della patch (-1: nessuno)
+    int first;
+    int capacity;
+    bool dirty; // istanze da ricaricare nel proprio slot
+
+    RockChunk(int x, int z) : cx(x), cz(z), bounds{{0, 0, 0}, {0, 0, 0}},
+                              first(-1), capacity(0), dirty(true) {}
+};
+
+// Intervallo contiguo di istanze nel buffer GPU di una patch
+struct InstanceRange {
+    int first;
+    int count;
+};
+
 struct RockPatch {
     Mesh mesh;
     Material material;
+    // lods.lods[0] == mesh; i LOD semplificati sono posseduti dalla catena
+    MeshLodChain lods;
     RockMeshType meshType;
     std::string customName; // nome file per patch CUSTOM
-    std::vector<Matrix> transforms;
-
-    RockPatch() : mesh{0}, material{0}, meshType(RockMeshType::CUBE) {}
+    // Istanze raggruppate per chunk; chunkIndex: chiave cella -> indice
+    std::vector<RockChunk> chunks;
+    std::unordered_map<long long, int> chunkIndex;
+    int instanceCount;
+    // Raggio della mesh dall'origine alla scala massima di un'istanza
+    float boundingRadius;
+
+    // Buffer GPU persistente: i chunk sono impaccati in ordine (cz, cx),
+    // quelli cresciuti oltre il loro slot vengono spostati in coda
+    unsigned int instanceVbo;
+    int vboCapacity; // slot allocati
+    int vboUsed;     // slot assegnati ai chunk (compresi i buchi)
+    int vboWasted;   // slot lasciati liberi dai chunk spostati
+    bool dirty;      // almeno un chunk da ricaricare
+
+    RockPatch() : mesh{0}, material{0}, meshType(RockMeshType::CUBE),
+                  instanceCount(0), boundingRadius(0.0f), instanceVbo(0),
+                  vboCapacity(0), vboUsed(0), vboWasted(0), dirty(false) {}
 };
 
 class EnvironmentalObject : public GameObject {
+public:
+    static constexpr unsigned int TypeMask = OBJECT_ENVIRONMENT;
+
 private:
     std::vector<RockPatch> m_patches;
     Shader m_instancingShader;
-    const Model *m_terrain;
+    const Map *m_terrain;
     float m_rockSize;
     float m_spawnRadius;
     bool m_initialized;
     bool m_shaderLoaded;
+    // Incrementata a ogni modifica delle istanze (cache delle ombre statiche)
+    unsigned int m_revision;
 
-    // Camera culling
+    // Camera culling (per chunk: frustum + distanza XZ)
     Vector3 m_cameraPos;
     float m_cullDistance;
-    std::vector<Matrix> m_visibleBuffer; // temp buffer per draw
+    float m_chunkSize;
+    std::vector<InstanceRange> m_visibleRanges[MAX_MESH_LODS]; // temp per draw
+    int m_visibleChunks;
+    int m_visibleInstances;
+    int m_occludedChunks;  // nel frustum ma nascosti (OcclusionCuller)
+    int m_visibleLodInstances[MAX_MESH_LODS];
+    std::vector<InstanceRange> m_shadowRanges;  // temp per cascata
+    std::vector<RockInstance> m_uploadBuffer;   // staging per il rebuild
+    int m_uploadedBytes;                        // caricati nell'ultimo frame
+    int m_frameUploadBytes;
+    int m_bufferRebuilds;
+
+    // Location degli attributi per istanza, per shader
+    struct InstanceLocs {
+        unsigned int shaderId = 0;
+        int position = -1;
+        int rotation = -1;
+        int scale = -1;
+    };
+    std::vector<InstanceLocs> m_instanceLocs;
 
     // Brush
     bool m_brushMode;
     float m_brushRadius;
     int m_brushDensity;
     int m_activePatch;
+    // Seed del pennello: uno per chiamata di paintAt
+    uint64_t m_brushStroke;
+
+    // Piazzamento (generate e pennello)
+    ScatterRules m_scatterRules;
 
     // Model file list per sidebar
     std::vector<std::string> m_modelFiles;
@@ -53,6 +144,27 @@ private:
     Mesh generateMesh(RockMeshType type, float size);
     void loadShader();
     int findOrCreatePatch(RockMeshType type);
+    long long chunkKey(int cx, int cz) const { return ((long long)cx << 32) | (unsigned int)cz; }
+    int chunkCoord(float v) const { return (int)floorf(v / m_chunkSize); }
+    void addInstance(RockPatch &patch, const RockInstance &instance);
+    // Piazza nella patch i candidati accettati da scatterPoints; scala,
+    // yaw e inclinazione dagli stessi stream per candidato
+    int scatter(RockPatch &patch, const ScatterArea &area, int count, uint64_t seed);
+    bool isNearInstance(const RockPatch &patch, Vector3 position, float distance) const;
+    static void updateChunkBounds(RockChunk &chunk, float radius);
+    static void appendRange(std::vector<InstanceRange> &ranges, const RockChunk &chunk);
+    // Carica sulla GPU solo gli slot dei chunk modificati; riallinea
+    // l'intero buffer quando lo spazio in coda finisce
+    void uploadInstances(RockPatch &patch);
+    void rebuildInstanceBuffer(RockPatch &patch);
+    static void releaseInstanceBuffer(RockPatch &patch);
+    const InstanceLocs &instanceLocs(const Shader &shader);
+    // Un draw instanziato per intervallo del buffer persistente della patch
+    // (GL 3.3 non ha baseInstance: gli offset degli attributi vengono
+    // spostati a ogni intervallo)
+    void drawInstances(const RockPatch &patch, const Mesh &mesh,
+                       const Material &material,
+                       const std::vector<InstanceRange> &ranges);
 
 public:
     EnvironmentalObject(float rockSize = 1.0f, float spawnRadius = 200.0f);
@@ -60,7 +172,7 @@ public:
     EnvironmentalObject(const EnvironmentalObject &) = delete;
     EnvironmentalObject &operator=(const EnvironmentalObject &) = delete;
 
-    void generate(const Model &terrain, int count, RockMeshType type);
+    void generate(const Map &terrain, int count, RockMeshType type);
     void updateCameraPos(Vector3 camPos) { m_cameraPos = camPos; }
 
     // Brush
@@ -73,7 +185,9 @@ public:
     void setBrushRadius(float r) { m_brushRadius = r; }
     int getBrushDensity() const { return m_brushDensity; }
     void setBrushDensity(int d) { m_brushDensity = d; }
+    ScatterRules &getScatterRules() { return m_scatterRules; }
     float getCullDistance() const { return m_cullDistance; }
+    float getChunkSize() const { return m_chunkSize; }
     void setCullDistance(float d) { m_cullDistance = d; }
 
     // Patches
@@ -90,10 +204,17 @@ public:
     void scanModelFiles();
     const std::vector<std::string> &getModelFiles() const { return m_modelFiles; }
 
+    // LOD per chunk dalla dimensione a schermo della roccia piu' grande
     void draw() override;
+    // Depth pass per la cascata corrente: draw instanziati dei soli chunk
+    // dentro la cascata, con il LOD scelto dalla risoluzione della cascata.
+    // Senza materiale instanced ricade su un DrawMesh per istanza.
+    void drawShadow(LightManager &lights, int cascade, const Material &shadowMat,
+                    const Material &shadowInstancedMat);
     void gui() override;
 
     int getTotalInstanceCount() const;
+    unsigned int getRevision() const { return m_revision; }
 };
 
 const char *rockMeshTypeName(RockMeshType type);
@@ -1,5 +1,6 @@
 #include "map.h"
 #include "../models/models.h"
+#include "../resources/model_geometry.h"
 #include "../time/time_manager.h"
 #include <imgui.h>
 #include <raylib.h>
@@ -11,6 +12,7 @@ namespace moiras {
 
 Map::Map() : width(0), height(0), length(0), model{}, mesh{}, texture{} {
   name = "Map";
+  typeMask |= TypeMask;
 }
 
 Map::Map(float width_, float height_, float length_, Model model_, Mesh mesh_,
@@ -18,6 +20,8 @@ Map::Map(float width_, float height_, float length_, Model model_, Mesh mesh_,
     : width(width_), height(height_), length(length_), model(model_),
       mesh(mesh_), texture(texture_) {
   name = "Map";
+  typeMask |= TypeMask;
+  raycaster.build(model);
 }
 
 Map::~Map() {
@@ -40,12 +44,17 @@ Map::Map(Map &&other) noexcept
       length(other.length), model(other.model), mesh(other.mesh),
       texture(other.texture) {
   name = "Map";
+  raycaster = std::move(other.raycaster);
   other.model = {};
   other.mesh = {};
   other.texture = {};
 }
 
-Map::Map(Model model_) : model(model_) { name = "Map"; }
+Map::Map(Model model_) : model(model_) {
+  name = "Map";
+  typeMask |= TypeMask;
+  raycaster.build(model);
+}
 Map &Map::operator=(Map &&other) noexcept {
   if (this != &other) {
     if (model.meshCount > 0)
@@ -61,6 +70,7 @@ Map &Map::operator=(Map &&other) noexcept {
     model = other.model;
     mesh = other.mesh;
     texture = other.texture;
+    raycaster = std::move(other.raycaster);
 
     other.model = {};
     other.mesh = {};
@@ -99,8 +109,10 @@ std::unique_ptr<Map> mapFromHeightmap(const std::string &filename, float width,
   return std::make_unique<Map>(width, height, length, model, mesh, texture);
 }
 
-std::unique_ptr<Map> mapFromModel(const std::string &filename) {
-  auto model = LoadModel(filename.c_str());
+std::unique_ptr<Map> mapFromModel(const std::string &filename,
+                                  bool geometryOnly) {
+  auto model = geometryOnly ? loadModelGeometry(filename)
+                            : LoadModel(filename.c_str());
   // Calcola il bounding box del modello
   BoundingBox bounds = GetModelBoundingBox(model);
 
@@ -159,6 +171,10 @@ void Map::update() {
   if (seaShaderLoaded.id > 0) {
     SetShaderValue(seaShaderLoaded, seaTimeLoc, &hiddenTimeCounter, SHADER_UNIFORM_FLOAT);
   }
+  // Ostacoli accodati (strutture piazzate/rimosse): poche tile per frame
+  if (navMeshBuilt) {
+    navMesh.updateObstacles(navMesh.m_obstacleBudgetMs);
+  }
 };
 
 void Map::buildNavMesh(NavMesh::ProgressCallback progressCallback) {
@@ -167,15 +183,7 @@ void Map::buildNavMesh(NavMesh::ProgressCallback progressCallback) {
     // Percorso file cache
     const std::string cacheFile = "../assets/navmesh.bin";
 
-    // Prova a caricare dalla cache
-    if (navMesh.loadFromFile(cacheFile)) {
-        navMeshBuilt = true;
-        TraceLog(LOG_INFO, "NavMesh: Loaded from cache - %d tiles, %d total polygons",
-                 navMesh.getTileCount(), navMesh.getTotalPolygons());
-        return;
-    }
-
-    // Cache non trovata, genera la navmesh
+    // Parametri adattivi prima della cache: fanno parte del suo hash
     BoundingBox bounds = GetMeshBoundingBox(model.meshes[0]);
     float mapWidth = bounds.max.x - bounds.min.x;
     float mapLength = bounds.max.z - bounds.min.z;
@@ -237,6 +245,16 @@ void Map::buildNavMesh(NavMesh::ProgressCallback progressCallback) {
         TraceLog(LOG_INFO, "NavMesh: Using HUGE map parameters (> 4000)");
     }
 
+    // Prova a caricare dalla cache: valida solo se generata dalla stessa
+    // geometria con gli stessi parametri
+    uint64_t sourceHash = navMesh.computeSourceHash(model.meshes[0], model.transform);
+    if (navMesh.loadFromFile(cacheFile, sourceHash)) {
+        navMeshBuilt = true;
+        TraceLog(LOG_INFO, "NavMesh: Loaded from cache - %d tiles, %d total polygons",
+                 navMesh.getTileCount(), navMesh.getTotalPolygons());
+        return;
+    }
+
     // Costruisci la navmesh tiled
     navMeshBuilt = navMesh.buildTiled(model.meshes[0], model.transform, progressCallback);
 
@@ -253,6 +271,62 @@ void Map::buildNavMesh(NavMesh::ProgressCallback progressCallback) {
     }
 }
 
+void Map::buildHeightfield() {
+    if (model.meshCount == 0) return;
+
+    // Cache accanto a navmesh.bin
+    const std::string cacheFile = "../assets/heightfield.bin";
+
+    if (heightfield.loadFromFile(cacheFile, model, heightfieldCellSize)) {
+        return;
+    }
+
+    if (heightfield.build(model, heightfieldCellSize)) {
+        if (heightfield.saveToFile(cacheFile)) {
+            TraceLog(LOG_INFO, "TerrainHeightfield: Saved to cache file");
+        }
+    } else {
+        TraceLog(LOG_ERROR, "TerrainHeightfield: Build FAILED!");
+    }
+}
+
+void Map::buildShadowChunks() {
+    if (model.meshCount == 0) return;
+    shadowChunks.build(model, shadowChunkSize);
+}
+
+bool Map::getGroundHeight(float x, float z, float &outY) const {
+    if (heightfield.getHeight(x, z, outY)) {
+        return true;
+    }
+
+    // Fuori dalla griglia o campione senza terreno: raycast dall'alto
+    Ray ray;
+    ray.position = {x, raycaster.getBounds().max.y + 1.0f, z};
+    ray.direction = {0.0f, -1.0f, 0.0f};
+    RayCollision hit = raycaster.raycast(ray);
+    if (hit.hit) {
+        outY = hit.point.y;
+    }
+    return hit.hit;
+}
+
+bool Map::getGroundNormal(float x, float z, Vector3 &outNormal) const {
+    if (heightfield.getNormal(x, z, outNormal)) {
+        return true;
+    }
+
+    Ray ray;
+    ray.position = {x, raycaster.getBounds().max.y + 1.0f, z};
+    ray.direction = {0.0f, -1.0f, 0.0f};
+    RayCollision hit = raycaster.raycast(ray);
+    if (hit.hit) {
+        // La normale del triangolo puo' puntare verso il basso
+        outNormal = hit.normal.y < 0.0f ? Vector3Negate(hit.normal) : hit.normal;
+    }
+    return hit.hit;
+}
+
 void Map::drawNavMeshDebug() {
   if (navMeshBuilt) {
     navMesh.drawDebug();
@@ -272,6 +346,21 @@ void Map::gui() {
             ImGui::TextColored(ImVec4(0, 1, 0, 1), "Status: Ready");
             ImGui::Text("Tiles: %d", navMesh.getTileCount());
             ImGui::Text("Total Polygons: %d", navMesh.getTotalPolygons());
+            if (navMesh.getFileRawBytes() > 0) {
+                ImGui::Text("Cache: %d KB -> %d KB (ratio %.2f), decode %.2f ms",
+                            navMesh.getFileRawBytes() / 1024,
+                            navMesh.getFileCompressedBytes() / 1024,
+                            (float)navMesh.getFileCompressedBytes() / navMesh.getFileRawBytes(),
+                            navMesh.getFileDecodeMs());
+            }
+            if (const TileCacheCompressor *tcomp = navMesh.getTileCacheCompressor()) {
+                ImGui::Text("Tile cache layers: ratio %.2f, %d decodes, avg %.3f ms",
+                            tcomp->getCompressionRatio(), tcomp->decodeCount.load(),
+                            tcomp->getAverageDecodeMs());
+            }
+            ImGui::Text("Obstacles: %d pending, %d tile rebuilds, last update %.2f ms",
+                        navMesh.getPendingObstacleCount(), navMesh.getRebuiltTileCount(),
+                        navMesh.getLastObstacleUpdateMs());
             ImGui::Checkbox("Show NavMesh Debug", &showNavMeshDebug);
             ImGui::Checkbox("Show Path", &showPath);
         } else {
@@ -287,6 +376,9 @@ void Map::gui() {
         ImGui::SliderFloat("Cell Size", &navMesh.m_cellSize, 0.1f, 5.0f);
         ImGui::SliderFloat("Cell Height", &navMesh.m_cellHeight, 0.1f, 2.0f);
         ImGui::SliderFloat("Tile Size", &navMesh.m_tileSize, 16.0f, 512.0f);
+        ImGui::SliderInt("Build Threads (0 = auto)", &navMesh.m_buildThreads, 0, 32);
+        ImGui::Checkbox("Compress Cache (LZ4)", &navMesh.m_compressCache);
+        ImGui::SliderFloat("Obstacle Budget (ms/frame)", &navMesh.m_obstacleBudgetMs, 0.1f, 8.0f);
         ImGui::Separator();
         ImGui::SliderFloat("Agent Radius", &navMesh.m_agentRadius, 0.2f, 5.0f);
         ImGui::SliderFloat("Agent Height", &navMesh.m_agentHeight, 1.0f, 10.0f);
@@ -295,8 +387,9 @@ void Map::gui() {
         ImGui::Spacing();
 
         if (ImGui::Button("Rebuild NavMesh (Clear Cache)")) {
-            // Elimina il file cache
+            // Elimina il file cache (prima il mapping della navmesh caricata)
             const std::string cacheFile = "../assets/navmesh.bin";
+            navMesh.unload();
             std::remove(cacheFile.c_str());
             TraceLog(LOG_INFO, "NavMesh: Cache file deleted");
 
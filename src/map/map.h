@@ -1,6 +1,9 @@
 #pragma once
 #include "../game/game_object.h"
 #include "../navigation/navmesh.h"
+#include "terrain_heightfield.h"
+#include "terrain_raycaster.h"
+#include "terrain_shadow_chunks.h"
 #include "rlgl.h"
 #include <raylib.h>
 #include <functional>
@@ -8,11 +11,31 @@
 namespace moiras {
 class Map : public GameObject {
 public:
+  static constexpr unsigned int TypeMask = OBJECT_MAP;
+
   void buildNavMesh(NavMesh::ProgressCallback progressCallback = nullptr);
+  void buildHeightfield();
+  // Chunk del terreno per il culling per cascata nello shadow pass (GPU)
+  void buildShadowChunks();
   void drawNavMeshDebug();
 
+  // Altezza del terreno in (x, z): heightfield se disponibile, altrimenti
+  // raycast verticale sulla BVH
+  bool getGroundHeight(float x, float z, float &outY) const;
+  bool getGroundNormal(float x, float z, Vector3 &outNormal) const;
+
 NavMesh navMesh;
 bool navMeshBuilt = false;
+
+// BVH sui triangoli di model per picking e snap al terreno
+TerrainRaycaster raycaster;
+// Griglia di altezze per gli snap verticali (cache su disco)
+TerrainHeightfield heightfield;
+float heightfieldCellSize = 0.5f;
+// Geometria del terreno a chunk per lo shadow pass, in world space a meno
+// di position
+TerrainShadowChunks shadowChunks;
+float shadowChunkSize = 64.0f;
 bool showNavMeshDebug = false;
 
 // Pathfinding debug
@@ -20,10 +43,10 @@ bool showPath = true;
 Vector3 pathStart = {0, 0, 0};
 Vector3 pathEnd = {10, 0, 10};
 std::vector<Vector3> debugPath;
-  Shader seaShaderLoaded;
+  Shader seaShaderLoaded = {0};
   float hiddenTimeCounter = 0;
-  Image perlinNoiseImage;
-  Texture perlinNoiseMap;
+  Image perlinNoiseImage = {0};
+  Texture perlinNoiseMap = {0};
 
   // Sea shader uniform locations
   int seaTimeLoc = -1;
@@ -43,15 +66,15 @@ std::vector<Vector3> debugPath;
   float length;
   Vector3 position = {0., 0., 0.};
   Model model;
-  Mesh mesh;
-  Texture texture;
+  Mesh mesh = {0};
+  Texture texture = {0};
   std::string seaShaderVertex;
   std::string seaShaderFragment;
-  Mesh seaMesh;
-  Model seaModel;
-  Model skyboxModel;
-  Shader skyboxShader;
-  Texture skyboxTexture;
+  Mesh seaMesh = {0};
+  Model seaModel = {0};
+  Model skyboxModel = {0};
+  Shader skyboxShader = {0};
+  Texture skyboxTexture = {0};
   std::string skyboxShaderVertex;
   std::string skyboxShaderFragment;
   Map();
@@ -74,6 +97,8 @@ std::vector<Vector3> debugPath;
 };
 std::unique_ptr<Map> mapFromHeightmap(const std::string &filename, float width,
                                       float height, float lenght);
-std::unique_ptr<Map> mapFromModel(const std::string &filename);
+// geometryOnly: carica solo i triangoli senza risorse GPU (headless)
+std::unique_ptr<Map> mapFromModel(const std::string &filename,
+                                  bool geometryOnly = false);
 
 } // namespace moiras
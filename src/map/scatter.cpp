@@ -0,0 +1,181 @@
+#include "scatter.h"
+#include "../jobs/job_system.h"
+#include "../profiler/profiler.h"
+#include "map.h"
+#include <algorithm>
+#include <cmath>
+
+namespace moiras {
+
+// Oltre questo numero di celle la spaziatura minima viene allargata
+static const long long MAX_SCATTER_CELLS = 1 << 22;
+// Distanza in celle da controllare con celle di lato minSpacing / sqrt(2)
+static const int POISSON_REACH = 2;
+static const int POISSON_PHASES = 2 * POISSON_REACH + 1;
+
+// Finalizzatore di splitmix64
+static uint64_t mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+float scatterRandom(uint64_t seed, uint32_t index, uint32_t channel) {
+  uint64_t counter = ((uint64_t)index << 8) | (channel & 0xFF);
+  uint64_t h = mix64(seed ^ mix64(counter + 0x9E3779B97F4A7C15ULL));
+  // 24 bit alti: float esatto in [0, 1)
+  return (float)(h >> 40) * (1.0f / 16777216.0f);
+}
+
+std::vector<ScatterPoint> scatterPoints(const Map &terrain, const ScatterArea &area,
+                                        int count, uint64_t seed,
+                                        const ScatterRules &rules,
+                                        const std::function<bool(Vector3)> &reject) {
+  std::vector<ScatterPoint> result;
+  if (count <= 0 || area.halfSize.x <= 0.0f || area.halfSize.y <= 0.0f)
+    return result;
+  PROFILE_SCOPE("scatterPoints");
+  JobSystem &jobs = JobSystem::getInstance();
+
+  // 1. Candidati: posizione, terreno e regole, indipendenti tra loro
+  const float minSlopeY = cosf(fminf(rules.maxSlope, 90.0f) * DEG2RAD);
+  std::vector<ScatterPoint> candidates(count);
+  std::vector<uint8_t> valid(count, 0);
+  jobs.parallel_for(count, 512, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      float u = scatterRandom(seed, (uint32_t)i, SCATTER_X);
+      float v = scatterRandom(seed, (uint32_t)i, SCATTER_Z);
+      float x, z;
+      if (area.circular) {
+        float angle = u * 2.0f * PI;
+        float dist = sqrtf(v) * area.halfSize.x;
+        x = area.center.x + cosf(angle) * dist;
+        z = area.center.y + sinf(angle) * dist;
+      } else {
+        x = area.center.x + (u * 2.0f - 1.0f) * area.halfSize.x;
+        z = area.center.y + (v * 2.0f - 1.0f) * area.halfSize.y;
+      }
+
+      float y = 0.0f;
+      if (!terrain.getGroundHeight(x, z, y))
+        continue;
+      if (y < rules.minHeight || y > rules.maxHeight)
+        continue;
+      if (rules.maxSlope < 90.0f) {
+        Vector3 normal;
+        if (terrain.getGroundNormal(x, z, normal) && normal.y < minSlopeY)
+          continue;
+      }
+      if (reject && reject({x, y, z}))
+        continue;
+
+      candidates[i] = {{x, y, z}, (uint32_t)i};
+      valid[i] = 1;
+    }
+  });
+
+  if (rules.minSpacing <= 0.0f) {
+    for (int i = 0; i < count; i++) {
+      if (valid[i])
+        result.push_back(candidates[i]);
+    }
+    return result;
+  }
+
+  // 2. Poisson disk: celle di lato r / sqrt(2), al piu' un punto per cella
+  const float minX = area.center.x - area.halfSize.x;
+  const float minZ = area.center.y - area.halfSize.y;
+  const float width = area.halfSize.x * 2.0f;
+  const float depth = area.halfSize.y * 2.0f;
+  float spacing = rules.minSpacing;
+  float cellSize = spacing / sqrtf(2.0f);
+  if ((double)(width / cellSize) * (depth / cellSize) > (double)MAX_SCATTER_CELLS) {
+    cellSize = sqrtf(width * depth / (float)MAX_SCATTER_CELLS);
+    spacing = cellSize * sqrtf(2.0f);
+  }
+  const int gridW = std::max(1, (int)ceilf(width / cellSize));
+  const int gridD = std::max(1, (int)ceilf(depth / cellSize));
+  const int cellCount = gridW * gridD;
+  auto cellOf = [&](const Vector3 &p) {
+    int cx = std::min(gridW - 1, std::max(0, (int)((p.x - minX) / cellSize)));
+    int cz = std::min(gridD - 1, std::max(0, (int)((p.z - minZ) / cellSize)));
+    return cz * gridW + cx;
+  };
+
+  // Candidati validi per cella in ordine di indice (counting sort)
+  std::vector<int> cellStart(cellCount + 1, 0);
+  for (int i = 0; i < count; i++) {
+    if (valid[i])
+      cellStart[cellOf(candidates[i].position) + 1]++;
+  }
+  for (int c = 0; c < cellCount; c++)
+    cellStart[c + 1] += cellStart[c];
+  std::vector<int> cellCandidates(cellStart[cellCount]);
+  {
+    std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for (int i = 0; i < count; i++) {
+      if (valid[i])
+        cellCandidates[fill[cellOf(candidates[i].position)]++] = i;
+    }
+  }
+
+  // Celle non vuote per fase (cx % 5, cz % 5)
+  std::vector<int> phaseCells[POISSON_PHASES * POISSON_PHASES];
+  for (int c = 0; c < cellCount; c++) {
+    if (cellStart[c] == cellStart[c + 1])
+      continue;
+    int cx = c % gridW;
+    int cz = c / gridW;
+    phaseCells[(cz % POISSON_PHASES) * POISSON_PHASES + cx % POISSON_PHASES].push_back(c);
+  }
+
+  // Una cella legge le vicine entro POISSON_REACH e scrive solo se stessa:
+  // due celle della stessa fase distano almeno POISSON_PHASES celle
+  const float spacing2 = spacing * spacing;
+  std::vector<int> accepted(cellCount, -1);
+  for (const auto &cells : phaseCells) {
+    jobs.parallel_for((int)cells.size(), 256, [&](int begin, int end) {
+      for (int k = begin; k < end; k++) {
+        const int c = cells[k];
+        const int cx = c % gridW;
+        const int cz = c / gridW;
+        for (int j = cellStart[c]; j < cellStart[c + 1]; j++) {
+          const Vector3 &p = candidates[cellCandidates[j]].position;
+          bool free = true;
+          for (int nz = std::max(0, cz - POISSON_REACH);
+               free && nz <= std::min(gridD - 1, cz + POISSON_REACH); nz++) {
+            for (int nx = std::max(0, cx - POISSON_REACH);
+                 nx <= std::min(gridW - 1, cx + POISSON_REACH); nx++) {
+              int other = accepted[nz * gridW + nx];
+              if (other < 0)
+                continue;
+              float dx = candidates[other].position.x - p.x;
+              float dz = candidates[other].position.z - p.z;
+              if (dx * dx + dz * dz < spacing2) {
+                free = false;
+                break;
+              }
+            }
+          }
+          if (free) {
+            accepted[c] = cellCandidates[j];
+            break;
+          }
+        }
+      }
+    });
+  }
+
+  for (int c = 0; c < cellCount; c++) {
+    if (accepted[c] >= 0)
+      result.push_back(candidates[accepted[c]]);
+  }
+  std::sort(result.begin(), result.end(),
+            [](const ScatterPoint &a, const ScatterPoint &b) { return a.index < b.index; });
+  return result;
+}
+
+} // namespace moiras
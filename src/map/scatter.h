@@ -0,0 +1,54 @@
+#pragma once
+#include <raylib.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace moiras {
+
+class Map;
+
+// Regole di piazzamento sul terreno
+struct ScatterRules {
+  float minSpacing = 0.0f; // distanza XZ minima (Poisson disk), 0 = nessuna
+  float minHeight = 0.5f;  // sotto: mare
+  float maxHeight = 1000.0f;
+  float maxSlope = 90.0f;  // gradi tra normale del terreno e verticale
+};
+
+// Rettangolo (halfSize) o disco di raggio halfSize.x attorno a center (XZ)
+struct ScatterArea {
+  Vector2 center;
+  Vector2 halfSize;
+  bool circular;
+};
+
+struct ScatterPoint {
+  Vector3 position; // sul terreno
+  uint32_t index;   // indice del candidato, per scatterRandom
+};
+
+// Canali di scatterRandom usati dai candidati; i chiamanti usano i canali
+// da SCATTER_USER in poi per gli attributi dell'istanza
+enum ScatterChannel : uint32_t {
+  SCATTER_X = 0,
+  SCATTER_Z,
+  SCATTER_USER
+};
+
+// RNG counter-based: [0, 1) funzione solo di (seed, index, channel), quindi
+// identico su qualsiasi thread e in qualsiasi ordine
+float scatterRandom(uint64_t seed, uint32_t index, uint32_t channel);
+
+// Genera i candidati [0, count) nell'area, li filtra con le regole (e con
+// reject, chiamata in parallelo: deve essere di sola lettura) e li dirada a
+// minSpacing. Valutazione dei candidati in parallelo sul JobSystem, poi
+// Poisson disk su griglia a 25 fasi: le celle della stessa fase non si
+// vedono e vengono processate in parallelo. Il risultato, ordinato per
+// indice, dipende solo dal seed e non dal numero di thread.
+std::vector<ScatterPoint> scatterPoints(const Map &terrain, const ScatterArea &area,
+                                        int count, uint64_t seed,
+                                        const ScatterRules &rules,
+                                        const std::function<bool(Vector3)> &reject = nullptr);
+
+} // namespace moiras
@@ -0,0 +1,281 @@
+#include "terrain_heightfield.h"
+#include "../jobs/job_system.h"
+#include <raymath.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+
+namespace moiras {
+
+static const int HEIGHTFIELD_FILE_MAGIC = 0x4D484643; // 'MHFC' in hex
+static const int HEIGHTFIELD_FILE_VERSION = 2;
+// Valore per i campioni senza terreno sotto
+static const float NO_HEIGHT = -FLT_MAX;
+
+// FNV-1a a 64 bit (come NavMesh::computeSourceHash)
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Vertici, indici e transform del modello piu' i parametri della griglia:
+// identifica la cache valida per questo terreno
+static uint64_t sourceHash(const Model &model, float cellSize, int maxSamples) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  hash = hashBytes(hash, &HEIGHTFIELD_FILE_VERSION, sizeof(int));
+  hash = hashBytes(hash, &cellSize, sizeof(float));
+  hash = hashBytes(hash, &maxSamples, sizeof(int));
+  hash = hashBytes(hash, &model.transform, sizeof(Matrix));
+  for (int m = 0; m < model.meshCount; m++) {
+    const Mesh &mesh = model.meshes[m];
+    hash = hashBytes(hash, &mesh.vertexCount, sizeof(int));
+    hash = hashBytes(hash, &mesh.triangleCount, sizeof(int));
+    if (mesh.vertices)
+      hash = hashBytes(hash, mesh.vertices, sizeof(float) * 3 * mesh.vertexCount);
+    if (mesh.indices)
+      hash = hashBytes(hash, mesh.indices,
+                       sizeof(unsigned short) * 3 * mesh.triangleCount);
+  }
+  return hash;
+}
+
+void TerrainHeightfield::clear() {
+  m_heights.clear();
+  m_width = 0;
+  m_depth = 0;
+  m_sourceHash = 0;
+}
+
+bool TerrainHeightfield::build(const Model &model, float cellSize,
+                               int maxSamples) {
+  clear();
+  if (model.meshCount == 0 || cellSize <= 0.0f)
+    return false;
+
+  double startTime = GetTime();
+  m_sourceHash = sourceHash(model, cellSize, maxSamples);
+  m_requestedCellSize = cellSize;
+
+  // Bounds in world space dai vertici trasformati
+  Vector3 bmin = {FLT_MAX, FLT_MAX, FLT_MAX};
+  Vector3 bmax = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  std::vector<Vector3> world;
+  std::vector<int> tris;
+  for (int m = 0; m < model.meshCount; m++) {
+    const Mesh &mesh = model.meshes[m];
+    if (!mesh.vertices)
+      continue;
+    int base = (int)world.size();
+    for (int v = 0; v < mesh.vertexCount; v++) {
+      const float *p = &mesh.vertices[v * 3];
+      Vector3 w = Vector3Transform({p[0], p[1], p[2]}, model.transform);
+      bmin = Vector3Min(bmin, w);
+      bmax = Vector3Max(bmax, w);
+      world.push_back(w);
+    }
+    for (int t = 0; t < mesh.triangleCount * 3; t++) {
+      tris.push_back(base + (mesh.indices ? mesh.indices[t] : t));
+    }
+  }
+  if (tris.empty())
+    return false;
+
+  // Adatta il passo se la griglia supererebbe maxSamples per lato
+  float extent = fmaxf(bmax.x - bmin.x, bmax.z - bmin.z);
+  m_cellSize = fmaxf(cellSize, extent / (float)(maxSamples - 1));
+  m_originX = bmin.x;
+  m_originZ = bmin.z;
+  m_width = (int)floorf((bmax.x - bmin.x) / m_cellSize) + 2;
+  m_depth = (int)floorf((bmax.z - bmin.z) / m_cellSize) + 2;
+  m_heights.assign((size_t)m_width * m_depth, NO_HEIGHT);
+
+  // Rasterizzazione: per ogni campione dentro la proiezione XZ del triangolo
+  // interpola l'altezza e tiene la piu' alta. Le righe sono divise in fasce
+  // indipendenti fra i worker del JobSystem; ogni fascia scrive solo le sue.
+  const float invCell = 1.0f / m_cellSize;
+  auto rasterizeRows = [&](int rowBegin, int rowEnd) {
+    for (size_t t = 0; t + 2 < tris.size(); t += 3) {
+      const Vector3 &a = world[tris[t]];
+      const Vector3 &b = world[tris[t + 1]];
+      const Vector3 &c = world[tris[t + 2]];
+
+      int iz0 = std::max(rowBegin, (int)ceilf((fminf(a.z, fminf(b.z, c.z)) - m_originZ) * invCell));
+      int iz1 = std::min(rowEnd - 1, (int)floorf((fmaxf(a.z, fmaxf(b.z, c.z)) - m_originZ) * invCell));
+      if (iz0 > iz1)
+        continue;
+
+      float d = (b.z - c.z) * (a.x - c.x) + (c.x - b.x) * (a.z - c.z);
+      if (fabsf(d) < 1e-8f)
+        continue; // Triangolo verticale: non contribuisce all'altezza
+      float invD = 1.0f / d;
+
+      int ix0 = std::max(0, (int)ceilf((fminf(a.x, fminf(b.x, c.x)) - m_originX) * invCell));
+      int ix1 = std::min(m_width - 1, (int)floorf((fmaxf(a.x, fmaxf(b.x, c.x)) - m_originX) * invCell));
+
+      for (int iz = iz0; iz <= iz1; iz++) {
+        float pz = m_originZ + iz * m_cellSize;
+        for (int ix = ix0; ix <= ix1; ix++) {
+          float px = m_originX + ix * m_cellSize;
+          float w0 = ((b.z - c.z) * (px - c.x) + (c.x - b.x) * (pz - c.z)) * invD;
+          float w1 = ((c.z - a.z) * (px - c.x) + (a.x - c.x) * (pz - c.z)) * invD;
+          float w2 = 1.0f - w0 - w1;
+          const float eps = -1e-5f;
+          if (w0 < eps || w1 < eps || w2 < eps)
+            continue;
+
+          float y = w0 * a.y + w1 * b.y + w2 * c.y;
+          float &h = m_heights[iz * m_width + ix];
+          if (y > h)
+            h = y;
+        }
+      }
+    }
+  };
+  // Fasce larghe: ogni fascia riscorre tutti i triangoli
+  JobSystem &jobs = JobSystem::getInstance();
+  int bandRows = std::max(16, (m_depth + jobs.getConcurrency() - 1) /
+                                  jobs.getConcurrency());
+  jobs.parallel_for(m_depth, bandRows, rasterizeRows);
+
+  TraceLog(LOG_INFO,
+           "TerrainHeightfield: Built %dx%d grid (cell %.2f) in %.1f ms",
+           m_width, m_depth, m_cellSize, (GetTime() - startTime) * 1000.0);
+  return true;
+}
+
+bool TerrainHeightfield::getHeight(float x, float z, float &outY) const {
+  if (m_heights.empty())
+    return false;
+
+  float fx = (x - m_originX) / m_cellSize;
+  float fz = (z - m_originZ) / m_cellSize;
+  if (fx < 0.0f || fz < 0.0f || fx > (float)(m_width - 1) ||
+      fz > (float)(m_depth - 1))
+    return false;
+
+  int ix = std::min((int)fx, m_width - 2);
+  int iz = std::min((int)fz, m_depth - 2);
+  float tx = fx - ix;
+  float tz = fz - iz;
+
+  float h00 = sample(ix, iz);
+  float h10 = sample(ix + 1, iz);
+  float h01 = sample(ix, iz + 1);
+  float h11 = sample(ix + 1, iz + 1);
+  if (h00 == NO_HEIGHT || h10 == NO_HEIGHT || h01 == NO_HEIGHT ||
+      h11 == NO_HEIGHT)
+    return false;
+
+  float h0 = h00 + (h10 - h00) * tx;
+  float h1 = h01 + (h11 - h01) * tx;
+  outY = h0 + (h1 - h0) * tz;
+  return true;
+}
+
+bool TerrainHeightfield::getNormal(float x, float z, Vector3 &outNormal) const {
+  float hl, hr, hd, hu;
+  if (!getHeight(x - m_cellSize, z, hl) || !getHeight(x + m_cellSize, z, hr) ||
+      !getHeight(x, z - m_cellSize, hd) || !getHeight(x, z + m_cellSize, hu))
+    return false;
+
+  outNormal = Vector3Normalize(
+      {hl - hr, 2.0f * m_cellSize, hd - hu});
+  return true;
+}
+
+bool TerrainHeightfield::saveToFile(const std::string &filename) const {
+  if (m_heights.empty())
+    return false;
+
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    TraceLog(LOG_ERROR, "TerrainHeightfield: Cannot open file for writing: %s",
+             filename.c_str());
+    return false;
+  }
+
+  file.write(reinterpret_cast<const char *>(&HEIGHTFIELD_FILE_MAGIC), sizeof(int));
+  file.write(reinterpret_cast<const char *>(&HEIGHTFIELD_FILE_VERSION), sizeof(int));
+  file.write(reinterpret_cast<const char *>(&m_sourceHash), sizeof(uint64_t));
+  file.write(reinterpret_cast<const char *>(&m_requestedCellSize), sizeof(float));
+  file.write(reinterpret_cast<const char *>(&m_width), sizeof(int));
+  file.write(reinterpret_cast<const char *>(&m_depth), sizeof(int));
+  file.write(reinterpret_cast<const char *>(&m_originX), sizeof(float));
+  file.write(reinterpret_cast<const char *>(&m_originZ), sizeof(float));
+  file.write(reinterpret_cast<const char *>(&m_cellSize), sizeof(float));
+  file.write(reinterpret_cast<const char *>(m_heights.data()),
+             sizeof(float) * m_heights.size());
+
+  return file.good();
+}
+
+bool TerrainHeightfield::loadFromFile(const std::string &filename,
+                                      const Model &model, float cellSize,
+                                      int maxSamples) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open())
+    return false;
+
+  int magic = 0, version = 0;
+  file.read(reinterpret_cast<char *>(&magic), sizeof(int));
+  file.read(reinterpret_cast<char *>(&version), sizeof(int));
+  if (magic != HEIGHTFIELD_FILE_MAGIC || version != HEIGHTFIELD_FILE_VERSION) {
+    TraceLog(LOG_WARNING, "TerrainHeightfield: Invalid cache file %s",
+             filename.c_str());
+    return false;
+  }
+
+  uint64_t hash = 0;
+  float requestedCellSize = 0.0f;
+  file.read(reinterpret_cast<char *>(&hash), sizeof(uint64_t));
+  file.read(reinterpret_cast<char *>(&requestedCellSize), sizeof(float));
+
+  // La cache vale solo per lo stesso passo e lo stesso contenuto del modello
+  if (requestedCellSize != cellSize) {
+    TraceLog(LOG_INFO, "TerrainHeightfield: Cache cell size %.3f != %.3f, rebuilding",
+             requestedCellSize, cellSize);
+    return false;
+  }
+  const uint64_t expectedHash = sourceHash(model, cellSize, maxSamples);
+  if (hash != expectedHash) {
+    TraceLog(LOG_INFO, "TerrainHeightfield: Cache is stale, rebuilding");
+    return false;
+  }
+
+  int width = 0, depth = 0;
+  float originX, originZ, gridCellSize;
+  file.read(reinterpret_cast<char *>(&width), sizeof(int));
+  file.read(reinterpret_cast<char *>(&depth), sizeof(int));
+  file.read(reinterpret_cast<char *>(&originX), sizeof(float));
+  file.read(reinterpret_cast<char *>(&originZ), sizeof(float));
+  file.read(reinterpret_cast<char *>(&gridCellSize), sizeof(float));
+  if (!file.good() || width < 2 || depth < 2 || gridCellSize <= 0.0f)
+    return false;
+
+  std::vector<float> heights((size_t)width * depth);
+  file.read(reinterpret_cast<char *>(heights.data()),
+            sizeof(float) * heights.size());
+  if (!file.good())
+    return false;
+
+  m_heights = std::move(heights);
+  m_width = width;
+  m_depth = depth;
+  m_originX = originX;
+  m_originZ = originZ;
+  m_cellSize = gridCellSize;
+  m_sourceHash = hash;
+  m_requestedCellSize = cellSize;
+
+  TraceLog(LOG_INFO, "TerrainHeightfield: Loaded %dx%d grid from %s", m_width,
+           m_depth, filename.c_str());
+  return true;
+}
+
+} // namespace moiras
@@ -0,0 +1,55 @@
+#pragma once
+#include <raylib.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace moiras {
+
+// Cache dell'altezza del terreno su una griglia regolare XZ. Viene
+// rasterizzata una volta dai triangoli della mappa (per ogni campione si tiene
+// la superficie piu' alta, come un raycast verticale dall'alto) e salvata su
+// disco accanto a navmesh.bin. Le query sono letture bilineari O(1).
+class TerrainHeightfield {
+public:
+  // Rasterizza i triangoli del modello (in world space) con passo cellSize.
+  // La griglia viene limitata a maxSamples campioni per lato.
+  bool build(const Model &model, float cellSize, int maxSamples = 2048);
+  void clear();
+
+  // Altezza interpolata in (x, z). false se fuori dalla griglia o se uno dei
+  // campioni vicini non copre terreno.
+  bool getHeight(float x, float z, float &outY) const;
+  // Normale della superficie da differenze centrali sulla griglia.
+  bool getNormal(float x, float z, Vector3 &outNormal) const;
+
+  bool saveToFile(const std::string &filename) const;
+  // Carica la cache solo se e' stata generata con gli stessi cellSize e
+  // maxSamples dallo stesso modello (hash di vertici, indici e transform),
+  // altrimenti ritorna false e va ricostruita.
+  bool loadFromFile(const std::string &filename, const Model &model,
+                    float cellSize, int maxSamples = 2048);
+
+  bool isBuilt() const { return !m_heights.empty(); }
+  int getWidth() const { return m_width; }
+  int getDepth() const { return m_depth; }
+  float getCellSize() const { return m_cellSize; }
+  float getOriginX() const { return m_originX; }
+  float getOriginZ() const { return m_originZ; }
+
+private:
+  std::vector<float> m_heights;
+  int m_width = 0;
+  int m_depth = 0;
+  float m_originX = 0.0f;
+  float m_originZ = 0.0f;
+  float m_cellSize = 1.0f;
+  // Firma del modello sorgente e passo richiesto a build (m_cellSize puo'
+  // essere piu' grande per via di maxSamples), per invalidare la cache
+  uint64_t m_sourceHash = 0;
+  float m_requestedCellSize = 0.0f;
+
+  float sample(int ix, int iz) const { return m_heights[iz * m_width + ix]; }
+};
+
+} // namespace moiras
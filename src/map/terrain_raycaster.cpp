@@ -0,0 +1,390 @@
+#include "terrain_raycaster.h"
+#include <raymath.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace moiras {
+
+namespace {
+
+constexpr int kSahBins = 12;
+constexpr int kMaxLeafTris = 4;
+// Profondita' massima: garantisce che lo stack di traversal non trabocchi
+constexpr int kMaxDepth = 60;
+constexpr int kStackSize = 64;
+// Stessa tolleranza di GetRayCollisionTriangle
+constexpr float kEpsilon = 0.000001f;
+
+inline float axisOf(const Vector3 &v, int axis) {
+  return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+struct Aabb {
+  Vector3 bmin = {FLT_MAX, FLT_MAX, FLT_MAX};
+  Vector3 bmax = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+  void grow(const Vector3 &p) {
+    bmin = Vector3Min(bmin, p);
+    bmax = Vector3Max(bmax, p);
+  }
+  void grow(const Aabb &b) {
+    if (b.bmin.x > b.bmax.x)
+      return;
+    bmin = Vector3Min(bmin, b.bmin);
+    bmax = Vector3Max(bmax, b.bmax);
+  }
+  float area() const {
+    if (bmin.x > bmax.x)
+      return 0.0f;
+    Vector3 e = Vector3Subtract(bmax, bmin);
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+  }
+};
+
+// Slab test. Ritorna la distanza di ingresso o FLT_MAX se il box e' mancato
+// o e' piu' lontano di tMax.
+inline float intersectAabb(const Vector3 &origin, const Vector3 &invDir,
+                           const Vector3 &bmin, const Vector3 &bmax,
+                           float tMax) {
+  float tx1 = (bmin.x - origin.x) * invDir.x;
+  float tx2 = (bmax.x - origin.x) * invDir.x;
+  float tmin = fminf(tx1, tx2), tmax = fmaxf(tx1, tx2);
+  float ty1 = (bmin.y - origin.y) * invDir.y;
+  float ty2 = (bmax.y - origin.y) * invDir.y;
+  tmin = fmaxf(tmin, fminf(ty1, ty2));
+  tmax = fminf(tmax, fmaxf(ty1, ty2));
+  float tz1 = (bmin.z - origin.z) * invDir.z;
+  float tz2 = (bmax.z - origin.z) * invDir.z;
+  tmin = fmaxf(tmin, fminf(tz1, tz2));
+  tmax = fminf(tmax, fmaxf(tz1, tz2));
+  if (tmax >= tmin && tmin < tMax && tmax > 0.0f)
+    return tmin;
+  return FLT_MAX;
+}
+
+// Moller-Trumbore a doppia faccia, come GetRayCollisionTriangle
+inline bool intersectTriangle(const Ray &ray, const Vector3 &v0,
+                              const Vector3 &v1, const Vector3 &v2, float &t) {
+  Vector3 edge1 = Vector3Subtract(v1, v0);
+  Vector3 edge2 = Vector3Subtract(v2, v0);
+  Vector3 p = Vector3CrossProduct(ray.direction, edge2);
+  float det = Vector3DotProduct(edge1, p);
+  if (det > -kEpsilon && det < kEpsilon)
+    return false;
+
+  float invDet = 1.0f / det;
+  Vector3 tv = Vector3Subtract(ray.position, v0);
+  float u = Vector3DotProduct(tv, p) * invDet;
+  if (u < 0.0f || u > 1.0f)
+    return false;
+
+  Vector3 q = Vector3CrossProduct(tv, edge1);
+  float v = Vector3DotProduct(ray.direction, q) * invDet;
+  if (v < 0.0f || u + v > 1.0f)
+    return false;
+
+  t = Vector3DotProduct(edge2, q) * invDet;
+  return t > kEpsilon;
+}
+
+inline Vector3 safeInverse(const Vector3 &d) {
+  // Evita inf*0 = NaN nello slab test per raggi paralleli a un asse
+  auto inv = [](float c) { return 1.0f / (fabsf(c) > 1e-20f ? c : 1e-20f); };
+  return {inv(d.x), inv(d.y), inv(d.z)};
+}
+
+} // namespace
+
+void TerrainRaycaster::clear() {
+  m_tris.clear();
+  m_centroids.clear();
+  m_triIndex.clear();
+  m_nodes.clear();
+  m_nodesUsed = 0;
+  m_bounds = {{0, 0, 0}, {0, 0, 0}};
+}
+
+bool TerrainRaycaster::build(const Model &model) {
+  clear();
+  double startTime = GetTime();
+
+  for (int m = 0; m < model.meshCount; m++) {
+    const Mesh &mesh = model.meshes[m];
+    if (!mesh.vertices)
+      continue;
+
+    for (int t = 0; t < mesh.triangleCount; t++) {
+      int idx[3];
+      for (int k = 0; k < 3; k++) {
+        idx[k] = mesh.indices ? mesh.indices[t * 3 + k] : t * 3 + k;
+      }
+      Vector3 v[3];
+      for (int k = 0; k < 3; k++) {
+        const float *p = &mesh.vertices[idx[k] * 3];
+        v[k] = Vector3Transform({p[0], p[1], p[2]}, model.transform);
+      }
+      m_tris.push_back({v[0], v[1], v[2]});
+    }
+  }
+
+  const int triCount = (int)m_tris.size();
+  if (triCount == 0) {
+    TraceLog(LOG_WARNING, "TerrainRaycaster: Model has no triangles");
+    return false;
+  }
+
+  m_centroids.resize(triCount);
+  for (int i = 0; i < triCount; i++) {
+    const Triangle &tri = m_tris[i];
+    m_centroids[i] =
+        Vector3Scale(Vector3Add(Vector3Add(tri.v0, tri.v1), tri.v2), 1.0f / 3.0f);
+  }
+  m_triIndex.resize(triCount);
+  std::iota(m_triIndex.begin(), m_triIndex.end(), 0);
+
+  // Un albero binario con n foglie ha al massimo 2n - 1 nodi
+  m_nodes.resize(2 * triCount - 1);
+  TerrainBVHNode &root = m_nodes[0];
+  root.first = 0;
+  root.count = triCount;
+  m_nodesUsed = 1;
+  updateNodeBounds(root);
+  subdivide(0, 0);
+
+  m_bounds = {m_nodes[0].bmin, m_nodes[0].bmax};
+  m_nodes.resize(m_nodesUsed);
+  m_nodes.shrink_to_fit();
+  // I centroidi servono solo durante il build
+  m_centroids.clear();
+  m_centroids.shrink_to_fit();
+
+  TraceLog(LOG_INFO,
+           "TerrainRaycaster: BVH built (%d triangles, %d nodes) in %.1f ms",
+           triCount, m_nodesUsed, (GetTime() - startTime) * 1000.0);
+  return true;
+}
+
+void TerrainRaycaster::updateNodeBounds(TerrainBVHNode &node) const {
+  Aabb box;
+  for (int i = 0; i < node.count; i++) {
+    const Triangle &tri = m_tris[m_triIndex[node.first + i]];
+    box.grow(tri.v0);
+    box.grow(tri.v1);
+    box.grow(tri.v2);
+  }
+  node.bmin = box.bmin;
+  node.bmax = box.bmax;
+}
+
+float TerrainRaycaster::findBestSplit(const TerrainBVHNode &node, int &axis,
+                                      float &splitPos) const {
+  float bestCost = FLT_MAX;
+
+  for (int a = 0; a < 3; a++) {
+    // Bin sui centroidi, non sui bounds dei triangoli
+    float cmin = FLT_MAX, cmax = -FLT_MAX;
+    for (int i = 0; i < node.count; i++) {
+      float c = axisOf(m_centroids[m_triIndex[node.first + i]], a);
+      cmin = fminf(cmin, c);
+      cmax = fmaxf(cmax, c);
+    }
+    if (cmin == cmax)
+      continue;
+
+    Aabb bins[kSahBins];
+    int counts[kSahBins] = {0};
+    float scale = kSahBins / (cmax - cmin);
+    for (int i = 0; i < node.count; i++) {
+      int ti = m_triIndex[node.first + i];
+      int b = std::min(kSahBins - 1,
+                       (int)((axisOf(m_centroids[ti], a) - cmin) * scale));
+      counts[b]++;
+      bins[b].grow(m_tris[ti].v0);
+      bins[b].grow(m_tris[ti].v1);
+      bins[b].grow(m_tris[ti].v2);
+    }
+
+    // Sweep da sinistra e da destra per le aree dei piani candidati
+    float leftArea[kSahBins - 1], rightArea[kSahBins - 1];
+    int leftCount[kSahBins - 1], rightCount[kSahBins - 1];
+    Aabb leftBox, rightBox;
+    int leftSum = 0, rightSum = 0;
+    for (int i = 0; i < kSahBins - 1; i++) {
+      leftSum += counts[i];
+      leftCount[i] = leftSum;
+      leftBox.grow(bins[i]);
+      leftArea[i] = leftBox.area();
+
+      rightSum += counts[kSahBins - 1 - i];
+      rightCount[kSahBins - 2 - i] = rightSum;
+      rightBox.grow(bins[kSahBins - 1 - i]);
+      rightArea[kSahBins - 2 - i] = rightBox.area();
+    }
+
+    float binWidth = (cmax - cmin) / kSahBins;
+    for (int i = 0; i < kSahBins - 1; i++) {
+      float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+      if (cost > 0.0f && cost < bestCost) {
+        axis = a;
+        splitPos = cmin + binWidth * (i + 1);
+        bestCost = cost;
+      }
+    }
+  }
+
+  return bestCost;
+}
+
+void TerrainRaycaster::subdivide(int nodeIdx, int depth) {
+  TerrainBVHNode &node = m_nodes[nodeIdx];
+  if (node.count <= kMaxLeafTris || depth >= kMaxDepth)
+    return;
+
+  int axis = 0;
+  float splitPos = 0.0f;
+  float splitCost = findBestSplit(node, axis, splitPos);
+
+  // Costo SAH della foglia: conviene dividere solo se e' piu' economico
+  Aabb parent;
+  parent.bmin = node.bmin;
+  parent.bmax = node.bmax;
+  if (splitCost >= node.count * parent.area())
+    return;
+
+  // Partizione in-place degli indici rispetto al piano di split
+  int i = node.first;
+  int j = i + node.count - 1;
+  while (i <= j) {
+    if (axisOf(m_centroids[m_triIndex[i]], axis) < splitPos)
+      i++;
+    else
+      std::swap(m_triIndex[i], m_triIndex[j--]);
+  }
+
+  int leftCount = i - node.first;
+  if (leftCount == 0 || leftCount == node.count)
+    return;
+
+  int left = m_nodesUsed++;
+  int right = m_nodesUsed++;
+  m_nodes[left].first = node.first;
+  m_nodes[left].count = leftCount;
+  m_nodes[right].first = i;
+  m_nodes[right].count = node.count - leftCount;
+  node.first = left;
+  node.count = 0;
+
+  updateNodeBounds(m_nodes[left]);
+  updateNodeBounds(m_nodes[right]);
+  subdivide(left, depth + 1);
+  subdivide(right, depth + 1);
+}
+
+RayCollision TerrainRaycaster::raycast(Ray ray, float maxDistance) const {
+  RayCollision result = {0};
+  result.hit = false;
+  if (m_nodes.empty())
+    return result;
+
+  const Vector3 invDir = safeInverse(ray.direction);
+  float bestT = maxDistance;
+  int bestTri = -1;
+
+  if (intersectAabb(ray.position, invDir, m_nodes[0].bmin, m_nodes[0].bmax,
+                    bestT) == FLT_MAX)
+    return result;
+
+  int stack[kStackSize];
+  int sp = 0;
+  int nodeIdx = 0;
+
+  for (;;) {
+    const TerrainBVHNode &node = m_nodes[nodeIdx];
+
+    if (node.count > 0) {
+      for (int i = 0; i < node.count; i++) {
+        int ti = m_triIndex[node.first + i];
+        const Triangle &tri = m_tris[ti];
+        float t;
+        if (intersectTriangle(ray, tri.v0, tri.v1, tri.v2, t) && t < bestT) {
+          bestT = t;
+          bestTri = ti;
+        }
+      }
+      if (sp == 0)
+        break;
+      nodeIdx = stack[--sp];
+      continue;
+    }
+
+    // Visita prima il figlio piu' vicino, l'altro va sullo stack
+    int nearChild = node.first;
+    int farChild = node.first + 1;
+    float dNear = intersectAabb(ray.position, invDir, m_nodes[nearChild].bmin,
+                                m_nodes[nearChild].bmax, bestT);
+    float dFar = intersectAabb(ray.position, invDir, m_nodes[farChild].bmin,
+                               m_nodes[farChild].bmax, bestT);
+    if (dNear > dFar) {
+      std::swap(dNear, dFar);
+      std::swap(nearChild, farChild);
+    }
+
+    if (dNear == FLT_MAX) {
+      if (sp == 0)
+        break;
+      nodeIdx = stack[--sp];
+    } else {
+      nodeIdx = nearChild;
+      if (dFar != FLT_MAX)
+        stack[sp++] = farChild;
+    }
+  }
+
+  if (bestTri >= 0) {
+    const Triangle &tri = m_tris[bestTri];
+    result.hit = true;
+    result.distance = bestT;
+    result.point = Vector3Add(ray.position, Vector3Scale(ray.direction, bestT));
+    result.normal = Vector3Normalize(Vector3CrossProduct(
+        Vector3Subtract(tri.v1, tri.v0), Vector3Subtract(tri.v2, tri.v0)));
+  }
+
+  return result;
+}
+
+bool TerrainRaycaster::raycastAny(Ray ray, float maxDistance) const {
+  if (m_nodes.empty())
+    return false;
+
+  const Vector3 invDir = safeInverse(ray.direction);
+
+  int stack[kStackSize];
+  int sp = 0;
+  stack[sp++] = 0;
+
+  while (sp > 0) {
+    const TerrainBVHNode &node = m_nodes[stack[--sp]];
+    if (intersectAabb(ray.position, invDir, node.bmin, node.bmax,
+                      maxDistance) == FLT_MAX)
+      continue;
+
+    if (node.count > 0) {
+      for (int i = 0; i < node.count; i++) {
+        const Triangle &tri = m_tris[m_triIndex[node.first + i]];
+        float t;
+        if (intersectTriangle(ray, tri.v0, tri.v1, tri.v2, t) &&
+            t < maxDistance)
+          return true;
+      }
+      continue;
+    }
+
+    stack[sp++] = node.first;
+    stack[sp++] = node.first + 1;
+  }
+
+  return false;
+}
+
+} // namespace moiras
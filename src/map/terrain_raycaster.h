@@ -0,0 +1,58 @@
+#pragma once
+#include <raylib.h>
+#include <cfloat>
+#include <vector>
+
+namespace moiras {
+
+// Nodo della BVH (32 byte). Se count > 0 e' una foglia e first indicizza
+// m_triIndex; altrimenti first e' l'indice del figlio sinistro e il destro
+// e' first + 1.
+struct TerrainBVHNode {
+  Vector3 bmin;
+  int first;
+  Vector3 bmax;
+  int count;
+};
+
+// Servizio di ray query contro la geometria della mappa. Costruisce una sola
+// volta (al caricamento) una BVH con split SAH sui triangoli del Model in
+// world space, cosi' picking, snap al terreno e piazzamento rocce costano
+// O(log n) invece di una scansione completa di ogni mesh.
+class TerrainRaycaster {
+public:
+  // Copia i triangoli del modello (trasformati con model.transform) e
+  // costruisce la BVH. Ritorna false se il modello non ha triangoli.
+  bool build(const Model &model);
+  void clear();
+
+  // Closest hit: stesso contratto di GetRayCollisionMesh (distance e' il
+  // parametro t lungo ray.direction, normal e' la normale del triangolo).
+  RayCollision raycast(Ray ray, float maxDistance = FLT_MAX) const;
+  // Any hit: si ferma al primo triangolo colpito entro maxDistance.
+  bool raycastAny(Ray ray, float maxDistance = FLT_MAX) const;
+
+  bool isBuilt() const { return !m_nodes.empty(); }
+  BoundingBox getBounds() const { return m_bounds; }
+  int getTriangleCount() const { return (int)m_triIndex.size(); }
+  int getNodeCount() const { return m_nodesUsed; }
+
+private:
+  struct Triangle {
+    Vector3 v0, v1, v2;
+  };
+
+  std::vector<Triangle> m_tris;
+  std::vector<Vector3> m_centroids;
+  std::vector<int> m_triIndex;
+  std::vector<TerrainBVHNode> m_nodes;
+  int m_nodesUsed = 0;
+  BoundingBox m_bounds = {{0, 0, 0}, {0, 0, 0}};
+
+  void updateNodeBounds(TerrainBVHNode &node) const;
+  float findBestSplit(const TerrainBVHNode &node, int &axis,
+                      float &splitPos) const;
+  void subdivide(int nodeIdx, int depth);
+};
+
+} // namespace moiras
@@ -0,0 +1,109 @@
+#include "terrain_shadow_chunks.h"
+#include <raymath.h>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace moiras {
+
+// Indici a 16 bit: un chunk con piu' vertici viene spezzato in piu' mesh
+static const int MAX_CHUNK_VERTICES = 65535;
+
+void TerrainShadowChunks::unload() {
+  for (auto &chunk : m_chunks) {
+    UnloadMesh(chunk.mesh);
+  }
+  m_chunks.clear();
+}
+
+bool TerrainShadowChunks::build(const Model &model, float chunkSize) {
+  unload();
+  if (model.meshCount == 0 || chunkSize <= 0.0f)
+    return false;
+
+  double startTime = GetTime();
+  const float invChunk = 1.0f / chunkSize;
+  int sourceTris = 0;
+
+  for (int m = 0; m < model.meshCount; m++) {
+    const Mesh &src = model.meshes[m];
+    if (!src.vertices || src.triangleCount == 0)
+      continue;
+    sourceTris += src.triangleCount;
+
+    std::vector<Vector3> world(src.vertexCount);
+    for (int v = 0; v < src.vertexCount; v++) {
+      const float *p = &src.vertices[v * 3];
+      world[v] = Vector3Transform({p[0], p[1], p[2]}, model.transform);
+    }
+    auto vertexIndex = [&](int t) {
+      return src.indices ? (int)src.indices[t] : t;
+    };
+
+    // Triangoli per chunk in base al baricentro
+    std::unordered_map<long long, std::vector<int>> bins;
+    for (int t = 0; t < src.triangleCount; t++) {
+      Vector3 a = world[vertexIndex(t * 3)];
+      Vector3 b = world[vertexIndex(t * 3 + 1)];
+      Vector3 c = world[vertexIndex(t * 3 + 2)];
+      int cx = (int)floorf((a.x + b.x + c.x) * (1.0f / 3.0f) * invChunk);
+      int cz = (int)floorf((a.z + b.z + c.z) * (1.0f / 3.0f) * invChunk);
+      long long key = ((long long)cx << 32) | (unsigned int)cz;
+      bins[key].push_back(t);
+    }
+
+    // Remap vertice sorgente -> vertice del chunk, azzerato dopo ogni mesh
+    std::vector<int> remap(src.vertexCount, -1);
+    std::vector<int> used;
+    std::vector<float> vertices;
+    std::vector<unsigned short> indices;
+
+    auto flush = [&]() {
+      if (indices.empty())
+        return;
+      Chunk chunk;
+      chunk.mesh.vertexCount = (int)(vertices.size() / 3);
+      chunk.mesh.triangleCount = (int)(indices.size() / 3);
+      chunk.mesh.vertices = (float *)RL_MALLOC(vertices.size() * sizeof(float));
+      memcpy(chunk.mesh.vertices, vertices.data(), vertices.size() * sizeof(float));
+      chunk.mesh.indices = (unsigned short *)RL_MALLOC(indices.size() * sizeof(unsigned short));
+      memcpy(chunk.mesh.indices, indices.data(), indices.size() * sizeof(unsigned short));
+      UploadMesh(&chunk.mesh, false);
+      chunk.bounds = GetMeshBoundingBox(chunk.mesh);
+      m_chunks.push_back(chunk);
+
+      for (int v : used)
+        remap[v] = -1;
+      used.clear();
+      vertices.clear();
+      indices.clear();
+    };
+
+    for (auto &bin : bins) {
+      for (int t : bin.second) {
+        if ((int)used.size() + 3 > MAX_CHUNK_VERTICES)
+          flush();
+        for (int k = 0; k < 3; k++) {
+          int v = vertexIndex(t * 3 + k);
+          if (remap[v] < 0) {
+            remap[v] = (int)used.size();
+            used.push_back(v);
+            vertices.push_back(world[v].x);
+            vertices.push_back(world[v].y);
+            vertices.push_back(world[v].z);
+          }
+          indices.push_back((unsigned short)remap[v]);
+        }
+      }
+      flush();
+    }
+  }
+
+  TraceLog(LOG_INFO,
+           "TerrainShadowChunks: %d triangles in %d chunks (%.0f units) in %.2f s",
+           sourceTris, (int)m_chunks.size(), chunkSize, GetTime() - startTime);
+  return !m_chunks.empty();
+}
+
+} // namespace moiras
@@ -0,0 +1,33 @@
+#pragma once
+#include <raylib.h>
+#include <vector>
+
+namespace moiras {
+
+// Copia della geometria della mappa divisa in chunk XZ, solo posizioni, per
+// lo shadow pass: ogni cascata disegna solo i chunk che interseca invece
+// delle mesh intere. I vertici hanno gia' applicato model.transform.
+class TerrainShadowChunks {
+public:
+  struct Chunk {
+    Mesh mesh = {0};
+    BoundingBox bounds = {{0, 0, 0}, {0, 0, 0}};
+  };
+
+  TerrainShadowChunks() = default;
+  ~TerrainShadowChunks() { unload(); }
+  TerrainShadowChunks(const TerrainShadowChunks &) = delete;
+  TerrainShadowChunks &operator=(const TerrainShadowChunks &) = delete;
+
+  // Richiede un contesto GL (le mesh vengono caricate sulla GPU)
+  bool build(const Model &model, float chunkSize);
+  void unload();
+
+  bool isBuilt() const { return !m_chunks.empty(); }
+  const std::vector<Chunk> &getChunks() const { return m_chunks; }
+
+private:
+  std::vector<Chunk> m_chunks;
+};
+
+} // namespace moiras
@@ -0,0 +1,132 @@
+#include "chunky_tri_mesh.h"
+#include <algorithm>
+
+namespace moiras {
+
+void ChunkyTriMesh::clear() {
+  m_nodes.clear();
+  m_tris.clear();
+  m_maxTrisPerChunk = 0;
+}
+
+bool ChunkyTriMesh::build(const float *verts, const int *tris, int ntris,
+                          int trisPerChunk) {
+  clear();
+  if (!verts || !tris || ntris <= 0 || trisPerChunk <= 0)
+    return false;
+
+  int nchunks = (ntris + trisPerChunk - 1) / trisPerChunk;
+  m_nodes.reserve(nchunks * 4);
+  m_tris.resize(ntris * 3);
+
+  // Bounds XZ di ogni triangolo
+  std::vector<BoundsItem> items(ntris);
+  for (int i = 0; i < ntris; i++) {
+    const int *t = &tris[i * 3];
+    BoundsItem &it = items[i];
+    it.i = i;
+    it.bmin[0] = it.bmax[0] = verts[t[0] * 3 + 0];
+    it.bmin[1] = it.bmax[1] = verts[t[0] * 3 + 2];
+    for (int j = 1; j < 3; j++) {
+      const float *v = &verts[t[j] * 3];
+      it.bmin[0] = std::min(it.bmin[0], v[0]);
+      it.bmin[1] = std::min(it.bmin[1], v[2]);
+      it.bmax[0] = std::max(it.bmax[0], v[0]);
+      it.bmax[1] = std::max(it.bmax[1], v[2]);
+    }
+  }
+
+  subdivide(items, 0, ntris, trisPerChunk, tris);
+
+  // Dimensione massima delle foglie (serve per i buffer delle aree)
+  for (const auto &node : m_nodes) {
+    if (node.i >= 0 && node.n > m_maxTrisPerChunk)
+      m_maxTrisPerChunk = node.n;
+  }
+
+  return true;
+}
+
+void ChunkyTriMesh::subdivide(std::vector<BoundsItem> &items, int imin,
+                              int imax, int trisPerChunk, const int *inTris) {
+  int inum = imax - imin;
+  int icur = (int)m_nodes.size();
+  m_nodes.push_back({});
+
+  // Bounds dell'intervallo
+  ChunkyTriMeshNode node;
+  node.bmin[0] = items[imin].bmin[0];
+  node.bmin[1] = items[imin].bmin[1];
+  node.bmax[0] = items[imin].bmax[0];
+  node.bmax[1] = items[imin].bmax[1];
+  for (int i = imin + 1; i < imax; i++) {
+    const BoundsItem &it = items[i];
+    node.bmin[0] = std::min(node.bmin[0], it.bmin[0]);
+    node.bmin[1] = std::min(node.bmin[1], it.bmin[1]);
+    node.bmax[0] = std::max(node.bmax[0], it.bmax[0]);
+    node.bmax[1] = std::max(node.bmax[1], it.bmax[1]);
+  }
+
+  if (inum <= trisPerChunk) {
+    // Foglia: copia i triangoli in ordine contiguo
+    node.i = imin;
+    node.n = inum;
+    for (int i = imin; i < imax; i++) {
+      const int *src = &inTris[items[i].i * 3];
+      int *dst = &m_tris[i * 3];
+      dst[0] = src[0];
+      dst[1] = src[1];
+      dst[2] = src[2];
+    }
+    m_nodes[icur] = node;
+    return;
+  }
+
+  // Split lungo l'asse piu' lungo, alla mediana
+  int axis = (node.bmax[0] - node.bmin[0] >= node.bmax[1] - node.bmin[1]) ? 0
+                                                                          : 1;
+  int isplit = imin + inum / 2;
+  std::nth_element(items.begin() + imin, items.begin() + isplit,
+                   items.begin() + imax,
+                   [axis](const BoundsItem &a, const BoundsItem &b) {
+                     return a.bmin[axis] < b.bmin[axis];
+                   });
+
+  subdivide(items, imin, isplit, trisPerChunk, inTris);
+  subdivide(items, isplit, imax, trisPerChunk, inTris);
+
+  // Escape index: salta l'intero sottoalbero durante la query
+  node.i = -((int)m_nodes.size() - icur);
+  node.n = inum;
+  m_nodes[icur] = node;
+}
+
+static inline bool checkOverlapRect(const float amin[2], const float amax[2],
+                                    const float bmin[2], const float bmax[2]) {
+  return !(amin[0] > bmax[0] || amax[0] < bmin[0] || amin[1] > bmax[1] ||
+           amax[1] < bmin[1]);
+}
+
+void ChunkyTriMesh::getChunksOverlappingRect(const float bmin[2],
+                                             const float bmax[2],
+                                             std::vector<int> &ids) const {
+  ids.clear();
+
+  int i = 0;
+  const int nnodes = (int)m_nodes.size();
+  while (i < nnodes) {
+    const ChunkyTriMeshNode &node = m_nodes[i];
+    const bool overlap = checkOverlapRect(bmin, bmax, node.bmin, node.bmax);
+    const bool isLeaf = node.i >= 0;
+
+    if (isLeaf && overlap)
+      ids.push_back(i);
+
+    if (overlap || isLeaf)
+      i++;
+    else
+      i += -node.i;
+  }
+}
+
+} // namespace moiras
@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+
+namespace moiras {
+
+// Nodo dell'albero AABB 2D (XZ). Le foglie hanno i >= 0 e indicizzano un
+// intervallo contiguo di triangoli; i nodi interni hanno i < 0 e -i e' l'
+// "escape index" (numero di nodi del sottoalbero, usato per saltarlo).
+struct ChunkyTriMeshNode {
+  float bmin[2];
+  float bmax[2];
+  int i;
+  int n;
+};
+
+// Partizione spaziale dei triangoli della mesh (come il chunky tri-mesh di
+// RecastDemo). Costruita una volta sola, permette a ogni tile di marcare e
+// rasterizzare solo i triangoli che ne toccano i bounds invece dell'intera
+// mesh.
+class ChunkyTriMesh {
+public:
+  // Costruisce l'albero. verts e' in formato xyz, tris contiene 3 indici per
+  // triangolo. trisPerChunk e' il numero massimo di triangoli per foglia.
+  bool build(const float *verts, const int *tris, int ntris,
+             int trisPerChunk = 256);
+  void clear();
+
+  // Riempie ids con le foglie che intersecano il rettangolo XZ [bmin, bmax].
+  // Il vettore viene svuotato prima dell'uso, cosi' il chiamante puo'
+  // riutilizzarlo tra una tile e l'altra.
+  void getChunksOverlappingRect(const float bmin[2], const float bmax[2],
+                                std::vector<int> &ids) const;
+
+  const ChunkyTriMeshNode &getNode(int index) const { return m_nodes[index]; }
+  // Indici dei triangoli riordinati per foglia (3 per triangolo)
+  const int *getTris(const ChunkyTriMeshNode &node) const {
+    return &m_tris[node.i * 3];
+  }
+  int getMaxTrisPerChunk() const { return m_maxTrisPerChunk; }
+  int getNodeCount() const { return (int)m_nodes.size(); }
+  bool isBuilt() const { return !m_nodes.empty(); }
+
+private:
+  struct BoundsItem {
+    float bmin[2];
+    float bmax[2];
+    int i;
+  };
+
+  std::vector<ChunkyTriMeshNode> m_nodes;
+  std::vector<int> m_tris;
+  int m_maxTrisPerChunk = 0;
+
+  void subdivide(std::vector<BoundsItem> &items, int imin, int imax,
+                 int trisPerChunk, const int *inTris);
+};
+
+} // namespace moiras
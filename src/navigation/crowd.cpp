@@ -0,0 +1,330 @@
+#include "crowd.h"
+#include "../character/character.h"
+#include "../map/map.h"
+#include "../profiler/profiler.h"
+#include "imgui.h"
+#include "navmesh.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace moiras {
+
+// Distanza dall'ultimo angolo del path entro cui l'agente e' arrivato
+static const float ARRIVAL_DISTANCE = 0.5f;
+// Spostamento orizzontale del Character oltre cui si considera teletrasportato
+static const float TELEPORT_EPSILON = 1e-3f;
+// Stessa ricerca del poligono di NavMesh::findPath
+static const float TARGET_EXTENTS[3] = {10.0f, 50.0f, 10.0f};
+// Campionamento adattivo dell'avoidance per qualita' (divisioni, anelli,
+// profondita'): da ~11 a ~66 velocita' valutate per agente
+static const unsigned char AVOIDANCE_PRESETS[4][3] = {
+    {5, 2, 1}, {5, 2, 2}, {7, 2, 3}, {7, 3, 3}};
+
+Crowd::~Crowd() {
+  if (m_crowd)
+    dtFreeCrowd(m_crowd);
+}
+
+void Crowd::init(NavMesh *navMesh, const Map *ground) {
+  m_navMesh = navMesh;
+  m_ground = ground;
+  // La dtCrowd viene (ri)creata al primo uso sulla navmesh corrente
+  m_navMeshGeneration = 0;
+  if (m_crowd) {
+    dtFreeCrowd(m_crowd);
+    m_crowd = nullptr;
+  }
+}
+
+dtCrowdAgentParams Crowd::makeParams(const CrowdAgentConfig &config) const {
+  dtCrowdAgentParams params;
+  memset(&params, 0, sizeof(params));
+  params.radius = std::min(config.radius, maxAgentRadius);
+  params.height = config.height;
+  params.maxAcceleration = config.maxAcceleration;
+  params.maxSpeed = config.maxSpeed;
+  params.collisionQueryRange = params.radius * 12.0f;
+  params.pathOptimizationRange = params.radius * 30.0f;
+  params.updateFlags = DT_CROWD_ANTICIPATE_TURNS | DT_CROWD_OPTIMIZE_VIS |
+                       DT_CROWD_OPTIMIZE_TOPO | DT_CROWD_OBSTACLE_AVOIDANCE |
+                       DT_CROWD_SEPARATION;
+  params.obstacleAvoidanceType = 0;
+  params.separationWeight = 2.0f;
+  return params;
+}
+
+bool Crowd::syncNavMesh() {
+  if (!m_navMesh || !m_navMesh->getDetourNavMesh())
+    return false;
+  if (m_crowd && m_navMeshGeneration == m_navMesh->getGeneration())
+    return true;
+
+  // Navmesh nuova (build, cache o rebuild): indici e poligoni della
+  // vecchia crowd non valgono piu', gli agenti vengono reinseriti
+  if (!m_crowd)
+    m_crowd = dtAllocCrowd();
+  if (!m_crowd ||
+      !m_crowd->init(MAX_AGENTS, maxAgentRadius, m_navMesh->getDetourNavMesh())) {
+    TraceLog(LOG_ERROR, "Crowd: Failed to init dtCrowd");
+    if (m_crowd) {
+      dtFreeCrowd(m_crowd);
+      m_crowd = nullptr;
+    }
+    m_navMesh = nullptr; // non riprovare a ogni frame
+    return false;
+  }
+  m_navMeshGeneration = m_navMesh->getGeneration();
+  m_appliedQuality = -1;
+
+  for (auto &slot : m_agents) {
+    if (!slot.character)
+      continue;
+    slot.crowdIndex = -1;
+    addToCrowd(slot);
+    if (slot.moving)
+      slot.moving = requestCrowdMove(slot);
+  }
+  TraceLog(LOG_INFO, "Crowd: dtCrowd ready (%d agents, max %d)", m_agentCount,
+           MAX_AGENTS);
+  return true;
+}
+
+void Crowd::addToCrowd(AgentSlot &slot) {
+  const float pos[3] = {slot.character->position.x, slot.character->position.y,
+                        slot.character->position.z};
+  const dtCrowdAgentParams params = makeParams(slot.config);
+  slot.crowdIndex = m_crowd->addAgent(pos, &params);
+  slot.written = slot.character->position;
+  if (slot.crowdIndex < 0) {
+    TraceLog(LOG_WARNING, "Crowd: Cannot add agent '%s'",
+             slot.character->name.c_str());
+  }
+}
+
+int Crowd::addAgent(Character *character, const CrowdAgentConfig &config) {
+  if (!m_navMesh || !character)
+    return -1;
+  if (m_agentCount >= MAX_AGENTS) {
+    TraceLog(LOG_WARNING, "Crowd: Agent limit reached (%d)", MAX_AGENTS);
+    return -1;
+  }
+  const bool ready = syncNavMesh();
+
+  int agent;
+  if (!m_freeSlots.empty()) {
+    agent = m_freeSlots.back();
+    m_freeSlots.pop_back();
+  } else {
+    agent = (int)m_agents.size();
+    m_agents.emplace_back();
+  }
+  AgentSlot &slot = m_agents[agent];
+  slot = AgentSlot();
+  slot.character = character;
+  slot.config = config;
+  m_agentCount++;
+
+  if (ready)
+    addToCrowd(slot);
+  return agent;
+}
+
+void Crowd::removeAgent(int agent) {
+  if (agent < 0 || agent >= (int)m_agents.size() || !m_agents[agent].character)
+    return;
+  AgentSlot &slot = m_agents[agent];
+  if (m_crowd && slot.crowdIndex >= 0)
+    m_crowd->removeAgent(slot.crowdIndex);
+  slot = AgentSlot();
+  m_freeSlots.push_back(agent);
+  m_agentCount--;
+}
+
+void Crowd::teleportAgent(AgentSlot &slot) {
+  m_crowd->removeAgent(slot.crowdIndex);
+  addToCrowd(slot);
+  if (slot.moving)
+    slot.moving = requestCrowdMove(slot);
+}
+
+void Crowd::setMaxSpeed(int agent, float speed) {
+  if (agent < 0 || agent >= (int)m_agents.size() || !m_agents[agent].character)
+    return;
+  AgentSlot &slot = m_agents[agent];
+  slot.config.maxSpeed = speed;
+  if (m_crowd && slot.crowdIndex >= 0) {
+    const dtCrowdAgentParams params = makeParams(slot.config);
+    m_crowd->updateAgentParameters(slot.crowdIndex, &params);
+  }
+}
+
+bool Crowd::requestCrowdMove(AgentSlot &slot) {
+  if (slot.crowdIndex < 0)
+    return false;
+  const float pos[3] = {slot.target.x, slot.target.y, slot.target.z};
+  dtPolyRef ref = 0;
+  float nearest[3];
+  m_crowd->getNavMeshQuery()->findNearestPoly(pos, TARGET_EXTENTS,
+                                              m_crowd->getFilter(0), &ref,
+                                              nearest);
+  if (!ref)
+    return false;
+  return m_crowd->requestMoveTarget(slot.crowdIndex, ref, nearest);
+}
+
+bool Crowd::requestMove(int agent, Vector3 target) {
+  if (agent < 0 || agent >= (int)m_agents.size() || !m_agents[agent].character)
+    return false;
+  if (!syncNavMesh())
+    return false;
+  AgentSlot &slot = m_agents[agent];
+  slot.target = target;
+  slot.moving = requestCrowdMove(slot);
+  return slot.moving;
+}
+
+void Crowd::stop(int agent) {
+  if (agent < 0 || agent >= (int)m_agents.size() || !m_agents[agent].character)
+    return;
+  AgentSlot &slot = m_agents[agent];
+  slot.moving = false;
+  if (m_crowd && slot.crowdIndex >= 0)
+    m_crowd->resetMoveTarget(slot.crowdIndex);
+}
+
+bool Crowd::isMoving(int agent) const {
+  if (agent < 0 || agent >= (int)m_agents.size())
+    return false;
+  return m_agents[agent].moving;
+}
+
+void Crowd::getCorners(int agent, std::vector<Vector3> &corners) {
+  corners.clear();
+  if (agent < 0 || agent >= (int)m_agents.size() || !m_crowd)
+    return;
+  const AgentSlot &slot = m_agents[agent];
+  if (slot.crowdIndex < 0 || !slot.moving)
+    return;
+  const dtCrowdAgent *ag = m_crowd->getAgent(slot.crowdIndex);
+  if (!ag || !ag->active)
+    return;
+  for (int i = 0; i < ag->ncorners; i++) {
+    const float *v = &ag->cornerVerts[i * 3];
+    corners.push_back({v[0], v[1], v[2]});
+  }
+}
+
+// Arrivato quando l'ultimo angolo e' la fine del path ed e' vicino (o
+// gia' scartato da dtCrowd perche' raggiunto)
+static bool hasArrived(const dtCrowdAgent *ag) {
+  if (ag->targetState != DT_CROWDAGENT_TARGET_VALID)
+    return false;
+  if (ag->ncorners == 0)
+    return true;
+  if (!(ag->cornerFlags[ag->ncorners - 1] & DT_STRAIGHTPATH_END))
+    return false;
+  const float *end = &ag->cornerVerts[(ag->ncorners - 1) * 3];
+  const float dx = end[0] - ag->npos[0];
+  const float dz = end[2] - ag->npos[2];
+  return dx * dx + dz * dz < ARRIVAL_DISTANCE * ARRIVAL_DISTANCE;
+}
+
+void Crowd::update(float dt) {
+  if (m_agentCount == 0 || dt <= 0.0f || !syncNavMesh())
+    return;
+  PROFILE_SCOPE("Crowd::update");
+  auto start = std::chrono::steady_clock::now();
+
+  avoidanceQuality = std::clamp(avoidanceQuality, 0, 3);
+  if (m_appliedQuality != avoidanceQuality) {
+    dtObstacleAvoidanceParams params = *m_crowd->getObstacleAvoidanceParams(0);
+    params.velBias = 0.5f;
+    params.adaptiveDivs = AVOIDANCE_PRESETS[avoidanceQuality][0];
+    params.adaptiveRings = AVOIDANCE_PRESETS[avoidanceQuality][1];
+    params.adaptiveDepth = AVOIDANCE_PRESETS[avoidanceQuality][2];
+    m_crowd->setObstacleAvoidanceParams(0, &params);
+    m_appliedQuality = avoidanceQuality;
+  }
+
+  // Personaggi spostati da fuori dall'ultimo update: l'agente li segue
+  // invece di riportarli indietro
+  for (auto &slot : m_agents) {
+    if (!slot.character || slot.crowdIndex < 0)
+      continue;
+    const Vector3 &pos = slot.character->position;
+    if (fabsf(pos.x - slot.written.x) > TELEPORT_EPSILON ||
+        fabsf(pos.z - slot.written.z) > TELEPORT_EPSILON)
+      teleportAgent(slot);
+  }
+
+  // Path, steering, avoidance e integrazione di tutti gli agenti
+  m_crowd->update(dt, nullptr);
+
+  // Posizione e orientamento sui personaggi; l'altezza segue il terreno
+  // (la navmesh non ha detail mesh)
+  m_movingCount = 0;
+  for (auto &slot : m_agents) {
+    if (!slot.character || slot.crowdIndex < 0)
+      continue;
+    const dtCrowdAgent *ag = m_crowd->getAgent(slot.crowdIndex);
+    if (!ag || !ag->active)
+      continue;
+    if (ag->state == DT_CROWDAGENT_STATE_INVALID) {
+      slot.moving = false; // fuori dalla navmesh
+      continue;
+    }
+
+    Character *character = slot.character;
+    character->position = {ag->npos[0], ag->npos[1], ag->npos[2]};
+    if (m_ground)
+      character->snapToGround(*m_ground);
+    slot.written = character->position;
+    if (ag->vel[0] * ag->vel[0] + ag->vel[2] * ag->vel[2] > 0.01f)
+      character->eulerRot.y = atan2f(ag->vel[0], ag->vel[2]) * RAD2DEG;
+
+    if (!slot.moving)
+      continue;
+    if (ag->targetState == DT_CROWDAGENT_TARGET_FAILED) {
+      slot.moving = false;
+    } else if (hasArrived(ag)) {
+      m_crowd->resetMoveTarget(slot.crowdIndex);
+      slot.moving = false;
+    } else {
+      m_movingCount++;
+    }
+  }
+
+  m_lastUpdateMs = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  PROFILE_COUNTER("Crowd agents moving", m_movingCount);
+}
+
+void Crowd::drawDebug() {
+  if (!m_crowd)
+    return;
+  for (const auto &slot : m_agents) {
+    if (!slot.character || slot.crowdIndex < 0)
+      continue;
+    const dtCrowdAgent *ag = m_crowd->getAgent(slot.crowdIndex);
+    if (!ag || !ag->active)
+      continue;
+    Vector3 pos = {ag->npos[0], slot.character->position.y + 0.1f, ag->npos[2]};
+    DrawCircle3D(pos, ag->params.radius, {1, 0, 0}, 90.0f,
+                 slot.moving ? SKYBLUE : GRAY);
+    DrawLine3D(pos, {pos.x + ag->vel[0], pos.y, pos.z + ag->vel[2]}, YELLOW);
+    if (slot.moving)
+      DrawLine3D(pos, slot.target, ColorAlpha(GREEN, 0.4f));
+  }
+}
+
+void Crowd::gui() {
+  ImGui::Text("Agents: %d (%d moving)", m_agentCount, m_movingCount);
+  ImGui::Text("Update: %.3f ms", m_lastUpdateMs);
+  ImGui::SliderInt("Avoidance quality", &avoidanceQuality, 0, 3);
+  ImGui::Checkbox("Debug draw", &debugDraw);
+}
+
+} // namespace moiras
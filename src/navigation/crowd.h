@@ -0,0 +1,104 @@
+#pragma once
+#include "DetourCrowd.h"
+#include <raylib.h>
+#include <vector>
+
+namespace moiras {
+
+class Character;
+class Map;
+class NavMesh;
+
+// Parametri di un agente della crowd
+struct CrowdAgentConfig {
+  float radius = 0.6f;
+  float height = 2.0f;
+  float maxSpeed = 5.0f;
+  float maxAcceleration = 20.0f;
+};
+
+// Movimento di molti personaggi con dtCrowd: un solo update per frame
+// calcola path (code di richieste interne, a budget), steering, avoidance
+// locale e separazione per tutti gli agenti, poi riporta posizione e
+// orientamento sui Character. Gli handle restituiti da addAgent restano
+// validi anche quando la navmesh viene ricostruita o ricaricata: gli
+// agenti vengono reinseriti nella nuova dtCrowd al primo update.
+class Crowd {
+public:
+  static constexpr int MAX_AGENTS = 512;
+
+  static Crowd &getInstance() {
+    static Crowd instance;
+    return instance;
+  }
+
+  // Navmesh su cui muoversi e terreno per l'altezza dei personaggi
+  void init(NavMesh *navMesh, const Map *ground);
+  bool isInitialized() const { return m_navMesh != nullptr; }
+
+  // -1 se non inizializzata o piena
+  int addAgent(Character *character, const CrowdAgentConfig &config);
+  void removeAgent(int agent);
+  void setMaxSpeed(int agent, float speed);
+
+  // Il path viene calcolato nei prossimi update; false se il target non e'
+  // sulla navmesh o la crowd non e' pronta
+  bool requestMove(int agent, Vector3 target);
+  void stop(int agent);
+  // true finche' l'agente non arriva o il path fallisce
+  bool isMoving(int agent) const;
+  // Angoli del path verso cui sta sterzando (debug)
+  void getCorners(int agent, std::vector<Vector3> &corners);
+
+  void update(float dt);
+  void drawDebug();
+  void gui();
+
+  // Raggio massimo degli agenti (griglia di prossimita' di dtCrowd)
+  float maxAgentRadius = 2.0f;
+  // 0-3: campionamento adattivo della velocita' da basso ad alto
+  int avoidanceQuality = 1;
+  bool debugDraw = false;
+
+  int getAgentCount() const { return m_agentCount; }
+  int getMovingCount() const { return m_movingCount; }
+  double getLastUpdateMs() const { return m_lastUpdateMs; }
+
+private:
+  Crowd() = default;
+  ~Crowd();
+  Crowd(const Crowd &) = delete;
+  Crowd &operator=(const Crowd &) = delete;
+
+  struct AgentSlot {
+    Character *character = nullptr;
+    CrowdAgentConfig config;
+    int crowdIndex = -1; // indice in dtCrowd, -1 finche' non inserito
+    bool moving = false;
+    Vector3 target = {0, 0, 0};
+    // Ultima posizione scritta sul Character: se cambia altrove (gui,
+    // script, respawn) l'agente viene spostato li'
+    Vector3 written = {0, 0, 0};
+  };
+
+  // Ricrea dtCrowd se la navmesh e' cambiata; false se non c'e' navmesh
+  bool syncNavMesh();
+  void addToCrowd(AgentSlot &slot);
+  // Reinserisce l'agente alla posizione attuale del Character
+  void teleportAgent(AgentSlot &slot);
+  bool requestCrowdMove(AgentSlot &slot);
+  dtCrowdAgentParams makeParams(const CrowdAgentConfig &config) const;
+
+  NavMesh *m_navMesh = nullptr;
+  const Map *m_ground = nullptr;
+  dtCrowd *m_crowd = nullptr;
+  unsigned int m_navMeshGeneration = 0;
+  int m_appliedQuality = -1;
+  std::vector<AgentSlot> m_agents;
+  std::vector<int> m_freeSlots;
+  int m_agentCount = 0;
+  int m_movingCount = 0;
+  double m_lastUpdateMs = 0.0;
+};
+
+} // namespace moiras
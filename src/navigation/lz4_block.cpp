@@ -0,0 +1,192 @@
+#include "lz4_block.h"
+#include <cstdint>
+#include <cstring>
+
+namespace moiras {
+
+// Vincoli del formato: match di almeno 4 byte, gli ultimi 5 byte sono
+// sempre literal e l'ultimo match inizia almeno 12 byte prima della fine
+static const int MIN_MATCH = 4;
+static const int LAST_LITERALS = 5;
+static const int MF_LIMIT = 12;
+static const int MAX_OFFSET = 65535;
+static const int HASH_BITS = 12;
+// Dopo 2^SKIP_TRIGGER tentativi falliti il passo di ricerca cresce: i dati
+// incomprimibili vengono attraversati in fretta
+static const int SKIP_TRIGGER = 6;
+
+static uint32_t read32(const unsigned char *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint32_t hash32(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lunghezza oltre il nibble del token: byte da 255 piu' il resto
+static unsigned char *writeLength(unsigned char *op, int length) {
+  while (length >= 255) {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = (unsigned char)length;
+  return op;
+}
+
+int lz4CompressBound(int srcSize) {
+  if (srcSize < 0)
+    return 0;
+  return srcSize + srcSize / 255 + 16;
+}
+
+int lz4Compress(const unsigned char *src, int srcSize, unsigned char *dst,
+                int dstCapacity) {
+  if (!src || !dst || srcSize < 0)
+    return 0;
+
+  unsigned char *op = dst;
+  unsigned char *const opEnd = dst + dstCapacity;
+  int anchor = 0;
+
+  // Sequenza: token, literal [anchor, ip), offset, lunghezza del match.
+  // matchLength == 0: ultima sequenza, solo literal.
+  auto emit = [&](int ip, int offset, int matchLength) {
+    const int literals = ip - anchor;
+    const size_t needed = 1 + literals + literals / 255 + 1 +
+                          (matchLength ? 2 + matchLength / 255 + 1 : 0);
+    if ((size_t)(opEnd - op) < needed)
+      return false;
+
+    unsigned char *token = op++;
+    *token = (unsigned char)((literals >= 15 ? 15 : literals) << 4);
+    if (literals >= 15)
+      op = writeLength(op, literals - 15);
+    memcpy(op, src + anchor, literals);
+    op += literals;
+    if (matchLength) {
+      *op++ = (unsigned char)(offset & 0xFF);
+      *op++ = (unsigned char)(offset >> 8);
+      const int extra = matchLength - MIN_MATCH;
+      *token |= (unsigned char)(extra >= 15 ? 15 : extra);
+      if (extra >= 15)
+        op = writeLength(op, extra - 15);
+    }
+    return true;
+  };
+
+  if (srcSize > MF_LIMIT) {
+    int table[1 << HASH_BITS];
+    memset(table, 0xFF, sizeof(table)); // -1: nessuna posizione
+    const int matchLimit = srcSize - LAST_LITERALS;
+    const int searchLimit = srcSize - MF_LIMIT;
+    int ip = 0;
+    int attempts = 0;
+
+    while (ip < searchLimit) {
+      const uint32_t sequence = read32(src + ip);
+      const uint32_t h = hash32(sequence);
+      int ref = table[h];
+      table[h] = ip;
+      if (ref < 0 || ip - ref > MAX_OFFSET || read32(src + ref) != sequence) {
+        ip += 1 + (attempts++ >> SKIP_TRIGGER);
+        continue;
+      }
+      attempts = 0;
+
+      // Estende il match all'indietro nei literal e poi in avanti
+      while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+        ip--;
+        ref--;
+      }
+      int length = MIN_MATCH;
+      while (ip + length < matchLimit && src[ref + length] == src[ip + length])
+        length++;
+
+      if (!emit(ip, ip - ref, length))
+        return 0;
+      ip += length;
+      anchor = ip;
+
+      // Posizione appena prima della fine del match: spesso riparte da li'
+      if (ip - 2 > 0 && ip < searchLimit)
+        table[hash32(read32(src + ip - 2))] = ip - 2;
+    }
+  }
+
+  if (!emit(srcSize, 0, 0))
+    return 0;
+  return (int)(op - dst);
+}
+
+int lz4Decompress(const unsigned char *src, int srcSize, unsigned char *dst,
+                  int dstCapacity) {
+  if (!src || !dst || srcSize <= 0 || dstCapacity < 0)
+    return -1;
+
+  const unsigned char *ip = src;
+  const unsigned char *const ipEnd = src + srcSize;
+  unsigned char *op = dst;
+  unsigned char *const opEnd = dst + dstCapacity;
+
+  for (;;) {
+    const unsigned token = *ip++;
+
+    size_t literals = token >> 4;
+    if (literals == 15) {
+      unsigned char b;
+      do {
+        if (ip >= ipEnd)
+          return -1;
+        b = *ip++;
+        literals += b;
+      } while (b == 255);
+    }
+    if ((size_t)(ipEnd - ip) < literals || (size_t)(opEnd - op) < literals)
+      return -1;
+    memcpy(op, ip, literals);
+    ip += literals;
+    op += literals;
+
+    // L'ultima sequenza non ha match
+    if (ip == ipEnd)
+      break;
+
+    if (ipEnd - ip < 2)
+      return -1;
+    const size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - dst))
+      return -1;
+
+    size_t length = token & 15;
+    if (length == 15) {
+      unsigned char b;
+      do {
+        if (ip >= ipEnd)
+          return -1;
+        b = *ip++;
+        length += b;
+      } while (b == 255);
+    }
+    length += MIN_MATCH;
+    if ((size_t)(opEnd - op) < length)
+      return -1;
+
+    const unsigned char *match = op - offset;
+    if (offset >= length) {
+      memcpy(op, match, length);
+      op += length;
+    } else {
+      // Sovrapposto: ripete il pattern byte per byte
+      for (size_t i = 0; i < length; i++)
+        *op++ = *match++;
+    }
+    if (ip >= ipEnd)
+      return -1; // un match non puo' chiudere il blocco
+  }
+  return (int)(op - dst);
+}
+
+} // namespace moiras
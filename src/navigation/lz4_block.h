@@ -0,0 +1,23 @@
+#pragma once
+
+namespace moiras {
+
+// Codec LZ4 (formato "block", compatibile con LZ4_compress_default /
+// LZ4_decompress_safe): compressione greedy con hash table di 4096
+// posizioni, decodifica a pochi GB/s. Usato per i layer del tile cache e
+// per le tile in navmesh.bin, dove conta la velocita' di decodifica piu'
+// del rapporto di compressione.
+
+// Dimensione massima dell'output per srcSize byte incomprimibili
+int lz4CompressBound(int srcSize);
+
+// Ritorna i byte scritti in dst, 0 se dstCapacity non basta
+int lz4Compress(const unsigned char *src, int srcSize, unsigned char *dst,
+                int dstCapacity);
+
+// Decodifica con controllo dei limiti: ritorna i byte scritti in dst, -1 se
+// i dati sono corrotti o non entrano in dstCapacity
+int lz4Decompress(const unsigned char *src, int srcSize, unsigned char *dst,
+                  int dstCapacity);
+
+} // namespace moiras
@@ -1,9 +1,16 @@
 #include "navmesh.h"
 #include "DetourNavMeshBuilder.h"
+#include "lz4_block.h"
+#include "../jobs/job_system.h"
+#include "../profiler/profiler.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <thread>
 #include <rlgl.h>
 
 namespace moiras {
@@ -24,32 +31,62 @@ void LinearAllocator::reset() {
 void *LinearAllocator::alloc(const size_t size) {
   if (!buffer)
     return nullptr;
-  if (top + size > capacity)
+  // Allineato a 16: il builder del tile cache alterna array di byte e short
+  const size_t alignedSize = (size + 15) & ~(size_t)15;
+  if (top + alignedSize > capacity)
     return nullptr;
   unsigned char *mem = &buffer[top];
-  top += size;
+  top += alignedSize;
   return mem;
 }
 
+// Memoria per ricostruire una tile dal suo layer: griglia decompressa
+// (heights, areas, cons, regs) piu' contorni e poly mesh temporanei
+static size_t tileAllocatorSize(int tileCells) {
+  const size_t cells = (size_t)tileCells * tileCells;
+  return std::max<size_t>(64 * 1024, cells * 32);
+}
+
+// Layer per colonna di tile (ponti, grotte, piani di una struttura)
+static const int MAX_TILE_LAYERS = 32;
+// Dimensione della lista di tile da ricostruire in dtTileCache (MAX_UPDATE)
+static const int MAX_TILE_CACHE_UPDATES = 64;
+
 void LinearAllocator::free(void * /*ptr*/) {
   // Empty - linear allocator doesn't free individual allocations
 }
 
 // ============================================
-// Tile Cache Compressor implementation (passthrough)
+// Tile Cache Compressor implementation (LZ4)
 // ============================================
 
+float TileCacheCompressor::getCompressionRatio() const {
+  long long raw = rawBytes.load(std::memory_order_relaxed);
+  return raw > 0 ? (float)compressedBytes.load(std::memory_order_relaxed) / raw
+                 : 1.0f;
+}
+
+double TileCacheCompressor::getAverageDecodeMs() const {
+  int count = decodeCount.load(std::memory_order_relaxed);
+  return count > 0 ? decodeNanos.load(std::memory_order_relaxed) / 1e6 / count
+                   : 0.0;
+}
+
 int TileCacheCompressor::maxCompressedSize(const int bufferSize) {
-  return bufferSize;
+  return lz4CompressBound(bufferSize);
 }
 
 dtStatus TileCacheCompressor::compress(const unsigned char *buffer,
                                        const int bufferSize,
                                        unsigned char *compressed,
-                                       const int /*maxCompressedSize*/,
+                                       const int maxCompressedSize,
                                        int *compressedSize) {
-  memcpy(compressed, buffer, bufferSize);
-  *compressedSize = bufferSize;
+  int size = lz4Compress(buffer, bufferSize, compressed, maxCompressedSize);
+  if (size <= 0)
+    return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+  *compressedSize = size;
+  rawBytes.fetch_add(bufferSize, std::memory_order_relaxed);
+  compressedBytes.fetch_add(size, std::memory_order_relaxed);
   return DT_SUCCESS;
 }
 
@@ -58,10 +95,17 @@ dtStatus TileCacheCompressor::decompress(const unsigned char *compressed,
                                          unsigned char *buffer,
                                          const int maxBufferSize,
                                          int *bufferSize) {
-  if (compressedSize > maxBufferSize)
-    return DT_FAILURE;
-  memcpy(buffer, compressed, compressedSize);
-  *bufferSize = compressedSize;
+  auto start = std::chrono::steady_clock::now();
+  int size = lz4Decompress(compressed, compressedSize, buffer, maxBufferSize);
+  if (size < 0)
+    return DT_FAILURE | DT_INVALID_PARAM;
+  *bufferSize = size;
+  decodeNanos.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count(),
+                        std::memory_order_relaxed);
+  decodedBytes.fetch_add(size, std::memory_order_relaxed);
+  decodeCount.fetch_add(1, std::memory_order_relaxed);
   return DT_SUCCESS;
 }
 
@@ -88,16 +132,18 @@ NavMesh::NavMesh()
       m_tileCache(nullptr), m_talloc(nullptr), m_tcomp(nullptr),
       m_tmproc(nullptr) {
   m_ctx = new rcContext();
+  m_scratch.ctx = m_ctx;
   m_navQuery = dtAllocNavMeshQuery();
+  // Senza stato (a parte le statistiche): condivisi dai worker del build
+  m_tcomp = new TileCacheCompressor();
+  m_tmproc = new TileCacheMeshProcess();
   memset(&m_cfg, 0, sizeof(m_cfg));
+  memset(&m_tileCacheParams, 0, sizeof(m_tileCacheParams));
 }
 
 NavMesh::~NavMesh() {
   cleanupTileDebugData();
-  if (m_tileCache)
-    dtFreeTileCache(m_tileCache);
-  if (m_navMesh)
-    dtFreeNavMesh(m_navMesh);
+  freeNavMesh();
   if (m_navQuery)
     dtFreeNavMeshQuery(m_navQuery);
   if (m_debugModel.meshCount > 0) {
@@ -136,8 +182,8 @@ void NavMesh::getBounds(float *bmin, float *bmax) const {
 
 TileCoord NavMesh::getTileCoordAt(Vector3 worldPos) const {
   TileCoord tc;
-  tc.x = (int)floorf((worldPos.x - m_boundsMin[0]) / m_tileSize);
-  tc.y = (int)floorf((worldPos.z - m_boundsMin[2]) / m_tileSize);
+  tc.x = (int)floorf((worldPos.x - m_boundsMin[0]) / m_builtTileSize);
+  tc.y = (int)floorf((worldPos.z - m_boundsMin[2]) / m_builtTileSize);
   return tc;
 }
 
@@ -148,10 +194,7 @@ bool NavMesh::build(const Mesh &mesh, Matrix transform) {
 
 bool NavMesh::initNavMesh() {
   // Pulisci navmesh esistente
-  if (m_navMesh) {
-    dtFreeNavMesh(m_navMesh);
-    m_navMesh = nullptr;
-  }
+  freeNavMesh();
 
   m_navMesh = dtAllocNavMesh();
   if (!m_navMesh) {
@@ -163,8 +206,8 @@ bool NavMesh::initNavMesh() {
   dtNavMeshParams params;
   memset(&params, 0, sizeof(params));
   rcVcopy(params.orig, m_boundsMin);
-  params.tileWidth = m_tileSize;
-  params.tileHeight = m_tileSize;
+  params.tileWidth = m_builtTileSize;
+  params.tileHeight = m_builtTileSize;
   params.maxTiles = m_maxTiles;
   params.maxPolys = m_maxPolysPerTile;
 
@@ -191,17 +234,10 @@ bool NavMesh::initTileCache() {
     m_tileCache = nullptr;
   }
 
-  // Create allocator, compressor and mesh processor
+  // The allocator must hold a decompressed layer plus the temporary
+  // contours and poly mesh of a rebuild
   delete m_talloc;
-  delete m_tcomp;
-  delete m_tmproc;
-
-  // Allocator needs enough memory for tile operations
-  // Larger maps need more memory
-  const size_t allocSize = 64 * 1024; // 64KB should be sufficient
-  m_talloc = new LinearAllocator(allocSize);
-  m_tcomp = new TileCacheCompressor();
-  m_tmproc = new TileCacheMeshProcess();
+  m_talloc = new LinearAllocator(tileAllocatorSize(m_tileCacheParams.width));
 
   // Allocate tile cache
   m_tileCache = dtAllocTileCache();
@@ -210,24 +246,8 @@ bool NavMesh::initTileCache() {
     return false;
   }
 
-  // Setup tile cache params
-  dtTileCacheParams tcparams;
-  memset(&tcparams, 0, sizeof(tcparams));
-  rcVcopy(tcparams.orig, m_boundsMin);
-  tcparams.cs = m_cellSize;
-  tcparams.ch = m_cellHeight;
-  tcparams.width = m_cfg.tileSize;  // Tile size in cells
-  tcparams.height = m_cfg.tileSize; // Tile size in cells
-  tcparams.walkableHeight = m_agentHeight;
-  tcparams.walkableRadius = m_agentRadius;
-  tcparams.walkableClimb = m_agentMaxClimb;
-  tcparams.maxSimplificationError = m_maxSimplificationError;
-
-  // Calculate max tiles - need extra for layers
-  const int EXPECTED_LAYERS_PER_TILE = 4;
-  tcparams.maxTiles = m_tilesX * m_tilesZ * EXPECTED_LAYERS_PER_TILE;
-  tcparams.maxObstacles = 256; // Increase max obstacles
-
+  // Params come from buildTiled or from the cache file
+  const dtTileCacheParams &tcparams = m_tileCacheParams;
   dtStatus status = m_tileCache->init(&tcparams, m_talloc, m_tcomp, m_tmproc);
   if (dtStatusFailed(status)) {
     TraceLog(LOG_ERROR, "NavMesh: Failed to init tile cache");
@@ -250,72 +270,85 @@ bool NavMesh::initTileCache() {
   return true;
 }
 
-int NavMesh::rasterizeTileLayers(int tileX, int tileY, const rcConfig &cfg,
-                                 TileCacheData *tiles, int maxTiles) {
-  // Calculate tile bounds with border
-  float tileBmin[3], tileBmax[3];
+bool NavMesh::rasterizeTileTriangles(TileBuildScratch &scratch,
+                                     const rcConfig &tileCfg,
+                                     rcHeightfield &hf) {
+  if (!m_chunkyMesh.isBuilt())
+    return false;
 
-  tileBmin[0] = m_boundsMin[0] + tileX * m_tileSize;
-  tileBmin[1] = m_boundsMin[1];
-  tileBmin[2] = m_boundsMin[2] + tileY * m_tileSize;
+  // Rettangolo XZ della tile (gia' espanso con il bordo)
+  float tbmin[2] = {tileCfg.bmin[0], tileCfg.bmin[2]};
+  float tbmax[2] = {tileCfg.bmax[0], tileCfg.bmax[2]};
 
-  tileBmax[0] = m_boundsMin[0] + (tileX + 1) * m_tileSize;
-  tileBmax[1] = m_boundsMax[1];
-  tileBmax[2] = m_boundsMin[2] + (tileY + 1) * m_tileSize;
+  m_chunkyMesh.getChunksOverlappingRect(tbmin, tbmax, scratch.chunkIds);
+  if (scratch.chunkIds.empty())
+    return true; // Nessun triangolo: heightfield vuoto, non un errore
 
-  // Expand for border
-  float borderSize = cfg.borderSize * cfg.cs;
-  tileBmin[0] -= borderSize;
-  tileBmin[2] -= borderSize;
-  tileBmax[0] += borderSize;
-  tileBmax[2] += borderSize;
+  scratch.triAreas.resize(m_chunkyMesh.getMaxTrisPerChunk());
 
-  // Setup config for this tile
-  rcConfig tileCfg = cfg;
-  rcVcopy(tileCfg.bmin, tileBmin);
-  rcVcopy(tileCfg.bmax, tileBmax);
+  for (int id : scratch.chunkIds) {
+    const ChunkyTriMeshNode &node = m_chunkyMesh.getNode(id);
+    const int *ctris = m_chunkyMesh.getTris(node);
+    const int nctris = node.n;
 
-  rcCalcGridSize(tileCfg.bmin, tileCfg.bmax, tileCfg.cs, &tileCfg.width,
-                 &tileCfg.height);
+    memset(scratch.triAreas.data(), 0, nctris);
+    rcMarkWalkableTriangles(scratch.ctx, tileCfg.walkableSlopeAngle,
+                            m_storedVerts.data(), m_storedVertCount, ctris,
+                            nctris, scratch.triAreas.data());
 
-  // If tile is too small, skip
-  if (tileCfg.width < 3 || tileCfg.height < 3) {
-    return 0;
+    if (!rcRasterizeTriangles(scratch.ctx, m_storedVerts.data(),
+                              m_storedVertCount, ctris,
+                              scratch.triAreas.data(), nctris, hf,
+                              tileCfg.walkableClimb)) {
+      return false;
+    }
   }
 
-  // 1. Create heightfield
+  return true;
+}
+
+int NavMesh::rasterizeTileLayers(TileBuildScratch &scratch, int tileX,
+                                 int tileY, TileCacheData *tiles,
+                                 int maxTiles) {
+  PROFILE_SCOPE("NavMesh::rasterizeTileLayers");
+  rcContext *ctx = scratch.ctx;
+
+  // Griglia esplicita: ogni layer copre esattamente tileSize celle per lato,
+  // allineate alla griglia del tile cache, piu' il bordo
+  rcConfig tileCfg = m_cfg;
+  tileCfg.width = m_cfg.tileSize + m_cfg.borderSize * 2;
+  tileCfg.height = m_cfg.tileSize + m_cfg.borderSize * 2;
+
+  const float borderSize = m_cfg.borderSize * m_cfg.cs;
+  tileCfg.bmin[0] = m_boundsMin[0] + tileX * m_builtTileSize - borderSize;
+  tileCfg.bmin[1] = m_boundsMin[1];
+  tileCfg.bmin[2] = m_boundsMin[2] + tileY * m_builtTileSize - borderSize;
+  tileCfg.bmax[0] = m_boundsMin[0] + (tileX + 1) * m_builtTileSize + borderSize;
+  tileCfg.bmax[1] = m_boundsMax[1];
+  tileCfg.bmax[2] = m_boundsMin[2] + (tileY + 1) * m_builtTileSize + borderSize;
+
+  // 1. Heightfield
   rcHeightfield *hf = rcAllocHeightfield();
   if (!hf)
     return 0;
 
-  if (!rcCreateHeightfield(m_ctx, *hf, tileCfg.width, tileCfg.height,
+  if (!rcCreateHeightfield(ctx, *hf, tileCfg.width, tileCfg.height,
                            tileCfg.bmin, tileCfg.bmax, tileCfg.cs,
                            tileCfg.ch)) {
     rcFreeHeightField(hf);
     return 0;
   }
 
-  // Rasterize triangles
-  unsigned char *areas = new unsigned char[m_storedTriCount];
-  memset(areas, 0, m_storedTriCount);
-
-  rcMarkWalkableTriangles(m_ctx, tileCfg.walkableSlopeAngle,
-                          m_storedVerts.data(), m_storedVertCount,
-                          m_storedTris.data(), m_storedTriCount, areas);
-
-  if (!rcRasterizeTriangles(m_ctx, m_storedVerts.data(), m_storedVertCount,
-                            m_storedTris.data(), areas, m_storedTriCount, *hf,
-                            tileCfg.walkableClimb)) {
-    delete[] areas;
+  // Rasterizza solo i triangoli che toccano la tile
+  if (!rasterizeTileTriangles(scratch, tileCfg, *hf)) {
     rcFreeHeightField(hf);
     return 0;
   }
-  delete[] areas;
 
-  // 2. Filtering
-  rcFilterLowHangingWalkableObstacles(m_ctx, tileCfg.walkableClimb, *hf);
-  rcFilterLedgeSpans(m_ctx, tileCfg.walkableHeight, tileCfg.walkableClimb, *hf);
-  rcFilterWalkableLowHeightSpans(m_ctx, tileCfg.walkableHeight, *hf);
+  // 2. Filtraggio
+  rcFilterLowHangingWalkableObstacles(ctx, tileCfg.walkableClimb, *hf);
+  rcFilterLedgeSpans(ctx, tileCfg.walkableHeight, tileCfg.walkableClimb, *hf);
+  rcFilterWalkableLowHeightSpans(ctx, tileCfg.walkableHeight, *hf);
 
   // 3. Compact heightfield
   rcCompactHeightfield *chf = rcAllocCompactHeightfield();
@@ -324,7 +357,7 @@ int NavMesh::rasterizeTileLayers(int tileX, int tileY, const rcConfig &cfg,
     return 0;
   }
 
-  if (!rcBuildCompactHeightfield(m_ctx, tileCfg.walkableHeight,
+  if (!rcBuildCompactHeightfield(ctx, tileCfg.walkableHeight,
                                  tileCfg.walkableClimb, *hf, *chf)) {
     rcFreeHeightField(hf);
     rcFreeCompactHeightfield(chf);
@@ -332,33 +365,21 @@ int NavMesh::rasterizeTileLayers(int tileX, int tileY, const rcConfig &cfg,
   }
   rcFreeHeightField(hf);
 
-  // 4. Erode walkable area
-  if (!rcErodeWalkableArea(m_ctx, tileCfg.walkableRadius, *chf)) {
-    rcFreeCompactHeightfield(chf);
-    return 0;
-  }
-
-  // 5. Build distance field (required for regions and layers)
-  if (!rcBuildDistanceField(m_ctx, *chf)) {
-    rcFreeCompactHeightfield(chf);
-    return 0;
-  }
-
-  // 6. Build regions (required for heightfield layers)
-  if (!rcBuildRegions(m_ctx, *chf, tileCfg.borderSize, tileCfg.minRegionArea,
-                      tileCfg.mergeRegionArea)) {
+  // 4. Erosione
+  if (!rcErodeWalkableArea(ctx, tileCfg.walkableRadius, *chf)) {
     rcFreeCompactHeightfield(chf);
     return 0;
   }
 
-  // 7. Build heightfield layers
+  // 5. Layer dell'heightfield: regioni, contorni e poligoni vengono
+  // costruiti dal tile cache a partire da questi
   rcHeightfieldLayerSet *lset = rcAllocHeightfieldLayerSet();
   if (!lset) {
     rcFreeCompactHeightfield(chf);
     return 0;
   }
 
-  if (!rcBuildHeightfieldLayers(m_ctx, *chf, tileCfg.borderSize,
+  if (!rcBuildHeightfieldLayers(ctx, *chf, tileCfg.borderSize,
                                 tileCfg.walkableHeight, *lset)) {
     rcFreeCompactHeightfield(chf);
     rcFreeHeightfieldLayerSet(lset);
@@ -367,7 +388,7 @@ int NavMesh::rasterizeTileLayers(int tileX, int tileY, const rcConfig &cfg,
 
   rcFreeCompactHeightfield(chf);
 
-  // Build tile cache layers from heightfield layers
+  // 6. Layer compressi per il tile cache
   int ntiles = 0;
   for (int i = 0; i < rcMin(lset->nlayers, maxTiles); ++i) {
     const rcHeightfieldLayer *layer = &lset->layers[i];
@@ -406,6 +427,7 @@ int NavMesh::rasterizeTileLayers(int tileX, int tileY, const rcConfig &cfg,
 
 bool NavMesh::buildTiled(const Mesh &mesh, Matrix transform,
                          ProgressCallback progressCallback) {
+  PROFILE_SCOPE("NavMesh::buildTiled");
   if (mesh.vertexCount == 0) {
     TraceLog(LOG_ERROR, "NavMesh: Mesh has no vertices");
     return false;
@@ -415,6 +437,7 @@ bool NavMesh::buildTiled(const Mesh &mesh, Matrix transform,
            "NavMesh: Building TILED navmesh from mesh with %d vertices, %d "
            "triangles",
            mesh.vertexCount, mesh.triangleCount);
+  m_sourceHash = computeSourceHash(mesh, transform);
 
   // Cleanup precedente
   cleanupTileDebugData();
@@ -448,6 +471,20 @@ bool NavMesh::buildTiled(const Mesh &mesh, Matrix transform,
     }
   }
 
+  // Partizione spaziale dei triangoli: ogni tile rasterizza solo i chunk
+  // che ne intersecano i bounds
+  double chunkStart = GetTime();
+  if (!m_chunkyMesh.build(m_storedVerts.data(), m_storedTris.data(),
+                          m_storedTriCount, 256)) {
+    TraceLog(LOG_ERROR, "NavMesh: Failed to build chunky triangle mesh");
+    return false;
+  }
+  TraceLog(LOG_INFO,
+           "NavMesh: Chunky tri-mesh built - %d nodes, max %d tris/chunk "
+           "(%.1f ms)",
+           m_chunkyMesh.getNodeCount(), m_chunkyMesh.getMaxTrisPerChunk(),
+           (GetTime() - chunkStart) * 1000.0);
+
   // Calcola il bounding box totale
   rcCalcBounds(m_storedVerts.data(), m_storedVertCount, m_boundsMin,
                m_boundsMax);
@@ -462,26 +499,88 @@ bool NavMesh::buildTiled(const Mesh &mesh, Matrix transform,
   TraceLog(LOG_INFO, "NavMesh: Map dimensions: %.2f x %.2f", mapWidth,
            mapLength);
 
-  // Calcola la dimensione ottimale delle tile
-  // Ogni tile dovrebbe avere una grid di circa 64-128 celle per lato per buone
-  // performance
-  float targetCellsPerTile = 128.0f;
-  m_tileSize = targetCellsPerTile * m_cellSize;
+  // Setup configurazione Recast base
+  memset(&m_cfg, 0, sizeof(m_cfg));
+  m_cfg.cs = m_cellSize;
+  m_cfg.ch = m_cellHeight;
+  m_cfg.walkableSlopeAngle = m_agentMaxSlope;
+  m_cfg.walkableHeight = (int)ceilf(m_agentHeight / m_cfg.ch);
+  m_cfg.walkableClimb = (int)floorf(m_agentMaxClimb / m_cfg.ch);
+  m_cfg.walkableRadius = (int)ceilf(m_agentRadius / m_cfg.cs);
+  m_cfg.maxEdgeLen = (int)(12.0f / m_cfg.cs);
+  m_cfg.maxSimplificationError = m_maxSimplificationError;
+  m_cfg.minRegionArea = (int)rcSqr(m_minRegionArea);
+  m_cfg.mergeRegionArea = (int)rcSqr(m_mergeRegionArea);
+  m_cfg.maxVertsPerPoly = 6;
+  m_cfg.detailSampleDist = m_cfg.cs * 6.0f;
+  m_cfg.detailSampleMaxError = m_cfg.ch * 1.0f;
+  m_cfg.borderSize =
+      m_cfg.walkableRadius + 3; // Border per connessioni tra tile
 
-  // Clamp tile size tra 32 e 256 unità
-  m_tileSize = fmaxf(32.0f, fminf(256.0f, m_tileSize));
+  m_cfg.tileSize = computeTileCells();
+  m_builtTileSize = m_cfg.tileSize * m_cfg.cs;
 
   // Calcola numero di tile
-  m_tilesX = (int)ceilf(mapWidth / m_tileSize);
-  m_tilesZ = (int)ceilf(mapLength / m_tileSize);
+  m_tilesX = (int)ceilf(mapWidth / m_builtTileSize);
+  m_tilesZ = (int)ceilf(mapLength / m_builtTileSize);
 
   // Assicurati di avere almeno 1 tile
   m_tilesX = (m_tilesX < 1) ? 1 : m_tilesX;
   m_tilesZ = (m_tilesZ < 1) ? 1 : m_tilesZ;
+  int totalTiles = m_tilesX * m_tilesZ;
+
+  TraceLog(LOG_INFO,
+           "NavMesh: Tile size: %.2f, Grid: %d x %d tiles (total: %d)",
+           m_builtTileSize, m_tilesX, m_tilesZ, totalTiles);
+  TraceLog(LOG_INFO,
+           "NavMesh: Config - cellSize: %.2f, tileSize(cells): %d, border: %d",
+           m_cfg.cs, m_cfg.tileSize, m_cfg.borderSize);
+
+  // Parametri del tile cache, gli stessi usati per costruire le tile dai
+  // layer (maxTiles si conosce solo dopo il build)
+  memset(&m_tileCacheParams, 0, sizeof(m_tileCacheParams));
+  rcVcopy(m_tileCacheParams.orig, m_boundsMin);
+  m_tileCacheParams.cs = m_cfg.cs;
+  m_tileCacheParams.ch = m_cfg.ch;
+  m_tileCacheParams.width = m_cfg.tileSize;
+  m_tileCacheParams.height = m_cfg.tileSize;
+  m_tileCacheParams.walkableHeight = m_agentHeight;
+  m_tileCacheParams.walkableRadius = m_agentRadius;
+  m_tileCacheParams.walkableClimb = m_agentMaxClimb;
+  m_tileCacheParams.maxSimplificationError = m_maxSimplificationError;
+  m_tileCacheParams.maxObstacles = 256;
+
+  // Layer del tile cache e tile Detour di ogni colonna
+  double startTime = GetTime();
+  std::vector<TileColumn> columns(totalTiles);
+
+  int threadCount = m_buildThreads > 0
+                        ? m_buildThreads
+                        : JobSystem::getInstance().getConcurrency();
+  threadCount = std::clamp(threadCount, 1, totalTiles);
+
+  if (threadCount > 1) {
+    TraceLog(LOG_INFO, "NavMesh: Building tiles in %d parallel jobs",
+             threadCount);
+    buildTilesParallel(threadCount, columns, progressCallback);
+  } else {
+    for (int i = 0; i < totalTiles; i++) {
+      buildTileColumn(m_scratch, i % m_tilesX, i / m_tilesX, columns[i]);
+      if (progressCallback) {
+        progressCallback(i + 1, totalTiles);
+      }
+    }
+  }
 
   // Calcola maxTiles e maxPolys come potenze di 2 (richiesto da Detour)
-  // 22 bit totali da dividere tra tiles e polys
-  int totalTiles = m_tilesX * m_tilesZ;
+  // 22 bit totali da dividere tra tiles e polys. Una tile Detour per layer:
+  // gli ostacoli cambiano i poligoni, mai il numero di layer.
+  int layerCount = 0;
+  int maxPolys = 0;
+  for (const auto &column : columns) {
+    layerCount += (int)column.layers.size();
+    maxPolys = std::max(maxPolys, column.maxPolys);
+  }
 
   // Helper: calcola prossima potenza di 2
   auto nextPow2 = [](unsigned int v) -> unsigned int {
@@ -503,7 +602,7 @@ bool NavMesh::buildTiled(const Mesh &mesh, Matrix transform,
     return r;
   };
 
-  int tileBits = ilog2(nextPow2(totalTiles));
+  int tileBits = ilog2(nextPow2(std::max(layerCount, 1)));
   if (tileBits < 1)
     tileBits = 1;
   if (tileBits > 14)
@@ -511,74 +610,36 @@ bool NavMesh::buildTiled(const Mesh &mesh, Matrix transform,
   int polyBits = 22 - tileBits;
   m_maxTiles = 1 << tileBits;
   m_maxPolysPerTile = 1 << polyBits;
-
-  TraceLog(LOG_INFO,
-           "NavMesh: Tile size: %.2f, Grid: %d x %d tiles (total: %d)",
-           m_tileSize, m_tilesX, m_tilesZ, totalTiles);
-  TraceLog(LOG_INFO, "NavMesh: maxTiles: %d (2^%d), maxPolysPerTile: %d (2^%d)",
-           m_maxTiles, tileBits, m_maxPolysPerTile, polyBits);
-
-  // Setup configurazione Recast base
-  memset(&m_cfg, 0, sizeof(m_cfg));
-  m_cfg.cs = m_cellSize;
-  m_cfg.ch = m_cellHeight;
-  m_cfg.walkableSlopeAngle = m_agentMaxSlope;
-  m_cfg.walkableHeight = (int)ceilf(m_agentHeight / m_cfg.ch);
-  m_cfg.walkableClimb = (int)floorf(m_agentMaxClimb / m_cfg.ch);
-  m_cfg.walkableRadius = (int)ceilf(m_agentRadius / m_cfg.cs);
-  m_cfg.maxEdgeLen = (int)(12.0f / m_cfg.cs);
-  m_cfg.maxSimplificationError = m_maxSimplificationError;
-  m_cfg.minRegionArea = (int)rcSqr(m_minRegionArea);
-  m_cfg.mergeRegionArea = (int)rcSqr(m_mergeRegionArea);
-  m_cfg.maxVertsPerPoly = 6;
-  m_cfg.detailSampleDist = m_cfg.cs * 6.0f;
-  m_cfg.detailSampleMaxError = m_cfg.ch * 1.0f;
-  // Tile size in celle
-  m_cfg.tileSize = (int)(m_tileSize / m_cfg.cs);
-  m_cfg.borderSize =
-      m_cfg.walkableRadius + 3; // Border per connessioni tra tile
-
-  TraceLog(LOG_INFO,
-           "NavMesh: Config - cellSize: %.2f, tileSize(cells): %d, border: %d",
-           m_cfg.cs, m_cfg.tileSize, m_cfg.borderSize);
-
-  // Inizializza la navmesh tiled
-  if (!initNavMesh()) {
-    return false;
-  }
-
-  // Initialize tile cache for dynamic obstacles
-  if (!initTileCache()) {
+  m_tileCacheParams.maxTiles = m_maxTiles;
+
+  TraceLog(LOG_INFO, "NavMesh: %d layers, maxTiles: %d (2^%d), "
+           "maxPolysPerTile: %d (2^%d)",
+           layerCount, m_maxTiles, tileBits, m_maxPolysPerTile, polyBits);
+  if (maxPolys > m_maxPolysPerTile) {
+    TraceLog(LOG_WARNING, "NavMesh: A tile has %d polygons (max %d)",
+             maxPolys, m_maxPolysPerTile);
+  }
+
+  // Inizializza navmesh tiled e tile cache, poi passa loro i dati
+  if (!initNavMesh() || !initTileCache()) {
+    for (auto &column : columns) {
+      for (auto &layer : column.layers)
+        dtFree(layer.data);
+      for (auto &tile : column.navTiles)
+        dtFree(tile.data);
+    }
     return false;
   }
 
-  // Build navmesh tiles using the proven buildTileData() method
   int builtTiles = 0;
-  double startTime = GetTime();
-
-  for (int y = 0; y < m_tilesZ; y++) {
-    for (int x = 0; x < m_tilesX; x++) {
-      if (buildTile(x, y)) {
-        builtTiles++;
-      }
-      if (progressCallback) {
-        progressCallback(y * m_tilesX + x + 1, totalTiles);
-      }
+  for (auto &column : columns) {
+    if (addTileColumn(column)) {
+      builtTiles++;
     }
   }
 
   double elapsed = GetTime() - startTime;
-
-  // Count actual polygons
-  m_totalPolygons = 0;
-  const dtNavMesh *navMesh = m_navMesh;
-  int maxTiles = navMesh->getMaxTiles();
-  for (int i = 0; i < maxTiles; i++) {
-    const dtMeshTile *tile = navMesh->getTile(i);
-    if (tile && tile->header) {
-      m_totalPolygons += tile->header->polyCount;
-    }
-  }
+  countPolygons();
 
   TraceLog(LOG_INFO,
            "NavMesh: Built %d/%d tiles in %.2f seconds (using TileCache)",
@@ -591,268 +652,245 @@ bool NavMesh::buildTiled(const Mesh &mesh, Matrix transform,
   }
 
   m_tileCount = builtTiles;
+  // Gli ostacoli gia' piazzati vanno applicati al nuovo tile cache
+  resubmitObstacles();
   return true;
 }
 
-unsigned char *NavMesh::buildTileData(int tileX, int tileY, int &dataSize) {
-  dataSize = 0;
-
-  // Calcola i bounds della tile con bordo
-  float tileBmin[3], tileBmax[3];
-
-  tileBmin[0] = m_boundsMin[0] + tileX * m_tileSize;
-  tileBmin[1] = m_boundsMin[1];
-  tileBmin[2] = m_boundsMin[2] + tileY * m_tileSize;
-
-  tileBmax[0] = m_boundsMin[0] + (tileX + 1) * m_tileSize;
-  tileBmax[1] = m_boundsMax[1];
-  tileBmax[2] = m_boundsMin[2] + (tileY + 1) * m_tileSize;
-
-  // Espandi per il bordo
-  float borderSize = m_cfg.borderSize * m_cfg.cs;
-  tileBmin[0] -= borderSize;
-  tileBmin[2] -= borderSize;
-  tileBmax[0] += borderSize;
-  tileBmax[2] += borderSize;
-
-  // Setup config per questa tile
-  rcConfig tileCfg = m_cfg;
-  rcVcopy(tileCfg.bmin, tileBmin);
-  rcVcopy(tileCfg.bmax, tileBmax);
-
-  rcCalcGridSize(tileCfg.bmin, tileCfg.bmax, tileCfg.cs, &tileCfg.width,
-                 &tileCfg.height);
-
-  // Se la tile è troppo piccola, skip
-  if (tileCfg.width < 3 || tileCfg.height < 3) {
-    return nullptr;
-  }
-
-  // 1. Heightfield
-  rcHeightfield *hf = rcAllocHeightfield();
-  if (!hf)
-    return nullptr;
-
-  if (!rcCreateHeightfield(m_ctx, *hf, tileCfg.width, tileCfg.height,
-                           tileCfg.bmin, tileCfg.bmax, tileCfg.cs,
-                           tileCfg.ch)) {
-    rcFreeHeightField(hf);
-    return nullptr;
-  }
-
-  // Rasterizza i triangoli
-  unsigned char *areas = new unsigned char[m_storedTriCount];
-  memset(areas, 0, m_storedTriCount);
-
-  rcMarkWalkableTriangles(m_ctx, tileCfg.walkableSlopeAngle,
-                          m_storedVerts.data(), m_storedVertCount,
-                          m_storedTris.data(), m_storedTriCount, areas);
-
-  if (!rcRasterizeTriangles(m_ctx, m_storedVerts.data(), m_storedVertCount,
-                            m_storedTris.data(), areas, m_storedTriCount, *hf,
-                            tileCfg.walkableClimb)) {
-    delete[] areas;
-    rcFreeHeightField(hf);
-    return nullptr;
+void NavMesh::countPolygons() {
+  m_totalPolygons = 0;
+  const dtNavMesh *navMesh = m_navMesh;
+  if (!navMesh)
+    return;
+  int maxTiles = navMesh->getMaxTiles();
+  for (int i = 0; i < maxTiles; i++) {
+    const dtMeshTile *tile = navMesh->getTile(i);
+    if (tile && tile->header) {
+      m_totalPolygons += tile->header->polyCount;
+    }
   }
-  delete[] areas;
-
-  // 2. Filtraggio
-  rcFilterLowHangingWalkableObstacles(m_ctx, tileCfg.walkableClimb, *hf);
-  rcFilterLedgeSpans(m_ctx, tileCfg.walkableHeight, tileCfg.walkableClimb, *hf);
-  rcFilterWalkableLowHeightSpans(m_ctx, tileCfg.walkableHeight, *hf);
+}
 
-  // 3. Compact heightfield
-  rcCompactHeightfield *chf = rcAllocCompactHeightfield();
-  if (!chf) {
-    rcFreeHeightField(hf);
-    return nullptr;
+bool NavMesh::buildTileColumn(TileBuildScratch &scratch, int tileX, int tileY,
+                              TileColumn &column) {
+  PROFILE_SCOPE("NavMesh::buildTileColumn");
+  // Contesto e buffer per-thread: nessuno stato condiviso viene modificato
+  const size_t allocSize = tileAllocatorSize(m_cfg.tileSize);
+  if (!scratch.talloc || scratch.talloc->capacity != allocSize) {
+    scratch.talloc = std::make_unique<LinearAllocator>(allocSize);
   }
 
-  if (!rcBuildCompactHeightfield(m_ctx, tileCfg.walkableHeight,
-                                 tileCfg.walkableClimb, *hf, *chf)) {
-    rcFreeHeightField(hf);
-    rcFreeCompactHeightfield(chf);
-    return nullptr;
-  }
-  rcFreeHeightField(hf);
+  TileCacheData layers[MAX_TILE_LAYERS];
+  int layerCount =
+      rasterizeTileLayers(scratch, tileX, tileY, layers, MAX_TILE_LAYERS);
 
-  // 4. Erosione
-  if (!rcErodeWalkableArea(m_ctx, tileCfg.walkableRadius, *chf)) {
-    rcFreeCompactHeightfield(chf);
-    return nullptr;
-  }
+  for (int i = 0; i < layerCount; i++) {
+    column.layers.push_back(layers[i]);
 
-  // 4.5 Mark obstacle areas as non-walkable
-  for (const auto &obstacle : m_obstacles) {
-    float obmin[3] = {obstacle.bounds.min.x, obstacle.bounds.min.y,
-                      obstacle.bounds.min.z};
-    float obmax[3] = {obstacle.bounds.max.x, obstacle.bounds.max.y,
-                      obstacle.bounds.max.z};
-    rcMarkBoxArea(m_ctx, obmin, obmax, RC_NULL_AREA, *chf);
-  }
+    int dataSize = 0;
+    unsigned char *data = buildLayerNavData(*scratch.talloc, layers[i].data,
+                                            layers[i].dataSize, dataSize);
+    if (!data)
+      continue; // Layer senza poligoni walkable
 
-  // 5. Distance field e regioni
-  if (!rcBuildDistanceField(m_ctx, *chf)) {
-    rcFreeCompactHeightfield(chf);
-    return nullptr;
+    column.navTiles.push_back({data, dataSize});
+    column.maxPolys = std::max(
+        column.maxPolys, ((const dtMeshHeader *)data)->polyCount);
   }
 
-  if (!rcBuildRegions(m_ctx, *chf, tileCfg.borderSize, tileCfg.minRegionArea,
-                      tileCfg.mergeRegionArea)) {
-    rcFreeCompactHeightfield(chf);
-    return nullptr;
-  }
+  return !column.navTiles.empty();
+}
 
-  // 6. Contours
-  rcContourSet *cset = rcAllocContourSet();
-  if (!cset) {
-    rcFreeCompactHeightfield(chf);
-    return nullptr;
-  }
+// Stessa pipeline di dtTileCache::buildNavMeshTile, senza ostacoli e con
+// un allocatore proprio, cosi' i worker del build possono eseguirla in
+// parallelo. Niente detail mesh: le altezze dei poligoni bastano, i
+// personaggi seguono l'heightfield del terreno.
+unsigned char *NavMesh::buildLayerNavData(LinearAllocator &alloc,
+                                          unsigned char *layerData,
+                                          int layerSize, int &dataSize) {
+  dataSize = 0;
+  const dtTileCacheParams &tcparams = m_tileCacheParams;
+  const int walkableClimbVx = (int)(tcparams.walkableClimb / tcparams.ch);
 
-  if (!rcBuildContours(m_ctx, *chf, tileCfg.maxSimplificationError,
-                       tileCfg.maxEdgeLen, *cset)) {
-    rcFreeCompactHeightfield(chf);
-    rcFreeContourSet(cset);
-    return nullptr;
-  }
+  // Il LinearAllocator non libera le singole allocazioni: tutto torna
+  // disponibile al prossimo reset
+  alloc.reset();
 
-  // 7. Poly mesh
-  rcPolyMesh *pmesh = rcAllocPolyMesh();
-  if (!pmesh) {
-    rcFreeCompactHeightfield(chf);
-    rcFreeContourSet(cset);
-    return nullptr;
-  }
+  dtTileCacheLayer *layer = nullptr;
+  dtStatus status =
+      dtDecompressTileCacheLayer(&alloc, m_tcomp, layerData, layerSize, &layer);
+  if (dtStatusSucceed(status))
+    status = dtBuildTileCacheRegions(&alloc, *layer, walkableClimbVx);
 
-  if (!rcBuildPolyMesh(m_ctx, *cset, tileCfg.maxVertsPerPoly, *pmesh)) {
-    rcFreeCompactHeightfield(chf);
-    rcFreeContourSet(cset);
-    rcFreePolyMesh(pmesh);
-    return nullptr;
+  dtTileCacheContourSet *lcset = nullptr;
+  if (dtStatusSucceed(status)) {
+    lcset = dtAllocTileCacheContourSet(&alloc);
+    status = lcset ? dtBuildTileCacheContours(&alloc, *layer, walkableClimbVx,
+                                              tcparams.maxSimplificationError,
+                                              *lcset)
+                   : DT_FAILURE | DT_OUT_OF_MEMORY;
   }
 
-  // 8. Detail mesh
-  rcPolyMeshDetail *dmesh = rcAllocPolyMeshDetail();
-  if (!dmesh) {
-    rcFreeCompactHeightfield(chf);
-    rcFreeContourSet(cset);
-    rcFreePolyMesh(pmesh);
-    return nullptr;
+  dtTileCachePolyMesh *lmesh = nullptr;
+  if (dtStatusSucceed(status)) {
+    lmesh = dtAllocTileCachePolyMesh(&alloc);
+    status = lmesh ? dtBuildTileCachePolyMesh(&alloc, *lcset, *lmesh)
+                   : DT_FAILURE | DT_OUT_OF_MEMORY;
   }
 
-  if (!rcBuildPolyMeshDetail(m_ctx, *pmesh, *chf, tileCfg.detailSampleDist,
-                             tileCfg.detailSampleMaxError, *dmesh)) {
-    rcFreeCompactHeightfield(chf);
-    rcFreeContourSet(cset);
-    rcFreePolyMesh(pmesh);
-    rcFreePolyMeshDetail(dmesh);
+  if (dtStatusFailed(status)) {
+    const dtTileCacheLayerHeader *header =
+        (const dtTileCacheLayerHeader *)layerData;
+    TraceLog(LOG_WARNING, "NavMesh: Failed to build layer %d of tile (%d, %d)",
+             header->tlayer, header->tx, header->ty);
     return nullptr;
   }
 
-  rcFreeCompactHeightfield(chf);
-  rcFreeContourSet(cset);
-
   // Se non ci sono poligoni, tile vuota
-  if (pmesh->npolys == 0) {
-    rcFreePolyMesh(pmesh);
-    rcFreePolyMeshDetail(dmesh);
+  if (lmesh->npolys == 0)
     return nullptr;
-  }
-
-  // Setup flags
-  for (int i = 0; i < pmesh->npolys; i++) {
-    pmesh->flags[i] = 1; // Walkable
-  }
 
-  // Debug data - store reference to tile coords only (no manual mesh copy)
-  TileCoord tc = {tileX, tileY};
-  m_tileDebugData[tc].polyMesh = nullptr;
-  m_tileDebugData[tc].meshBuilt = false;
-
-  // 9. Crea dati navmesh per Detour
+  const dtTileCacheLayerHeader *header = layer->header;
   dtNavMeshCreateParams params;
   memset(&params, 0, sizeof(params));
-  params.verts = pmesh->verts;
-  params.vertCount = pmesh->nverts;
-  params.polys = pmesh->polys;
-  params.polyAreas = pmesh->areas;
-  params.polyFlags = pmesh->flags;
-  params.polyCount = pmesh->npolys;
-  params.nvp = pmesh->nvp;
-  params.detailMeshes = dmesh->meshes;
-  params.detailVerts = dmesh->verts;
-  params.detailVertsCount = dmesh->nverts;
-  params.detailTris = dmesh->tris;
-  params.detailTriCount = dmesh->ntris;
-  params.walkableHeight = m_agentHeight;
-  params.walkableRadius = m_agentRadius;
-  params.walkableClimb = m_agentMaxClimb;
-  params.cs = tileCfg.cs;
-  params.ch = tileCfg.ch;
-  params.buildBvTree = true;
-  params.tileX = tileX;
-  params.tileY = tileY;
-  params.tileLayer = 0;
-  rcVcopy(params.bmin, pmesh->bmin);
-  rcVcopy(params.bmax, pmesh->bmax);
+  params.verts = lmesh->verts;
+  params.vertCount = lmesh->nverts;
+  params.polys = lmesh->polys;
+  params.polyAreas = lmesh->areas;
+  params.polyFlags = lmesh->flags;
+  params.polyCount = lmesh->npolys;
+  params.nvp = DT_VERTS_PER_POLYGON;
+  params.walkableHeight = tcparams.walkableHeight;
+  params.walkableRadius = tcparams.walkableRadius;
+  params.walkableClimb = tcparams.walkableClimb;
+  params.tileX = header->tx;
+  params.tileY = header->ty;
+  params.tileLayer = header->tlayer;
+  params.cs = tcparams.cs;
+  params.ch = tcparams.ch;
+  params.buildBvTree = false;
+  rcVcopy(params.bmin, header->bmin);
+  rcVcopy(params.bmax, header->bmax);
+
+  m_tmproc->process(&params, lmesh->areas, lmesh->flags);
 
   unsigned char *navData = nullptr;
   if (!dtCreateNavMeshData(&params, &navData, &dataSize)) {
-    rcFreePolyMesh(pmesh);
-    rcFreePolyMeshDetail(dmesh);
+    dataSize = 0;
     return nullptr;
   }
+  return navData;
+}
 
-  m_totalPolygons += pmesh->npolys;
+bool NavMesh::addTileColumn(TileColumn &column) {
+  // Il tile cache diventa proprietario dei layer, la navmesh delle tile
+  for (auto &layer : column.layers) {
+    dtStatus status = m_tileCache->addTile(
+        layer.data, layer.dataSize, DT_COMPRESSEDTILE_FREE_DATA, nullptr);
+    if (dtStatusFailed(status)) {
+      const dtTileCacheLayerHeader *header =
+          (const dtTileCacheLayerHeader *)layer.data;
+      TraceLog(LOG_ERROR, "NavMesh: Failed to add layer %d of tile (%d, %d)",
+               header->tlayer, header->tx, header->ty);
+      dtFree(layer.data);
+    }
+  }
 
-  rcFreePolyMesh(pmesh);
-  rcFreePolyMeshDetail(dmesh);
+  int addedTiles = 0;
+  for (auto &tile : column.navTiles) {
+    dtStatus status =
+        m_navMesh->addTile(tile.data, tile.dataSize, DT_TILE_FREE_DATA, 0, 0);
+    if (dtStatusFailed(status)) {
+      const dtMeshHeader *header = (const dtMeshHeader *)tile.data;
+      TraceLog(LOG_ERROR, "NavMesh: Failed to add tile (%d, %d)", header->x,
+               header->y);
+      dtFree(tile.data);
+      continue;
+    }
+    addedTiles++;
+  }
 
-  return navData;
+  column.layers.clear();
+  column.navTiles.clear();
+  return addedTiles > 0;
 }
 
 bool NavMesh::buildTile(int tileX, int tileY) {
-  if (!m_navMesh) {
+  PROFILE_SCOPE("NavMesh::buildTile");
+  if (!m_navMesh || !m_tileCache) {
     TraceLog(LOG_ERROR, "NavMesh: NavMesh not initialized");
     return false;
   }
 
-  // Rimuovi tile esistente
-  dtTileRef existingTile = m_navMesh->getTileRefAt(tileX, tileY, 0);
-  if (existingTile) {
-    m_navMesh->removeTile(existingTile, nullptr, nullptr);
-  }
+  // Tutti i layer della colonna, dal tile cache e con gli ostacoli
+  dtStatus status = m_tileCache->buildNavMeshTilesAt(tileX, tileY, m_navMesh);
+  m_debugMeshBuilt = false;
+  return dtStatusSucceed(status);
+}
 
-  // Costruisci i dati della tile
-  int dataSize = 0;
-  unsigned char *data = buildTileData(tileX, tileY, dataSize);
+int NavMesh::computeTileCells() const {
+  // Tile size in celle, multiplo esatto della cella: navmesh e tile cache
+  // devono avere la stessa griglia di tile. I layer del tile cache hanno
+  // dimensioni a 8 bit, bordo compreso (stesso bordo di buildTiled).
+  const int borderSize = (int)ceilf(m_agentRadius / m_cellSize) + 3;
+  return std::clamp((int)(m_tileSize / m_cellSize + 0.5f), 16,
+                    255 - 2 * borderSize);
+}
 
-  if (!data) {
-    // Tile vuota - nessun poligono walkable
-    return false;
-  }
+void NavMesh::buildTilesParallel(int threadCount,
+                                 std::vector<TileColumn> &columns,
+                                 const ProgressCallback &progressCallback) {
+  PROFILE_SCOPE("NavMesh::buildTilesParallel");
+  const int totalTiles = (int)columns.size();
+
+  // Al piu' threadCount intervalli di colonne sul JobSystem. Ogni
+  // intervallo ha il proprio rcContext, allocatore e buffer temporanei.
+  // Il progresso lo riporta solo il main thread (che esegue job mentre
+  // aspetta) leggendo il contatore incrementato dai worker.
+  const int grain = (totalTiles + threadCount - 1) / threadCount;
+  const std::thread::id mainThread = std::this_thread::get_id();
+  std::atomic<int> completed{0};
+  int reported = 0;
+
+  auto report = [&]() {
+    const int count = completed.load(std::memory_order_relaxed);
+    if (progressCallback && count > reported) {
+      reported = count;
+      progressCallback(count, totalTiles);
+    }
+  };
 
-  // Aggiungi la tile
-  dtStatus status =
-      m_navMesh->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, nullptr);
-  if (dtStatusFailed(status)) {
-    dtFree(data);
-    TraceLog(LOG_ERROR, "NavMesh: Failed to add tile (%d, %d)", tileX, tileY);
-    return false;
-  }
+  JobSystem::getInstance().parallel_for(
+      totalTiles, grain, [&](int begin, int end) {
+        rcContext ctx;
+        TileBuildScratch scratch;
+        scratch.ctx = &ctx;
+        for (int i = begin; i < end; i++) {
+          buildTileColumn(scratch, i % m_tilesX, i / m_tilesX, columns[i]);
+          completed.fetch_add(1, std::memory_order_relaxed);
+          if (std::this_thread::get_id() == mainThread) {
+            report();
+          }
+        }
+      });
 
-  return true;
+  report();
 }
 
 bool NavMesh::removeTile(int tileX, int tileY) {
   if (!m_navMesh)
     return false;
 
-  dtTileRef ref = m_navMesh->getTileRefAt(tileX, tileY, 0);
-  if (ref) {
-    m_navMesh->removeTile(ref, nullptr, nullptr);
+  // Tutti i layer della colonna
+  const dtMeshTile *tiles[MAX_TILE_LAYERS];
+  int count = m_navMesh->getTilesAt(tileX, tileY, tiles, MAX_TILE_LAYERS);
+  dtTileRef refs[MAX_TILE_LAYERS];
+  for (int i = 0; i < count; i++)
+    refs[i] = m_navMesh->getTileRef(tiles[i]);
+
+  if (count > 0) {
+    for (int i = 0; i < count; i++)
+      m_navMesh->removeTile(refs[i], nullptr, nullptr);
 
     // Rimuovi debug data
     TileCoord tc = {tileX, tileY};
@@ -878,6 +916,7 @@ bool NavMesh::rebuildTile(int tileX, int tileY) {
 }
 
 std::vector<Vector3> NavMesh::findPath(Vector3 start, Vector3 end) {
+  PROFILE_SCOPE("NavMesh::findPath");
   std::vector<Vector3> pathPoints;
 
   if (!m_navMesh || !m_navQuery) {
@@ -990,6 +1029,29 @@ bool NavMesh::projectPointToNavMesh(Vector3 point, Vector3 &projectedPoint) {
   return false;
 }
 
+static float navRandomFloat() {
+  return (float)GetRandomValue(0, 32767) / 32768.0f;
+}
+
+bool NavMesh::findRandomPoint(Vector3 &outPoint) {
+  if (!m_navMesh || !m_navQuery)
+    return false;
+
+  dtQueryFilter filter;
+  filter.setIncludeFlags(0xFFFF);
+  filter.setExcludeFlags(0);
+
+  dtPolyRef polyRef = 0;
+  float point[3];
+  dtStatus status =
+      m_navQuery->findRandomPoint(&filter, navRandomFloat, &polyRef, point);
+  if (dtStatusFailed(status) || !polyRef)
+    return false;
+
+  outPoint = {point[0], point[1], point[2]};
+  return true;
+}
+
 void NavMesh::buildDebugMesh() {
   // Usa il nuovo metodo che legge direttamente da dtNavMesh
   buildDebugMeshFromNavMesh();
@@ -1119,184 +1181,338 @@ void NavMesh::drawDebug() {
   }
 }
 
-// Header per il file binario navmesh
+// Cache su disco (navmesh.bin), versione 4:
+//   NavMeshCacheHeader
+//   NavMeshCacheTile[tileCount]    directory delle tile Detour
+//   NavMeshCacheTile[layerCount]   directory dei layer del tile cache
+//   blob, allineati a NAVMESH_TILE_ALIGN
+// Il file viene mappato in memoria: le tile non compresse e i layer (gia'
+// compressi dal tile cache) passano a Detour senza copie. sourceHash
+// identifica geometria e parametri: se non corrisponde la cache e'
+// obsoleta e la navmesh va ricostruita.
 static const int NAVMESH_FILE_MAGIC = 0x4E4D5348; // 'NMSH' in hex
-static const int NAVMESH_FILE_VERSION = 1;
+static const int NAVMESH_FILE_VERSION = 4;
+static const size_t NAVMESH_TILE_ALIGN = 16;
 
-bool NavMesh::saveToFile(const std::string &filename) {
-  if (!m_navMesh) {
-    TraceLog(LOG_ERROR, "NavMesh: Cannot save - navmesh not built");
-    return false;
-  }
+struct NavMeshCacheHeader {
+  int magic;
+  int version;
+  uint64_t sourceHash;
+  dtNavMeshParams params;
+  dtTileCacheParams tileCacheParams;
+  float boundsMin[3];
+  float boundsMax[3];
+  int tilesX;
+  int tilesZ;
+  int tileCount;
+  int layerCount;
+};
+
+struct NavMeshCacheTile {
+  uint64_t offset; // dall'inizio del file
+  int dataSize;    // byte della tile per Detour
+  int storedSize;  // byte nel file: == dataSize se non compressa (LZ4)
+};
+
+static size_t alignTileOffset(size_t offset) {
+  return (offset + NAVMESH_TILE_ALIGN - 1) & ~(NAVMESH_TILE_ALIGN - 1);
+}
 
-  std::ofstream file(filename, std::ios::binary);
-  if (!file.is_open()) {
-    TraceLog(LOG_ERROR, "NavMesh: Cannot open file for writing: %s",
-             filename.c_str());
-    return false;
+// FNV-1a a 64 bit
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
   }
+  return hash;
+}
 
-  // Scrivi header
-  file.write(reinterpret_cast<const char *>(&NAVMESH_FILE_MAGIC), sizeof(int));
-  file.write(reinterpret_cast<const char *>(&NAVMESH_FILE_VERSION),
-             sizeof(int));
-
-  // Scrivi parametri navmesh
-  const dtNavMeshParams *params = m_navMesh->getParams();
-  file.write(reinterpret_cast<const char *>(params), sizeof(dtNavMeshParams));
+uint64_t NavMesh::computeSourceHash(const Mesh &mesh, Matrix transform) const {
+  PROFILE_SCOPE("NavMesh::computeSourceHash");
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  hash = hashBytes(hash, &NAVMESH_FILE_VERSION, sizeof(int));
+  const float params[] = {m_cellSize,        m_cellHeight,    m_agentHeight,
+                          m_agentRadius,     m_agentMaxClimb, m_agentMaxSlope,
+                          m_minRegionArea,   m_mergeRegionArea,
+                          m_maxSimplificationError};
+  hash = hashBytes(hash, params, sizeof(params));
+  // Le tile in celle usate dal build, non m_tileSize: richieste diverse che
+  // danno la stessa griglia condividono la cache
+  const int tileCells = computeTileCells();
+  hash = hashBytes(hash, &tileCells, sizeof(int));
+  hash = hashBytes(hash, &transform, sizeof(Matrix));
+  hash = hashBytes(hash, &mesh.vertexCount, sizeof(int));
+  hash = hashBytes(hash, &mesh.triangleCount, sizeof(int));
+  if (mesh.vertices)
+    hash = hashBytes(hash, mesh.vertices, sizeof(float) * 3 * mesh.vertexCount);
+  if (mesh.indices)
+    hash = hashBytes(hash, mesh.indices,
+                     sizeof(unsigned short) * 3 * mesh.triangleCount);
+  return hash;
+}
 
-  // Scrivi bounds
-  file.write(reinterpret_cast<const char *>(m_boundsMin), sizeof(float) * 3);
-  file.write(reinterpret_cast<const char *>(m_boundsMax), sizeof(float) * 3);
+void NavMesh::freeNavMesh() {
+  if (m_tileCache) {
+    dtFreeTileCache(m_tileCache);
+    m_tileCache = nullptr;
+  }
+  if (m_navMesh) {
+    dtFreeNavMesh(m_navMesh);
+    m_navMesh = nullptr;
+  }
+  // Per ultimo: tile e layer caricati dalla cache puntano nel mapping
+  m_cacheMapping.close();
+  m_generation++;
+}
 
-  // Scrivi numero di tiles
-  const dtNavMesh *navMesh = m_navMesh;
-  int maxTiles = navMesh->getMaxTiles();
-  int numTiles = 0;
+void NavMesh::unload() {
+  cleanupTileDebugData();
+  freeNavMesh();
+  m_tileCount = 0;
+  m_totalPolygons = 0;
+  m_debugMeshBuilt = false;
+}
 
-  // Conta tiles valide
-  for (int i = 0; i < maxTiles; i++) {
-    const dtMeshTile *tile = navMesh->getTile(i);
-    if (tile && tile->header && tile->dataSize > 0) {
-      numTiles++;
-    }
+bool NavMesh::saveToFile(const std::string &filename) {
+  PROFILE_SCOPE("NavMesh::saveToFile");
+  if (!m_navMesh || !m_tileCache) {
+    TraceLog(LOG_ERROR, "NavMesh: Cannot save - navmesh not built");
+    return false;
   }
 
-  file.write(reinterpret_cast<const char *>(&numTiles), sizeof(int));
-
-  // Scrivi ogni tile
-  for (int i = 0; i < maxTiles; i++) {
+  // Tile valide, eventualmente compresse, seguite dai layer
+  struct PendingTile {
+    const unsigned char *data;
+    int dataSize;
+    std::vector<unsigned char> compressed;
+  };
+  const dtNavMesh *navMesh = m_navMesh;
+  std::vector<PendingTile> tiles;
+  for (int i = 0; i < navMesh->getMaxTiles(); i++) {
     const dtMeshTile *tile = navMesh->getTile(i);
     if (!tile || !tile->header || tile->dataSize <= 0)
       continue;
-
-    // Scrivi tile reference
-    dtTileRef tileRef = m_navMesh->getTileRef(tile);
-    file.write(reinterpret_cast<const char *>(&tileRef), sizeof(dtTileRef));
-
-    // Scrivi dimensione dati tile
-    int dataSize = tile->dataSize;
-    file.write(reinterpret_cast<const char *>(&dataSize), sizeof(int));
-
-    // Scrivi dati tile
-    file.write(reinterpret_cast<const char *>(tile->data), dataSize);
+    PendingTile pending{tile->data, tile->dataSize, {}};
+    if (m_compressCache) {
+      pending.compressed.resize(lz4CompressBound(tile->dataSize));
+      int size = lz4Compress(tile->data, tile->dataSize, pending.compressed.data(),
+                             (int)pending.compressed.size());
+      // Non conviene: resta mappabile senza copie
+      pending.compressed.resize(size > 0 && size < tile->dataSize ? size : 0);
+    }
+    tiles.push_back(std::move(pending));
+  }
+  const int tileCount = (int)tiles.size();
+  for (int i = 0; i < m_tileCache->getTileCount(); i++) {
+    const dtCompressedTile *layer = m_tileCache->getTile(i);
+    if (!layer || !layer->header || layer->dataSize <= 0)
+      continue;
+    tiles.push_back({layer->data, layer->dataSize, {}});
+  }
+
+  NavMeshCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = NAVMESH_FILE_MAGIC;
+  header.version = NAVMESH_FILE_VERSION;
+  header.sourceHash = m_sourceHash;
+  header.params = *navMesh->getParams();
+  header.tileCacheParams = *m_tileCache->getParams();
+  rcVcopy(header.boundsMin, m_boundsMin);
+  rcVcopy(header.boundsMax, m_boundsMax);
+  header.tilesX = m_tilesX;
+  header.tilesZ = m_tilesZ;
+  header.tileCount = tileCount;
+  header.layerCount = (int)tiles.size() - tileCount;
+
+  std::vector<NavMeshCacheTile> directory(tiles.size());
+  size_t offset = sizeof(NavMeshCacheHeader) + sizeof(NavMeshCacheTile) * tiles.size();
+  m_fileRawBytes = 0;
+  m_fileCompressedBytes = 0;
+  for (size_t i = 0; i < tiles.size(); i++) {
+    offset = alignTileOffset(offset);
+    directory[i].offset = offset;
+    directory[i].dataSize = tiles[i].dataSize;
+    directory[i].storedSize = tiles[i].compressed.empty()
+                                  ? tiles[i].dataSize
+                                  : (int)tiles[i].compressed.size();
+    offset += directory[i].storedSize;
+    if ((int)i < tileCount) {
+      m_fileRawBytes += directory[i].dataSize;
+      m_fileCompressedBytes += directory[i].storedSize;
+    }
   }
 
+  // File temporaneo + rename: il file corrente puo' essere mappato
+  const std::string tempFile = filename + ".tmp";
+  std::ofstream file(tempFile, std::ios::binary);
+  if (!file.is_open()) {
+    TraceLog(LOG_ERROR, "NavMesh: Cannot open file for writing: %s",
+             tempFile.c_str());
+    return false;
+  }
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(directory.data()),
+             sizeof(NavMeshCacheTile) * directory.size());
+  static const char padding[NAVMESH_TILE_ALIGN] = {};
+  size_t written = sizeof(NavMeshCacheHeader) + sizeof(NavMeshCacheTile) * tiles.size();
+  for (size_t i = 0; i < tiles.size(); i++) {
+    file.write(padding, directory[i].offset - written);
+    const unsigned char *blob =
+        tiles[i].compressed.empty() ? tiles[i].data : tiles[i].compressed.data();
+    file.write(reinterpret_cast<const char *>(blob), directory[i].storedSize);
+    written = directory[i].offset + directory[i].storedSize;
+  }
   file.close();
+  if (!file) {
+    TraceLog(LOG_ERROR, "NavMesh: Failed to write %s", tempFile.c_str());
+    std::remove(tempFile.c_str());
+    return false;
+  }
+
+  std::remove(filename.c_str());
+  if (std::rename(tempFile.c_str(), filename.c_str()) != 0) {
+    TraceLog(LOG_ERROR, "NavMesh: Cannot replace %s", filename.c_str());
+    std::remove(tempFile.c_str());
+    return false;
+  }
 
-  TraceLog(LOG_INFO, "NavMesh: Saved to %s (%d tiles)", filename.c_str(),
-           numTiles);
+  TraceLog(LOG_INFO,
+           "NavMesh: Saved to %s (%d tiles, %d layers, %d KB, hash %016llx)",
+           filename.c_str(), header.tileCount, header.layerCount,
+           (int)(written / 1024), (unsigned long long)m_sourceHash);
   return true;
 }
 
-bool NavMesh::loadFromFile(const std::string &filename) {
-  std::ifstream file(filename, std::ios::binary);
-  if (!file.is_open()) {
+bool NavMesh::loadFromFile(const std::string &filename, uint64_t sourceHash) {
+  PROFILE_SCOPE("NavMesh::loadFromFile");
+  auto loadStart = std::chrono::steady_clock::now();
+  MappedFile mapping;
+  if (!mapping.open(filename)) {
     TraceLog(LOG_INFO, "NavMesh: Cache file not found: %s", filename.c_str());
     return false;
   }
 
-  // Leggi e verifica header
-  int magic, version;
-  file.read(reinterpret_cast<char *>(&magic), sizeof(int));
-  file.read(reinterpret_cast<char *>(&version), sizeof(int));
-
-  if (magic != NAVMESH_FILE_MAGIC) {
+  // Verifica header, versione, hash e directory prima di toccare la
+  // navmesh corrente
+  if (mapping.size() < sizeof(NavMeshCacheHeader)) {
     TraceLog(LOG_ERROR, "NavMesh: Invalid file format");
-    file.close();
     return false;
   }
-
-  if (version != NAVMESH_FILE_VERSION) {
+  NavMeshCacheHeader header;
+  memcpy(&header, mapping.data(), sizeof(header));
+  if (header.magic != NAVMESH_FILE_MAGIC) {
+    TraceLog(LOG_ERROR, "NavMesh: Invalid file format");
+    return false;
+  }
+  if (header.version != NAVMESH_FILE_VERSION) {
     TraceLog(LOG_WARNING, "NavMesh: Version mismatch (file: %d, expected: %d)",
-             version, NAVMESH_FILE_VERSION);
-    file.close();
+             header.version, NAVMESH_FILE_VERSION);
     return false;
   }
-
-  // Leggi parametri navmesh
-  dtNavMeshParams params;
-  file.read(reinterpret_cast<char *>(&params), sizeof(dtNavMeshParams));
-
-  // Leggi bounds
-  file.read(reinterpret_cast<char *>(m_boundsMin), sizeof(float) * 3);
-  file.read(reinterpret_cast<char *>(m_boundsMax), sizeof(float) * 3);
-
-  // Cleanup navmesh esistente
-  if (m_navMesh) {
-    dtFreeNavMesh(m_navMesh);
-    m_navMesh = nullptr;
+  if (header.sourceHash != sourceHash) {
+    TraceLog(LOG_WARNING,
+             "NavMesh: Cache is stale (hash %016llx, expected %016llx)",
+             (unsigned long long)header.sourceHash,
+             (unsigned long long)sourceHash);
+    return false;
+  }
+  const int entryCount = header.tileCount + header.layerCount;
+  const size_t directoryEnd =
+      sizeof(NavMeshCacheHeader) + sizeof(NavMeshCacheTile) * (size_t)entryCount;
+  if (header.tileCount <= 0 || header.layerCount <= 0 ||
+      header.tileCacheParams.width <= 0 || directoryEnd > mapping.size()) {
+    TraceLog(LOG_ERROR, "NavMesh: Invalid tile directory");
+    return false;
+  }
+  const NavMeshCacheTile *directory =
+      reinterpret_cast<const NavMeshCacheTile *>(mapping.data() + sizeof(NavMeshCacheHeader));
+  for (int i = 0; i < entryCount; i++) {
+    const NavMeshCacheTile &entry = directory[i];
+    if (entry.dataSize <= 0 || entry.storedSize <= 0 ||
+        entry.offset % NAVMESH_TILE_ALIGN != 0 || entry.offset < directoryEnd ||
+        entry.offset + (uint64_t)entry.storedSize > mapping.size() ||
+        (i >= header.tileCount && entry.storedSize != entry.dataSize)) {
+      TraceLog(LOG_ERROR, "NavMesh: Invalid tile %d in cache", i);
+      return false;
+    }
   }
 
-  // Crea nuova navmesh
+  freeNavMesh();
   m_navMesh = dtAllocNavMesh();
   if (!m_navMesh) {
     TraceLog(LOG_ERROR, "NavMesh: Failed to allocate navmesh");
-    file.close();
     return false;
   }
-
-  dtStatus status = m_navMesh->init(&params);
+  dtStatus status = m_navMesh->init(&header.params);
+  if (dtStatusSucceed(status))
+    status = m_navQuery->init(m_navMesh, 2048);
   if (dtStatusFailed(status)) {
     TraceLog(LOG_ERROR, "NavMesh: Failed to init navmesh from file");
-    dtFreeNavMesh(m_navMesh);
-    m_navMesh = nullptr;
-    file.close();
+    freeNavMesh();
     return false;
   }
-
-  // Init query
-  status = m_navQuery->init(m_navMesh, 2048);
-  if (dtStatusFailed(status)) {
-    TraceLog(LOG_ERROR, "NavMesh: Failed to init navmesh query");
-    dtFreeNavMesh(m_navMesh);
-    m_navMesh = nullptr;
-    file.close();
+  rcVcopy(m_boundsMin, header.boundsMin);
+  rcVcopy(m_boundsMax, header.boundsMax);
+  m_builtTileSize = header.params.tileWidth;
+  m_maxTiles = header.params.maxTiles;
+  m_maxPolysPerTile = header.params.maxPolys;
+  m_tilesX = header.tilesX;
+  m_tilesZ = header.tilesZ;
+  m_tileCacheParams = header.tileCacheParams;
+  if (!initTileCache()) {
+    freeNavMesh();
     return false;
   }
-
-  // Leggi numero di tiles
-  int numTiles;
-  file.read(reinterpret_cast<char *>(&numTiles), sizeof(int));
-
+  m_sourceHash = header.sourceHash;
   m_tileCount = 0;
   m_totalPolygons = 0;
-
-  // Leggi ogni tile
-  for (int i = 0; i < numTiles; i++) {
-    // Leggi tile reference (non usata per l'aggiunta)
-    dtTileRef tileRef;
-    file.read(reinterpret_cast<char *>(&tileRef), sizeof(dtTileRef));
-
-    // Leggi dimensione dati
-    int dataSize;
-    file.read(reinterpret_cast<char *>(&dataSize), sizeof(int));
-
-    if (dataSize <= 0) {
-      TraceLog(LOG_WARNING, "NavMesh: Invalid tile data size");
-      continue;
-    }
-
-    // Alloca e leggi dati tile
-    unsigned char *data = (unsigned char *)dtAlloc(dataSize, DT_ALLOC_PERM);
-    if (!data) {
-      TraceLog(LOG_ERROR, "NavMesh: Failed to allocate tile data");
-      continue;
+  m_fileRawBytes = 0;
+  m_fileCompressedBytes = 0;
+  m_fileDecodeMs = 0.0;
+  int mappedTiles = 0;
+
+  for (int i = 0; i < header.tileCount; i++) {
+    const NavMeshCacheTile &entry = directory[i];
+    unsigned char *blob = mapping.data() + entry.offset;
+    unsigned char *data = blob;
+    int flags = 0;
+    if (entry.storedSize != entry.dataSize) {
+      // Compressa: decodificata in memoria posseduta da Detour
+      data = (unsigned char *)dtAlloc(entry.dataSize, DT_ALLOC_PERM);
+      if (!data) {
+        TraceLog(LOG_ERROR, "NavMesh: Failed to allocate tile data");
+        continue;
+      }
+      auto decodeStart = std::chrono::steady_clock::now();
+      int decoded = lz4Decompress(blob, entry.storedSize, data, entry.dataSize);
+      m_fileDecodeMs += std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - decodeStart)
+                            .count();
+      if (decoded != entry.dataSize) {
+        dtFree(data);
+        TraceLog(LOG_WARNING, "NavMesh: Corrupted tile %d", i);
+        continue;
+      }
+      flags = DT_TILE_FREE_DATA;
     }
 
-    file.read(reinterpret_cast<char *>(data), dataSize);
-
-    // Aggiungi tile
+    // Senza DT_TILE_FREE_DATA Detour usa il blob mappato in place (i link
+    // scritti da addTile finiscono nelle pagine copy-on-write)
     dtTileRef resultRef;
-    status =
-        m_navMesh->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, &resultRef);
+    status = m_navMesh->addTile(data, entry.dataSize, flags, 0, &resultRef);
     if (dtStatusFailed(status)) {
-      dtFree(data);
+      if (flags & DT_TILE_FREE_DATA)
+        dtFree(data);
       TraceLog(LOG_WARNING, "NavMesh: Failed to add tile %d", i);
       continue;
     }
 
     m_tileCount++;
+    if (!(flags & DT_TILE_FREE_DATA))
+      mappedTiles++;
+    m_fileRawBytes += entry.dataSize;
+    m_fileCompressedBytes += entry.storedSize;
 
     // Conta poligoni
     const dtMeshTile *tile = m_navMesh->getTileByRef(resultRef);
@@ -1305,57 +1521,65 @@ bool NavMesh::loadFromFile(const std::string &filename) {
     }
   }
 
-  file.close();
+  // Layer del tile cache: gia' compressi, usati direttamente dal mapping
+  int layerCount = 0;
+  for (int i = header.tileCount; i < entryCount; i++) {
+    const NavMeshCacheTile &entry = directory[i];
+    status = m_tileCache->addTile(mapping.data() + entry.offset, entry.dataSize,
+                                  0, nullptr);
+    if (dtStatusFailed(status)) {
+      TraceLog(LOG_WARNING, "NavMesh: Failed to add layer %d",
+               i - header.tileCount);
+      continue;
+    }
+    layerCount++;
+  }
+
+  // Il mapping vive quanto navmesh e tile cache (vedi freeNavMesh)
+  m_cacheMapping = std::move(mapping);
+  resubmitObstacles();
 
   // Reset debug mesh
   m_debugMeshBuilt = false;
   cleanupTileDebugData();
 
-  TraceLog(LOG_INFO, "NavMesh: Loaded from %s (%d tiles, %d polygons)",
-           filename.c_str(), m_tileCount, m_totalPolygons);
+  double loadMs = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - loadStart)
+                      .count();
+  TraceLog(LOG_INFO,
+           "NavMesh: Loaded from %s (%d tiles, %d layers, %d polygons)",
+           filename.c_str(), m_tileCount, layerCount, m_totalPolygons);
+  TraceLog(LOG_INFO,
+           "NavMesh: %d tiles mapped in place, %d decoded in %.2f ms, %.2f ms total",
+           mappedTiles, m_tileCount - mappedTiles, m_fileDecodeMs, loadMs);
 
   return m_tileCount > 0;
 }
 
 unsigned int NavMesh::addObstacle(BoundingBox bounds) {
-  if (!m_navMesh) {
+  if (!m_navMesh || !m_tileCache) {
     TraceLog(LOG_ERROR,
              "NavMesh: NavMesh not initialized - cannot add obstacle");
     return 0;
   }
 
-  // Create obstacle entry
+  // Accodato: le tile vengono ricostruite da updateObstacles
   NavMeshObstacle obstacle;
   obstacle.id = m_nextObstacleId++;
   obstacle.bounds = bounds;
-
-  // Get affected tiles
-  std::vector<TileCoord> affectedTiles = getAffectedTiles(bounds);
+  m_obstacles.push_back(obstacle);
+  m_obstaclesUpToDate = false;
 
   TraceLog(LOG_INFO,
-           "NavMesh: Adding obstacle %u at (%.1f,%.1f,%.1f)-(%.1f,%.1f,%.1f), "
-           "affects %d tiles",
+           "NavMesh: Queued obstacle %u at (%.1f,%.1f,%.1f)-(%.1f,%.1f,%.1f)",
            obstacle.id, bounds.min.x, bounds.min.y, bounds.min.z, bounds.max.x,
-           bounds.max.y, bounds.max.z, (int)affectedTiles.size());
-
-  // Add to obstacle list
-  m_obstacles.push_back(obstacle);
-
-  // Rebuild affected tiles
-  for (const auto &tc : affectedTiles) {
-    TraceLog(LOG_INFO, "NavMesh: Rebuilding tile (%d, %d) for obstacle", tc.x,
-             tc.y);
-    rebuildTile(tc.x, tc.y);
-  }
-
-  // Invalidate debug mesh
-  m_debugMeshBuilt = false;
+           bounds.max.y, bounds.max.z);
 
   return obstacle.id;
 }
 
 bool NavMesh::removeObstacle(unsigned int obstacleId) {
-  if (!m_navMesh) {
+  if (!m_navMesh || !m_tileCache) {
     TraceLog(LOG_ERROR,
              "NavMesh: NavMesh not initialized - cannot remove obstacle");
     return false;
@@ -1372,33 +1596,153 @@ bool NavMesh::removeObstacle(unsigned int obstacleId) {
     return false;
   }
 
-  // Get affected tiles before removing
-  std::vector<TileCoord> affectedTiles = getAffectedTiles(it->bounds);
+  // Mai arrivato al tile cache: basta dimenticarlo
+  if (it->ref) {
+    m_pendingRemovals.push_back(*it);
+    m_obstaclesUpToDate = false;
+  }
+  m_obstacles.erase(it);
 
-  TraceLog(LOG_INFO, "NavMesh: Removing obstacle %u, affects %d tiles",
-           obstacleId, (int)affectedTiles.size());
+  TraceLog(LOG_INFO, "NavMesh: Queued removal of obstacle %u", obstacleId);
+  return true;
+}
 
-  // Remove from list
-  m_obstacles.erase(it);
+void NavMesh::resubmitObstacles() {
+  // Tile cache nuovo: i riferimenti precedenti non valgono piu'
+  for (auto &obstacle : m_obstacles) {
+    obstacle.ref = 0;
+    obstacle.submitted = false;
+  }
+  m_pendingRemovals.clear();
+  m_tileCacheBusy = false;
+  m_obstaclesUpToDate = m_obstacles.empty();
+}
 
-  // Rebuild affected tiles
-  for (const auto &tc : affectedTiles) {
-    TraceLog(LOG_INFO,
-             "NavMesh: Rebuilding tile (%d, %d) after obstacle removal", tc.x,
-             tc.y);
-    rebuildTile(tc.x, tc.y);
+int NavMesh::getPendingObstacleCount() const {
+  int count = (int)m_pendingRemovals.size();
+  for (const auto &obstacle : m_obstacles) {
+    if (!obstacle.submitted)
+      count++;
   }
+  return count;
+}
 
-  // Invalidate debug mesh
+int NavMesh::submitObstacleRequests() {
+  // dtTileCache smaltisce tutte le richieste al primo update e mette ogni
+  // tile toccata una sola volta nella lista da ricostruire: piu' ostacoli
+  // sulla stessa tile costano una ricostruzione. La lista ha posto per
+  // MAX_TILE_CACHE_UPDATES layer, oltre i quali le tile andrebbero perse.
+  std::vector<TileCoord> touched;
+  int touchedLayers = 0;
+  auto reserveTiles = [&](const BoundingBox &bounds) {
+    int newLayers = 0;
+    std::vector<TileCoord> newTiles;
+    for (const auto &tc : getAffectedTiles(bounds)) {
+      if (std::find(touched.begin(), touched.end(), tc) != touched.end())
+        continue;
+      dtCompressedTileRef refs[MAX_TILE_LAYERS];
+      newLayers += m_tileCache->getTilesAt(tc.x, tc.y, refs, MAX_TILE_LAYERS);
+      newTiles.push_back(tc);
+    }
+    // Il primo ostacolo passa comunque
+    if (touchedLayers > 0 &&
+        touchedLayers + newLayers > MAX_TILE_CACHE_UPDATES)
+      return false;
+    touchedLayers += newLayers;
+    touched.insert(touched.end(), newTiles.begin(), newTiles.end());
+    return true;
+  };
+
+  while (!m_pendingRemovals.empty()) {
+    const NavMeshObstacle &obstacle = m_pendingRemovals.back();
+    if (!reserveTiles(obstacle.bounds))
+      return touchedLayers;
+    dtStatus status = m_tileCache->removeObstacle(obstacle.ref);
+    if (dtStatusDetail(status, DT_BUFFER_TOO_SMALL))
+      return touchedLayers; // Coda delle richieste piena: al prossimo giro
+    m_pendingRemovals.pop_back();
+  }
+
+  for (auto &obstacle : m_obstacles) {
+    if (obstacle.submitted)
+      continue;
+    if (!reserveTiles(obstacle.bounds))
+      return touchedLayers;
+    float bmin[3] = {obstacle.bounds.min.x, obstacle.bounds.min.y,
+                     obstacle.bounds.min.z};
+    float bmax[3] = {obstacle.bounds.max.x, obstacle.bounds.max.y,
+                     obstacle.bounds.max.z};
+    dtStatus status = m_tileCache->addBoxObstacle(bmin, bmax, &obstacle.ref);
+    if (dtStatusDetail(status, DT_BUFFER_TOO_SMALL))
+      return touchedLayers;
+    obstacle.submitted = true;
+    if (dtStatusFailed(status)) {
+      obstacle.ref = 0;
+      TraceLog(LOG_WARNING,
+               "NavMesh: Tile cache full - obstacle %u will not block paths",
+               obstacle.id);
+    }
+  }
+  return touchedLayers;
+}
+
+bool NavMesh::updateObstacles(float budgetMs) {
+  if (!m_navMesh || !m_tileCache || m_obstaclesUpToDate)
+    return true;
+  PROFILE_SCOPE("NavMesh::updateObstacles");
+
+  auto start = std::chrono::steady_clock::now();
+  auto elapsedMs = [&]() {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+
+  // Ogni update ricostruisce al piu' una tile: si continua finche' c'e'
+  // lavoro e resta budget
+  int rebuilt = 0;
+  for (;;) {
+    // update ricostruisce una tile solo se ne restavano in coda o se le
+    // richieste appena inviate toccano almeno un layer; altrimenti smaltisce
+    // soltanto le richieste
+    bool rebuildsTile = m_tileCacheBusy;
+    if (!m_tileCacheBusy) {
+      rebuildsTile = submitObstacleRequests() > 0;
+    }
+
+    bool upToDate = false;
+    dtStatus status = m_tileCache->update(0.0f, m_navMesh, &upToDate);
+    if (dtStatusFailed(status)) {
+      TraceLog(LOG_WARNING, "NavMesh: Tile rebuild failed (status 0x%x)",
+               status);
+    }
+    if (rebuildsTile)
+      rebuilt++;
+    m_tileCacheBusy = !upToDate;
+
+    if (upToDate && getPendingObstacleCount() == 0) {
+      m_obstaclesUpToDate = true;
+      break;
+    }
+    if (budgetMs > 0.0f && elapsedMs() >= budgetMs)
+      break;
+  }
+
+  m_rebuiltTiles += rebuilt;
+  m_lastObstacleUpdateMs = elapsedMs();
   m_debugMeshBuilt = false;
+  if (m_obstaclesUpToDate) {
+    countPolygons();
+  }
+  PROFILE_COUNTER("NavMesh tile rebuilds", rebuilt);
 
-  return true;
+  return m_obstaclesUpToDate;
 }
 
 std::vector<TileCoord> NavMesh::getAffectedTiles(BoundingBox bounds) const {
   std::vector<TileCoord> tiles;
 
-  if (m_tileSize <= 0)
+  if (m_builtTileSize <= 0)
     return tiles;
 
   // Get tile coordinates for min and max corners
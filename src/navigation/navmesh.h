@@ -4,9 +4,14 @@
 #include "DetourNavMeshQuery.h"
 #include "DetourTileCache.h"
 #include "DetourTileCacheBuilder.h"
+#include "chunky_tri_mesh.h"
+#include "../resources/mapped_file.h"
 #include <raylib.h>
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <functional>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -23,10 +28,19 @@ struct TileCoord {
   }
 };
 
-// Struttura per un ostacolo statico (building)
+// Struttura per un ostacolo statico (building). ref e' l'ostacolo nel
+// tile cache, 0 finche' la richiesta non e' stata accodata
 struct NavMeshObstacle {
   unsigned int id;
   BoundingBox bounds;
+  dtObstacleRef ref = 0;
+  bool submitted = false;
+};
+
+// Blob di una tile (layer compresso del tile cache o tile Detour)
+struct TileCacheData {
+  unsigned char *data;
+  int dataSize;
 };
 
 // Hash per TileCoord
@@ -55,8 +69,20 @@ struct LinearAllocator : public dtTileCacheAlloc {
   void free(void *ptr) override;
 };
 
-// Simple compressor (passthrough - no actual compression)
+// Compressione LZ4 dei layer del tile cache (vedi lz4_block.h). Le
+// statistiche sono cumulative e atomiche: i layer possono essere compressi
+// dai worker del build.
 struct TileCacheCompressor : public dtTileCacheCompressor {
+  std::atomic<long long> rawBytes{0};
+  std::atomic<long long> compressedBytes{0};
+  std::atomic<long long> decodedBytes{0};
+  std::atomic<long long> decodeNanos{0};
+  std::atomic<int> decodeCount{0};
+
+  // compressi / originali, 1 se non e' stato compresso nulla
+  float getCompressionRatio() const;
+  double getAverageDecodeMs() const;
+
   int maxCompressedSize(const int bufferSize) override;
   dtStatus compress(const unsigned char *buffer, const int bufferSize,
                     unsigned char *compressed, const int maxCompressedSize,
@@ -85,15 +111,32 @@ public:
   bool removeTile(int tileX, int tileY);
   bool rebuildTile(int tileX, int tileY);
   TileCoord getTileCoordAt(Vector3 worldPos) const;
+  // Sincrono sulla query condivisa: per i personaggi usare PathService
   std::vector<Vector3> findPath(Vector3 start, Vector3 end);
   void drawDebug();
+  // Hash di geometria (vertici, indici, transform) e parametri di build:
+  // identifica la cache su disco valida per questa mappa
+  uint64_t computeSourceHash(const Mesh &mesh, Matrix transform) const;
   bool saveToFile(const std::string &filename);
-  bool loadFromFile(const std::string &filename);
+  // Mappa il file e passa le tile a Detour senza copie. false (navmesh
+  // corrente intatta) se il file manca, e' di un'altra versione o il suo
+  // hash non e' sourceHash
+  bool loadFromFile(const std::string &filename, uint64_t sourceHash);
+  // Libera navmesh, tile cache e file mappato
+  void unload();
   bool projectPointToNavMesh(Vector3 point, Vector3 &projectedPoint);
+  // Punto casuale sulla navmesh (GetRandomValue, quindi segue SetRandomSeed)
+  bool findRandomPoint(Vector3 &outPoint);
   void setParametersForMapSize(float mapSize);
+  // Ostacoli box nel tile cache: le modifiche vengono solo accodate
   unsigned int addObstacle(BoundingBox bounds);
   bool removeObstacle(unsigned int obstacleId);
   std::vector<TileCoord> getAffectedTiles(BoundingBox bounds) const;
+  // Applica gli ostacoli accodati: le richieste vengono raggruppate cosi'
+  // ogni tile toccata viene ricostruita una sola volta dai layer del tile
+  // cache, una tile alla volta finche' non si supera budgetMs (<= 0: tutte).
+  // true se la navmesh e' aggiornata.
+  bool updateObstacles(float budgetMs);
   float m_cellSize = 0.5f;
   float m_cellHeight = 0.3f;
   float m_agentHeight = 2.0f;
@@ -103,15 +146,59 @@ public:
   float m_minRegionArea = 8.0f;
   float m_mergeRegionArea = 20.0f;
   float m_maxSimplificationError = 1.3f;
+  // Lato richiesto di una tile; il build lo arrotonda a un numero intero di
+  // celle (vedi computeTileCells)
   float m_tileSize = 64.0f;
+  // Job paralleli per il build delle tile (sul JobSystem): 0 = automatico,
+  // 1 = seriale
+  int m_buildThreads = 0;
   int m_maxTiles = 1024;
   int m_maxPolysPerTile = 4096;
+  // Tile LZ4 in navmesh.bin: file piu' piccolo, ma le tile compresse
+  // vanno decodificate invece di essere usate dal mapping
+  bool m_compressCache = false;
+  // Millisecondi per frame dedicati alla ricostruzione delle tile
+  float m_obstacleBudgetMs = 1.0f;
   int getTileCount() const { return m_tileCount; }
   int getTotalPolygons() const { return m_totalPolygons; }
+  const TileCacheCompressor *getTileCacheCompressor() const { return m_tcomp; }
+  // Tile in navmesh.bin: byte originali e compressi dell'ultimo
+  // salvataggio/caricamento, tempo di decodifica dell'ultimo caricamento
+  int getFileRawBytes() const { return m_fileRawBytes; }
+  int getFileCompressedBytes() const { return m_fileCompressedBytes; }
+  double getFileDecodeMs() const { return m_fileDecodeMs; }
+  // Ostacoli in attesa di essere applicati e tile ricostruite finora
+  int getPendingObstacleCount() const;
+  int getRebuiltTileCount() const { return m_rebuiltTiles; }
+  double getLastObstacleUpdateMs() const { return m_lastObstacleUpdateMs; }
+  // Navmesh Detour corrente (nullptr se non costruita) e contatore che
+  // cambia ogni volta che viene liberata: chi tiene riferimenti a
+  // poligoni o tile (es. la Crowd) sa quando vanno rifatti
+  dtNavMesh *getDetourNavMesh() const { return m_navMesh; }
+  unsigned int getGeneration() const { return m_generation; }
   void getBounds(float *bmin, float *bmax) const;
 
 private:
+  // Contesto Recast, allocatore del tile cache e buffer temporanei usati
+  // da buildTileColumn. Il main thread usa m_scratch, ogni worker del build
+  // parallelo ne ha uno proprio.
+  struct TileBuildScratch {
+    rcContext *ctx = nullptr;
+    std::unique_ptr<LinearAllocator> talloc;
+    std::vector<int> chunkIds;
+    std::vector<unsigned char> triAreas;
+  };
+
+  // Risultato del build di una colonna (tileX, tileY): un layer compresso
+  // per il tile cache e al piu' una tile Detour per ogni layer
+  struct TileColumn {
+    std::vector<TileCacheData> layers;
+    std::vector<TileCacheData> navTiles;
+    int maxPolys = 0;
+  };
+
   rcContext *m_ctx;
+  TileBuildScratch m_scratch;
   dtNavMesh *m_navMesh;
   dtNavMeshQuery *m_navQuery;
   dtTileCache *m_tileCache;
@@ -122,13 +209,22 @@ private:
   std::vector<int> m_storedTris;
   int m_storedVertCount = 0;
   int m_storedTriCount = 0;
+  ChunkyTriMesh m_chunkyMesh;
   float m_boundsMin[3] = {0, 0, 0};
   float m_boundsMax[3] = {0, 0, 0};
   rcConfig m_cfg;
+  // Lato delle tile della navmesh corrente (m_tileSize arrotondato)
+  float m_builtTileSize = 0.0f;
   int m_tilesX = 0;
   int m_tilesZ = 0;
   int m_tileCount = 0;
   int m_totalPolygons = 0;
+  int m_fileRawBytes = 0;
+  int m_fileCompressedBytes = 0;
+  double m_fileDecodeMs = 0.0;
+  // Cache caricata: le tile non compresse puntano nel mapping
+  MappedFile m_cacheMapping;
+  uint64_t m_sourceHash = 0;
   struct TileDebugData {
     rcPolyMesh *polyMesh = nullptr;
     Model debugModel = {0};
@@ -137,22 +233,42 @@ private:
   std::unordered_map<TileCoord, TileDebugData, TileCoordHash> m_tileDebugData;
   Model m_debugModel = {0};
   bool m_debugMeshBuilt = false;
+  // Parametri del tile cache: width/height coincidono con m_cfg.tileSize
+  dtTileCacheParams m_tileCacheParams;
   std::vector<NavMeshObstacle> m_obstacles;
+  // Ostacoli gia' nel tile cache da rimuovere alla prossima richiesta
+  std::vector<NavMeshObstacle> m_pendingRemovals;
   unsigned int m_nextObstacleId = 1;
+  // Nessun ostacolo da applicare / tile cache con tile ancora da ricostruire
+  bool m_obstaclesUpToDate = true;
+  bool m_tileCacheBusy = false;
+  int m_rebuiltTiles = 0;
+  double m_lastObstacleUpdateMs = 0.0;
+  unsigned int m_generation = 0;
+  void freeNavMesh();
   bool initNavMesh();
   bool initTileCache();
-  unsigned char *buildTileData(int tileX, int tileY, int &dataSize);
-  int rasterizeTileLayers(int tileX, int tileY, const rcConfig &cfg,
-                          struct TileCacheData *tiles, int maxTiles);
+  void resubmitObstacles();
+  // Ritorna i layer toccati dalle richieste inviate (tile da ricostruire)
+  int submitObstacleRequests();
+  void countPolygons();
+  bool buildTileColumn(TileBuildScratch &scratch, int tileX, int tileY,
+                       TileColumn &column);
+  unsigned char *buildLayerNavData(LinearAllocator &alloc,
+                                   unsigned char *layerData, int layerSize,
+                                   int &dataSize);
+  bool addTileColumn(TileColumn &column);
+  int computeTileCells() const;
+  void buildTilesParallel(int threadCount, std::vector<TileColumn> &columns,
+                          const ProgressCallback &progressCallback);
+  int rasterizeTileLayers(TileBuildScratch &scratch, int tileX, int tileY,
+                          TileCacheData *tiles, int maxTiles);
+  bool rasterizeTileTriangles(TileBuildScratch &scratch,
+                              const rcConfig &tileCfg, rcHeightfield &hf);
   void buildDebugMesh();
   void buildDebugMeshFromNavMesh();
   void buildDebugMeshForTile(int tileX, int tileY, rcPolyMesh *pmesh);
   void cleanupTileDebugData();
 };
 
-struct TileCacheData {
-  unsigned char *data;
-  int dataSize;
-};
-
 } // namespace moiras
@@ -0,0 +1,278 @@
+#include "path_service.h"
+#include "../jobs/job_system.h"
+#include "../profiler/profiler.h"
+#include "imgui.h"
+#include "navmesh.h"
+#include <algorithm>
+#include <chrono>
+
+namespace moiras {
+
+// Nodi per query: path fino a MAX_PATH_POLYS poligoni con margine per la
+// ricerca A*
+static const int MAX_QUERY_NODES = 4096;
+// Stessa ricerca dei poligoni di NavMesh::findPath
+static const float PATH_EXTENTS[3] = {10.0f, 50.0f, 10.0f};
+
+static PathRequestId makeId(uint16_t index, uint16_t serial) {
+  return ((PathRequestId)serial << 16) | index;
+}
+
+PathService::~PathService() {
+  for (auto &context : m_contexts) {
+    if (context.query)
+      dtFreeNavMeshQuery(context.query);
+  }
+}
+
+void PathService::init(NavMesh *navMesh) {
+  m_navMesh = navMesh;
+  // Le query vengono inizializzate al primo update sulla navmesh corrente
+  m_queriesReady = false;
+}
+
+bool PathService::syncNavMesh() {
+  if (!m_navMesh || !m_navMesh->getDetourNavMesh())
+    return false;
+  if (m_queriesReady && m_navMeshGeneration == m_navMesh->getGeneration())
+    return true;
+
+  // Una query per thread che esegue job: ogni batch ne usa una sola
+  const int contextCount = JobSystem::getInstance().getConcurrency();
+  if ((int)m_contexts.size() != contextCount) {
+    for (auto &context : m_contexts) {
+      if (context.query)
+        dtFreeNavMeshQuery(context.query);
+    }
+    m_contexts.clear();
+    m_contexts.resize(contextCount);
+  }
+  for (auto &context : m_contexts) {
+    if (!context.query)
+      context.query = dtAllocNavMeshQuery();
+    if (!context.query ||
+        dtStatusFailed(context.query->init(m_navMesh->getDetourNavMesh(),
+                                           MAX_QUERY_NODES))) {
+      TraceLog(LOG_ERROR, "PathService: Failed to init navmesh query");
+      m_queriesReady = false;
+      return false;
+    }
+    context.polys.resize(MAX_PATH_POLYS);
+    context.straight.resize(MAX_PATH_POLYS * 3);
+  }
+  m_navMeshGeneration = m_navMesh->getGeneration();
+  m_queriesReady = true;
+  TraceLog(LOG_INFO, "PathService: %d navmesh queries ready",
+           (int)m_contexts.size());
+  return true;
+}
+
+PathRequestId PathService::request(Vector3 start, Vector3 end,
+                                   PathCallback callback) {
+  if (!m_navMesh)
+    return 0;
+
+  uint16_t index;
+  if (!m_freeSlots.empty()) {
+    index = m_freeSlots.back();
+    m_freeSlots.pop_back();
+  } else if ((int)m_requests.size() < MAX_PENDING) {
+    index = (uint16_t)m_requests.size();
+    m_requests.emplace_back();
+  } else {
+    TraceLog(LOG_WARNING, "PathService: Too many requests (%d)", MAX_PENDING);
+    return 0;
+  }
+
+  Request &request = m_requests[index];
+  request.start = start;
+  request.end = end;
+  request.callback = std::move(callback);
+  request.path.clear();
+  request.status = PathStatus::Pending;
+  request.cancelled = false;
+  if (++request.serial == 0)
+    request.serial = 1;
+  m_pending.push_back(index);
+  return makeId(index, request.serial);
+}
+
+PathService::Request *PathService::find(PathRequestId id) {
+  const uint16_t index = (uint16_t)(id & 0xFFFF);
+  if (id == 0 || index >= m_requests.size())
+    return nullptr;
+  Request &request = m_requests[index];
+  if (request.serial != (uint16_t)(id >> 16) ||
+      request.status == PathStatus::Invalid || request.cancelled)
+    return nullptr;
+  return &request;
+}
+
+const PathService::Request *PathService::find(PathRequestId id) const {
+  return const_cast<PathService *>(this)->find(id);
+}
+
+void PathService::release(uint16_t index) {
+  Request &request = m_requests[index];
+  request.status = PathStatus::Invalid;
+  request.cancelled = false;
+  request.callback = nullptr;
+  m_freeSlots.push_back(index);
+}
+
+void PathService::cancel(PathRequestId id) {
+  Request *request = find(id);
+  if (!request)
+    return;
+  if (request->status == PathStatus::Pending) {
+    // Ancora in coda: lo slot si libera quando update la raggiunge
+    request->cancelled = true;
+    request->callback = nullptr;
+  } else {
+    release((uint16_t)(id & 0xFFFF));
+  }
+}
+
+PathStatus PathService::getStatus(PathRequestId id) const {
+  const Request *request = find(id);
+  return request ? request->status : PathStatus::Invalid;
+}
+
+bool PathService::takePath(PathRequestId id, std::vector<Vector3> &out) {
+  Request *request = find(id);
+  if (!request || request->status == PathStatus::Pending)
+    return false;
+  const bool ready = request->status == PathStatus::Ready;
+  if (ready)
+    out.swap(request->path);
+  release((uint16_t)(id & 0xFFFF));
+  return ready;
+}
+
+bool PathService::solve(QueryContext &context, Request &request) const {
+  dtQueryFilter filter;
+  filter.setIncludeFlags(0xFFFF);
+  filter.setExcludeFlags(0);
+
+  const float sPos[3] = {request.start.x, request.start.y, request.start.z};
+  const float ePos[3] = {request.end.x, request.end.y, request.end.z};
+  dtPolyRef startRef = 0, endRef = 0;
+  float nearestStart[3], nearestEnd[3];
+  dtNavMeshQuery *query = context.query;
+  query->findNearestPoly(sPos, PATH_EXTENTS, &filter, &startRef, nearestStart);
+  query->findNearestPoly(ePos, PATH_EXTENTS, &filter, &endRef, nearestEnd);
+  if (!startRef || !endRef)
+    return false;
+
+  int pathCount = 0;
+  query->findPath(startRef, endRef, nearestStart, nearestEnd, &filter,
+                  context.polys.data(), &pathCount, MAX_PATH_POLYS);
+  if (pathCount <= 0)
+    return false;
+
+  int straightCount = 0;
+  query->findStraightPath(nearestStart, nearestEnd, context.polys.data(),
+                          pathCount, context.straight.data(), nullptr, nullptr,
+                          &straightCount, MAX_PATH_POLYS, 0);
+  if (straightCount <= 0)
+    return false;
+
+  request.path.resize(straightCount);
+  for (int i = 0; i < straightCount; i++) {
+    const float *v = &context.straight[i * 3];
+    request.path[i] = {v[0], v[1], v[2]};
+  }
+  return true;
+}
+
+void PathService::update() {
+  if (m_pending.empty())
+    return;
+  PROFILE_SCOPE("PathService::update");
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point start = Clock::now();
+  const bool ready = syncNavMesh();
+
+  // Batch: le prime richieste in coda, senza quelle annullate
+  m_batch.clear();
+  while (!m_pending.empty() && (int)m_batch.size() < maxRequestsPerFrame) {
+    const uint16_t index = m_pending.front();
+    m_pending.pop_front();
+    if (m_requests[index].cancelled)
+      release(index);
+    else
+      m_batch.push_back(index);
+  }
+
+  const int count = (int)m_batch.size();
+  if (count > 0 && ready) {
+    // Un intervallo per query. Ogni intervallo risolve almeno una
+    // richiesta, poi si ferma allo scadere del budget: le altre restano
+    // Pending e tornano in testa alla coda.
+    const int chunks = std::min(count, (int)m_contexts.size());
+    const int grain = (count + chunks - 1) / chunks;
+    const Clock::time_point deadline =
+        start + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double, std::milli>(budgetMs));
+    JobSystem::getInstance().parallel_for(count, grain, [&](int begin, int end) {
+      QueryContext &context = m_contexts[begin / grain];
+      for (int i = begin; i < end; i++) {
+        if (budgetMs > 0.0f && i > begin && Clock::now() > deadline)
+          break;
+        Request &request = m_requests[m_batch[i]];
+        request.status = solve(context, request) ? PathStatus::Ready
+                                                 : PathStatus::Failed;
+      }
+    });
+  } else {
+    // Nessuna navmesh: nessuna richiesta puo' essere risolta
+    for (uint16_t index : m_batch)
+      m_requests[index].status = PathStatus::Failed;
+  }
+
+  // Risultati e callback nell'ordine di richiesta
+  int solved = 0;
+  for (int i = count - 1; i >= 0; i--) {
+    if (m_requests[m_batch[i]].status == PathStatus::Pending)
+      m_pending.push_front(m_batch[i]);
+  }
+  for (uint16_t index : m_batch) {
+    Request &request = m_requests[index];
+    if (request.status == PathStatus::Pending)
+      continue;
+    solved++;
+    if (!request.callback)
+      continue;
+    // La callback puo' accodare nuove richieste (m_requests si puo'
+    // riallocare) o annullare questa: il path passa da m_callbackPath e lo
+    // slot si rilegge per indice
+    PathCallback callback = std::move(request.callback);
+    const uint16_t serial = request.serial;
+    const PathStatus status = request.status;
+    m_callbackPath.swap(request.path);
+    callback(makeId(index, serial), status, m_callbackPath);
+    Request &done = m_requests[index];
+    if (done.serial == serial) {
+      done.path.swap(m_callbackPath);
+      if (done.status != PathStatus::Invalid)
+        release(index);
+    }
+  }
+
+  m_lastBatch = solved;
+  m_completed += solved;
+  m_lastUpdateMs =
+      std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  PROFILE_COUNTER("Path requests solved", solved);
+  PROFILE_COUNTER("Path requests pending", m_pending.size());
+}
+
+void PathService::gui() {
+  ImGui::Text("Pending: %d", (int)m_pending.size());
+  ImGui::Text("Last frame: %d paths in %.3f ms", m_lastBatch, m_lastUpdateMs);
+  ImGui::Text("Total: %d (%d queries)", m_completed, (int)m_contexts.size());
+  ImGui::SliderFloat("Budget (ms/frame)", &budgetMs, 0.0f, 8.0f, "%.2f");
+  ImGui::SliderInt("Max per frame", &maxRequestsPerFrame, 1, 1024);
+}
+
+} // namespace moiras
@@ -0,0 +1,112 @@
+#pragma once
+#include "DetourNavMeshQuery.h"
+#include <raylib.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace moiras {
+
+class NavMesh;
+
+// 0 = nessuna richiesta
+using PathRequestId = uint32_t;
+
+enum class PathStatus { Invalid, Pending, Ready, Failed };
+
+// Chiamata sul main thread in PathService::update; il path e' valido solo
+// durante la chiamata e la richiesta viene liberata subito dopo
+using PathCallback = std::function<void(PathRequestId id, PathStatus status,
+                                        const std::vector<Vector3> &path)>;
+
+// Richieste di path asincrone: request() accoda e ritorna subito un handle,
+// update() (una volta per frame, main thread) risolve le richieste in coda
+// in parallelo sul JobSystem entro budgetMs e maxRequestsPerFrame. Ogni
+// batch parallelo usa un dtNavMeshQuery con i propri buffer, quindi niente
+// query condivisa e nessuna allocazione per path: i buffer delle richieste
+// vengono riusati. Il risultato si legge con getStatus/takePath oppure
+// arriva alla callback. La navmesh non cambia durante update (ostacoli e
+// rebuild girano sul main thread), le query possono leggerla senza lock.
+//
+// Chi lo usa: gli script Lua (World.request_path) e i CharacterController
+// senza agente nella Crowd. I personaggi nella Crowd non passano di qui:
+// dtCrowd pianifica i loro path con la propria coda a budget.
+class PathService {
+public:
+  static constexpr int MAX_PATH_POLYS = 1024;
+  static constexpr int MAX_PENDING = 65535;
+
+  static PathService &getInstance() {
+    static PathService instance;
+    return instance;
+  }
+
+  void init(NavMesh *navMesh);
+  bool isInitialized() const { return m_navMesh != nullptr; }
+
+  // 0 se il servizio non e' inizializzato o la coda e' piena
+  PathRequestId request(Vector3 start, Vector3 end,
+                        PathCallback callback = nullptr);
+  // Scarta la richiesta (anche gia' completata); id non validi ignorati
+  void cancel(PathRequestId id);
+  PathStatus getStatus(PathRequestId id) const;
+  // Ready: scambia il path con out e libera la richiesta. Failed: libera
+  // la richiesta e ritorna false. Pending/Invalid: false, nulla cambia.
+  bool takePath(PathRequestId id, std::vector<Vector3> &out);
+
+  void update();
+  void gui();
+
+  // Tempo massimo per frame (<= 0: tutte le richieste entro il limite)
+  float budgetMs = 1.0f;
+  int maxRequestsPerFrame = 256;
+
+  int getPendingCount() const { return (int)m_pending.size(); }
+  int getLastBatchCount() const { return m_lastBatch; }
+  double getLastUpdateMs() const { return m_lastUpdateMs; }
+
+private:
+  PathService() = default;
+  ~PathService();
+  PathService(const PathService &) = delete;
+  PathService &operator=(const PathService &) = delete;
+
+  struct Request {
+    Vector3 start = {0, 0, 0};
+    Vector3 end = {0, 0, 0};
+    PathCallback callback;
+    std::vector<Vector3> path; // capacita' riusata tra richieste
+    PathStatus status = PathStatus::Invalid;
+    uint16_t serial = 0;
+    bool cancelled = false;
+  };
+
+  // Query e buffer di un batch parallelo
+  struct QueryContext {
+    dtNavMeshQuery *query = nullptr;
+    std::vector<dtPolyRef> polys;
+    std::vector<float> straight;
+  };
+
+  bool syncNavMesh();
+  bool solve(QueryContext &context, Request &request) const;
+  Request *find(PathRequestId id);
+  const Request *find(PathRequestId id) const;
+  void release(uint16_t index);
+
+  NavMesh *m_navMesh = nullptr;
+  unsigned int m_navMeshGeneration = 0;
+  bool m_queriesReady = false;
+  std::vector<QueryContext> m_contexts;
+  std::vector<Request> m_requests;
+  std::vector<uint16_t> m_freeSlots;
+  std::deque<uint16_t> m_pending;
+  std::vector<uint16_t> m_batch;
+  std::vector<Vector3> m_callbackPath;
+  int m_lastBatch = 0;
+  double m_lastUpdateMs = 0.0;
+  int m_completed = 0;
+};
+
+} // namespace moiras
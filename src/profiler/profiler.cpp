@@ -0,0 +1,472 @@
+#include "profiler.h"
+#include "imgui.h"
+#include <raylib.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+namespace moiras
+{
+  static thread_local int t_depth = 0;
+
+  // Buffer del thread corrente, assegnato al primo evento e restituito al
+  // profiler quando il thread termina
+  struct ThreadBufferHandle
+  {
+    Profiler::ThreadBuffer *buffer = nullptr;
+
+    ~ThreadBufferHandle()
+    {
+      if (buffer)
+        Profiler::getInstance().releaseThreadBuffer(buffer);
+    }
+  };
+  static thread_local ThreadBufferHandle t_buffer;
+
+  uint64_t Profiler::now()
+  {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  Profiler::ThreadBuffer *Profiler::threadBuffer()
+  {
+    if (t_buffer.buffer)
+      return t_buffer.buffer;
+
+    std::lock_guard<std::mutex> lock(m_threadsMutex);
+    ThreadBuffer *buffer;
+    if (!m_freeBuffers.empty())
+    {
+      // Gli eventi del thread precedente spariscono dalla timeline: snapshot
+      // legge head sotto lo stesso lock
+      buffer = m_freeBuffers.back();
+      m_freeBuffers.pop_back();
+      buffer->head.store(0, std::memory_order_relaxed);
+    }
+    else
+    {
+      m_threads.push_back(std::make_unique<ThreadBuffer>());
+      buffer = m_threads.back().get();
+      buffer->index = (int)m_threads.size() - 1;
+      buffer->events = std::make_unique<ProfileEvent[]>(EVENTS_PER_THREAD);
+    }
+    buffer->name = buffer->index == 0 ? "Main" : "Thread " + std::to_string(buffer->index);
+    t_buffer.buffer = buffer;
+    return buffer;
+  }
+
+  void Profiler::releaseThreadBuffer(ThreadBuffer *buffer)
+  {
+    // Gli eventi restano visibili finche' un altro thread non riusa il buffer
+    std::lock_guard<std::mutex> lock(m_threadsMutex);
+    m_freeBuffers.push_back(buffer);
+  }
+
+  void Profiler::setThreadName(const char *name)
+  {
+    ThreadBuffer *buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(m_threadsMutex);
+    buffer->name = name;
+  }
+
+  void Profiler::beginFrame()
+  {
+    // Buffer del main thread: indice 0 se nessun altro thread ha registrato
+    // eventi prima (JobSystem::init lo registra prima dei worker)
+    threadBuffer();
+
+    uint64_t t = now();
+    if (!isEnabled())
+    {
+      m_currentFrameStart = 0;
+      return;
+    }
+    if (m_currentFrameStart != 0)
+    {
+      ProfileFrame &frame = m_frames[m_frameCount % FRAME_HISTORY];
+      frame.index = m_frameCount;
+      frame.start = m_currentFrameStart;
+      frame.end = t;
+      m_frameCount++;
+      m_frameIndex.store(m_frameCount, std::memory_order_relaxed);
+    }
+    m_currentFrameStart = t;
+    // Lo slot del nuovo frame contiene ancora il frame di FRAME_HISTORY fa
+    for (auto &track : m_counters)
+      track.values[m_frameCount % FRAME_HISTORY] = 0;
+  }
+
+  void Profiler::setCounter(const char *name, int64_t value)
+  {
+    if (!isEnabled())
+      return;
+    CounterTrack *track = nullptr;
+    for (auto &t : m_counters)
+    {
+      if (t.name == name || strcmp(t.name, name) == 0)
+      {
+        track = &t;
+        break;
+      }
+    }
+    if (!track)
+    {
+      m_counters.push_back(CounterTrack{name, {}});
+      track = &m_counters.back();
+    }
+    track->values[m_frameCount % FRAME_HISTORY] = value;
+  }
+
+  void Profiler::record(const char *name, uint64_t start, uint64_t end,
+                        int depth)
+  {
+    ThreadBuffer *buffer = threadBuffer();
+    // Unico scrittore: basta pubblicare il nuovo head dopo aver scritto lo slot
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    ProfileEvent &e = buffer->events[head % EVENTS_PER_THREAD];
+    e.name = name;
+    e.start = start;
+    e.end = end;
+    e.frame = m_frameIndex.load(std::memory_order_relaxed);
+    e.depth = (uint16_t)depth;
+    buffer->head.store(head + 1, std::memory_order_release);
+  }
+
+  void Profiler::getFrames(int count, std::vector<ProfileFrame> &out) const
+  {
+    int available = (int)std::min<uint32_t>(m_frameCount, FRAME_HISTORY);
+    count = std::min(count, available);
+    for (int i = count; i > 0; i--)
+    {
+      out.push_back(m_frames[(m_frameCount - i) % FRAME_HISTORY]);
+    }
+  }
+
+  void Profiler::snapshot(uint64_t from, uint64_t to,
+                          std::vector<ProfileThreadEvents> &out) const
+  {
+    std::lock_guard<std::mutex> lock(m_threadsMutex);
+    for (const auto &buffer : m_threads)
+    {
+      ProfileThreadEvents thread;
+      thread.threadIndex = buffer->index;
+      thread.threadName = buffer->name;
+
+      // Gli eventi sono scritti alla chiusura dello scope, quindi in ordine di
+      // end: si scorre a ritroso e ci si ferma al primo finito prima di from
+      uint64_t head = buffer->head.load(std::memory_order_acquire);
+      uint64_t first = head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0;
+      uint64_t i = head;
+      while (i > first)
+      {
+        const ProfileEvent &e = buffer->events[(i - 1) % EVENTS_PER_THREAD];
+        if (e.end < from)
+          break;
+        if (e.start <= to)
+          thread.events.push_back(e);
+        i--;
+      }
+
+      // Scarta gli slot che lo scrittore ha sovrascritto durante la copia
+      // (i piu' vecchi, in fondo al vettore)
+      uint64_t newHead = buffer->head.load(std::memory_order_acquire);
+      if (newHead - i >= EVENTS_PER_THREAD && !thread.events.empty())
+      {
+        uint64_t overwritten = newHead - i - EVENTS_PER_THREAD + 1;
+        size_t keep = thread.events.size() -
+                      (size_t)std::min<uint64_t>(overwritten, thread.events.size());
+        thread.events.resize(keep);
+      }
+      std::reverse(thread.events.begin(), thread.events.end());
+
+      if (!thread.events.empty())
+        out.push_back(std::move(thread));
+    }
+  }
+
+  static void writeJsonString(FILE *file, const char *s)
+  {
+    fputc('"', file);
+    for (; *s; s++)
+    {
+      if (*s == '"' || *s == '\\')
+        fputc('\\', file);
+      fputc(*s, file);
+    }
+    fputc('"', file);
+  }
+
+  bool Profiler::dumpChromeTrace(const std::string &filename, int frameCount)
+  {
+    std::vector<ProfileFrame> frames;
+    getFrames(frameCount, frames);
+    if (frames.empty())
+      return false;
+
+    uint64_t from = frames.front().start;
+    uint64_t to = frames.back().end;
+    std::vector<ProfileThreadEvents> threads;
+    snapshot(from, to, threads);
+
+    FILE *file = fopen(filename.c_str(), "w");
+    if (!file)
+    {
+      TraceLog(LOG_ERROR, "Profiler: Cannot open file for writing: %s",
+               filename.c_str());
+      return false;
+    }
+
+    // Complete events ("X") con timestamp in microsecondi
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    auto separator = [&]()
+    {
+      if (!first)
+        fprintf(file, ",\n");
+      first = false;
+    };
+    for (const ProfileFrame &frame : frames)
+    {
+      separator();
+      fprintf(file,
+              "{\"name\":\"Frame %u\",\"ph\":\"X\",\"pid\":1,\"tid\":-1,"
+              "\"ts\":%.3f,\"dur\":%.3f}",
+              frame.index, (frame.start - from) / 1000.0,
+              (frame.end - frame.start) / 1000.0);
+    }
+    for (const auto &thread : threads)
+    {
+      separator();
+      fprintf(file,
+              "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+              "\"args\":{\"name\":",
+              thread.threadIndex);
+      writeJsonString(file, thread.threadName.c_str());
+      fprintf(file, "}}");
+
+      for (const ProfileEvent &e : thread.events)
+      {
+        separator();
+        fprintf(file, "{\"name\":");
+        writeJsonString(file, e.name);
+        fprintf(file,
+                ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                thread.threadIndex,
+                e.start >= from ? (e.start - from) / 1000.0 : -((from - e.start) / 1000.0),
+                (e.end - e.start) / 1000.0);
+      }
+    }
+    // Counter events ("C"), un valore per frame
+    for (const CounterTrack &track : m_counters)
+    {
+      for (const ProfileFrame &frame : frames)
+      {
+        separator();
+        fprintf(file, "{\"name\":");
+        writeJsonString(file, track.name);
+        fprintf(file,
+                ",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%lld}}",
+                (frame.start - from) / 1000.0,
+                (long long)track.values[frame.index % FRAME_HISTORY]);
+      }
+    }
+    fprintf(file, "\n]}\n");
+    bool ok = ferror(file) == 0;
+    fclose(file);
+
+    TraceLog(LOG_INFO, "Profiler: Wrote %d frames to %s", (int)frames.size(),
+             filename.c_str());
+    return ok;
+  }
+
+  static ImU32 scopeColor(const char *name)
+  {
+    // Colore stabile per nome
+    unsigned int h = 2166136261u;
+    for (const char *c = name; *c; c++)
+      h = (h ^ (unsigned char)*c) * 16777619u;
+    return IM_COL32(90 + h % 140, 90 + (h >> 8) % 140, 90 + (h >> 16) % 140, 255);
+  }
+
+  void Profiler::gui()
+  {
+    bool enabled = isEnabled();
+    if (ImGui::Checkbox("Capture", &enabled))
+      setEnabled(enabled);
+    ImGui::SameLine();
+    if (ImGui::Button("Dump trace (F11)"))
+      dumpChromeTrace(TextFormat("moiras_trace_%u.json", m_frameCount),
+                      dumpFrameCount);
+    ImGui::SliderInt("Dump frames", &dumpFrameCount, 1, FRAME_HISTORY);
+
+    std::vector<ProfileFrame> frames;
+    getFrames(FRAME_HISTORY, frames);
+    if (frames.empty())
+    {
+      ImGui::TextDisabled("No frames recorded");
+      return;
+    }
+
+    // Tempi dei frame
+    float frameMs[FRAME_HISTORY];
+    float maxMs = 0.0f;
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+      frameMs[i] = (frames[i].end - frames[i].start) / 1.0e6f;
+      maxMs = std::max(maxMs, frameMs[i]);
+    }
+    ImGui::PlotLines("##frametimes", frameMs, (int)frames.size(), 0,
+                     TextFormat("max %.2f ms", maxMs), 0.0f, maxMs * 1.1f,
+                     ImVec2(ImGui::GetContentRegionAvail().x, 50));
+
+    // Senza capture lo storico e' fermo e si puo' scorrere
+    m_selectedFrame = std::clamp(m_selectedFrame, 0, (int)frames.size() - 1);
+    ImGui::SliderInt("Frames ago", &m_selectedFrame, 0, (int)frames.size() - 1);
+    ImGui::SliderFloat("Zoom", &m_zoom, 1.0f, 20.0f, "%.1fx");
+    const ProfileFrame &frame = frames[frames.size() - 1 - m_selectedFrame];
+    const double frameNs = (double)(frame.end - frame.start);
+    ImGui::Text("Frame %u: %.3f ms", frame.index, frameNs / 1.0e6);
+
+    std::vector<ProfileThreadEvents> threads;
+    snapshot(frame.start, frame.end, threads);
+
+    if (!m_counters.empty() && ImGui::TreeNode("Counters"))
+    {
+      for (const CounterTrack &track : m_counters)
+        ImGui::Text("%s: %lld", track.name,
+                    (long long)track.values[frame.index % FRAME_HISTORY]);
+      ImGui::TreePop();
+    }
+
+    // Flame view: una riga per livello di annidamento, un blocco per thread
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    int totalRows = 0;
+    for (const auto &thread : threads)
+    {
+      int maxDepth = 0;
+      for (const ProfileEvent &e : thread.events)
+        maxDepth = std::max(maxDepth, (int)e.depth);
+      totalRows += maxDepth + 2; // +1 per il nome del thread
+    }
+
+    ImVec2 viewSize(ImGui::GetContentRegionAvail().x,
+                    std::min(totalRows * rowHeight + 8.0f, 400.0f));
+    ImGui::BeginChild("##flame", viewSize, true,
+                      ImGuiWindowFlags_HorizontalScrollbar);
+    {
+      ImDrawList *draw = ImGui::GetWindowDrawList();
+      ImVec2 origin = ImGui::GetCursorScreenPos();
+      float width = (ImGui::GetContentRegionAvail().x - 4.0f) * m_zoom;
+      float y = origin.y;
+      const char *hovered = nullptr;
+      double hoveredMs = 0.0;
+
+      for (const auto &thread : threads)
+      {
+        draw->AddText(ImVec2(origin.x, y), IM_COL32(200, 200, 200, 255),
+                      thread.threadName.c_str());
+        y += rowHeight;
+
+        int maxDepth = 0;
+        for (const ProfileEvent &e : thread.events)
+        {
+          maxDepth = std::max(maxDepth, (int)e.depth);
+
+          uint64_t s = std::max(e.start, frame.start);
+          uint64_t t = std::min(e.end, frame.end);
+          float x0 = origin.x + (float)((s - frame.start) / frameNs) * width;
+          float x1 = origin.x + (float)((t - frame.start) / frameNs) * width;
+          x1 = std::max(x1, x0 + 1.0f);
+          float y0 = y + e.depth * rowHeight;
+          ImVec2 a(x0, y0), b(x1, y0 + rowHeight - 1.0f);
+
+          draw->AddRectFilled(a, b, scopeColor(e.name));
+          if (x1 - x0 > 30.0f)
+          {
+            draw->PushClipRect(a, b, true);
+            draw->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(0, 0, 0, 255),
+                          e.name);
+            draw->PopClipRect();
+          }
+          if (ImGui::IsMouseHoveringRect(a, b))
+          {
+            hovered = e.name;
+            hoveredMs = (e.end - e.start) / 1.0e6;
+          }
+        }
+        y += (maxDepth + 1) * rowHeight;
+      }
+
+      ImGui::Dummy(ImVec2(width, y - origin.y));
+      if (hovered)
+        ImGui::SetTooltip("%s\n%.3f ms", hovered, hoveredMs);
+    }
+    ImGui::EndChild();
+
+    // Scope piu' costosi del frame (tempo inclusivo, tutti i thread)
+    struct ScopeTotal
+    {
+      const char *name;
+      double ms;
+      int calls;
+    };
+    std::unordered_map<const char *, ScopeTotal> totals;
+    for (const auto &thread : threads)
+    {
+      for (const ProfileEvent &e : thread.events)
+      {
+        ScopeTotal &total = totals.try_emplace(e.name, ScopeTotal{e.name, 0.0, 0}).first->second;
+        total.ms += (e.end - e.start) / 1.0e6;
+        total.calls++;
+      }
+    }
+    std::vector<ScopeTotal> sorted;
+    for (auto &[name, total] : totals)
+      sorted.push_back(total);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const ScopeTotal &a, const ScopeTotal &b)
+              { return a.ms > b.ms; });
+
+    if (ImGui::BeginTable("##scopes", 3,
+                          ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+    {
+      ImGui::TableSetupColumn("Scope");
+      ImGui::TableSetupColumn("ms");
+      ImGui::TableSetupColumn("calls");
+      ImGui::TableHeadersRow();
+      for (size_t i = 0; i < sorted.size() && i < 20; i++)
+      {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(sorted[i].name);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", sorted[i].ms);
+        ImGui::TableNextColumn();
+        ImGui::Text("%d", sorted[i].calls);
+      }
+      ImGui::EndTable();
+    }
+  }
+
+  ProfileScope::ProfileScope(const char *name)
+      : m_name(name), m_start(0)
+  {
+    if (Profiler::getInstance().isEnabled())
+    {
+      m_start = Profiler::now();
+      t_depth++;
+    }
+  }
+
+  ProfileScope::~ProfileScope()
+  {
+    if (m_start == 0)
+      return;
+    t_depth--;
+    Profiler::getInstance().record(m_name, m_start, Profiler::now(), t_depth);
+  }
+} // namespace moiras
@@ -0,0 +1,159 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace moiras
+{
+  struct ProfileEvent
+  {
+    const char *name; // Stringa statica (letterale o __func__)
+    uint64_t start;   // ns, vedi Profiler::now()
+    uint64_t end;
+    uint32_t frame;
+    uint16_t depth; // Annidamento dello scope nel suo thread
+  };
+
+  struct ProfileFrame
+  {
+    uint32_t index;
+    uint64_t start;
+    uint64_t end;
+  };
+
+  // Eventi di un thread copiati da snapshot()
+  struct ProfileThreadEvents
+  {
+    int threadIndex;
+    std::string threadName;
+    std::vector<ProfileEvent> events;
+  };
+
+  // Profiler CPU gerarchico. Ogni thread scrive i propri scope in un ring
+  // buffer dedicato (un solo scrittore, nessun lock); il main thread legge
+  // gli ultimi eventi per la vista in ImGui e per l'export Chrome trace.
+  // Un evento costa due letture del clock e una scrittura nel ring, quindi
+  // il profiler resta attivo anche in release.
+  class Profiler
+  {
+  public:
+    static constexpr int EVENTS_PER_THREAD = 1 << 16;
+    static constexpr int FRAME_HISTORY = 300;
+
+    static Profiler &getInstance()
+    {
+      static Profiler instance;
+      return instance;
+    }
+
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    static uint64_t now();
+
+    // Chiude il frame precedente e ne apre uno nuovo (main thread)
+    void beginFrame();
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    // Nome del thread corrente nella timeline e nel trace
+    void setThreadName(const char *name);
+
+    void record(const char *name, uint64_t start, uint64_t end, int depth);
+    // Valore di un contatore (es. oggetti scartati) nel frame corrente. Solo
+    // main thread; name deve essere una stringa statica.
+    void setCounter(const char *name, int64_t value);
+
+    // Metodi di lettura: solo dal main thread
+    // Ultimi count frame completi, dal piu' vecchio al piu' recente
+    void getFrames(int count, std::vector<ProfileFrame> &out) const;
+    // Eventi di tutti i thread che cadono in [from, to]
+    void snapshot(uint64_t from, uint64_t to,
+                  std::vector<ProfileThreadEvents> &out) const;
+    // Esporta gli ultimi frameCount frame nel formato Chrome trace
+    // (chrome://tracing, Perfetto)
+    bool dumpChromeTrace(const std::string &filename, int frameCount);
+    // Timeline / flame view (tab Profiler della Sidebar)
+    void gui();
+
+    int dumpFrameCount = 120;
+
+  private:
+    Profiler() = default;
+
+    struct ThreadBuffer
+    {
+      int index = 0;
+      std::string name;
+      std::unique_ptr<ProfileEvent[]> events;
+      // Eventi scritti in totale; lo slot e' head % EVENTS_PER_THREAD
+      std::atomic<uint64_t> head{0};
+    };
+
+    std::atomic<bool> m_enabled{true};
+    std::atomic<uint32_t> m_frameIndex{0};
+
+    // Registrazione dei thread (una volta per thread; m_threads non si
+    // accorcia, i buffer dei thread terminati passano a m_freeBuffers)
+    mutable std::mutex m_threadsMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+
+    // Storico dei frame, scritto e letto solo dal main thread
+    ProfileFrame m_frames[FRAME_HISTORY] = {};
+    // Contatori per frame, slot = indice del frame % FRAME_HISTORY
+    struct CounterTrack
+    {
+      const char *name;
+      int64_t values[FRAME_HISTORY];
+    };
+    std::vector<CounterTrack> m_counters;
+    uint32_t m_frameCount = 0; // frame completi
+    uint64_t m_currentFrameStart = 0;
+
+    // Stato della vista
+    bool m_paused = false;
+    int m_selectedFrame = 0; // 0 = ultimo frame, 1 = penultimo, ...
+    float m_zoom = 1.0f;
+
+    // Buffer dei thread terminati, riusati dai thread nuovi
+    std::vector<ThreadBuffer *> m_freeBuffers;
+
+    ThreadBuffer *threadBuffer();
+    void releaseThreadBuffer(ThreadBuffer *buffer);
+
+    friend struct ThreadBufferHandle;
+  };
+
+  // Registra la durata dello scope in cui e' dichiarato
+  class ProfileScope
+  {
+  public:
+    explicit ProfileScope(const char *name);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+  private:
+    const char *m_name;
+    uint64_t m_start;
+  };
+} // namespace moiras
+
+#define MOIRAS_PROFILE_CONCAT_INNER(a, b) a##b
+#define MOIRAS_PROFILE_CONCAT(a, b) MOIRAS_PROFILE_CONCAT_INNER(a, b)
+
+// -DMOIRAS_DISABLE_PROFILER rimuove del tutto la strumentazione
+#ifndef MOIRAS_DISABLE_PROFILER
+#define PROFILE_SCOPE(name) \
+  ::moiras::ProfileScope MOIRAS_PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_COUNTER(name, value) \
+  ::moiras::Profiler::getInstance().setCounter(name, (int64_t)(value))
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+#endif
@@ -0,0 +1,102 @@
+#include "mapped_file.h"
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace moiras {
+
+void MappedFile::swap(MappedFile &other) noexcept {
+  std::swap(m_data, other.m_data);
+  std::swap(m_size, other.m_size);
+#if defined(_WIN32)
+  std::swap(m_file, other.m_file);
+  std::swap(m_mapping, other.m_mapping);
+#endif
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const std::string &path) {
+  close();
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+  // PAGE_WRITECOPY + FILE_MAP_COPY: scritture private al processo
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  if (!mapping) {
+    CloseHandle(file);
+    return false;
+  }
+  void *view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+  if (!view) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+  m_file = file;
+  m_mapping = mapping;
+  m_data = (unsigned char *)view;
+  m_size = (size_t)size.QuadPart;
+  return true;
+}
+
+void MappedFile::close() {
+  if (m_data)
+    UnmapViewOfFile(m_data);
+  if (m_mapping)
+    CloseHandle((HANDLE)m_mapping);
+  if (m_file)
+    CloseHandle((HANDLE)m_file);
+  m_data = nullptr;
+  m_size = 0;
+  m_mapping = nullptr;
+  m_file = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  // MAP_PRIVATE: copy-on-write, il mapping resta valido anche dopo close(fd)
+  void *view = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (view == MAP_FAILED)
+    return false;
+  m_data = (unsigned char *)view;
+  m_size = (size_t)st.st_size;
+  return true;
+}
+
+void MappedFile::close() {
+  if (m_data)
+    munmap(m_data, m_size);
+  m_data = nullptr;
+  m_size = 0;
+}
+
+#endif
+
+} // namespace moiras
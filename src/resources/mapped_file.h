@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace moiras {
+
+// File mappato in memoria in copy-on-write: le pagine si leggono dal page
+// cache senza copie e le scritture restano private al processo (il file su
+// disco non cambia). Usato dalla cache della navmesh, dove Detour scrive i
+// link direttamente nei dati delle tile.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept { swap(other); }
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+      close();
+      swap(other);
+    }
+    return *this;
+  }
+
+  bool open(const std::string &path);
+  void close();
+
+  bool isOpen() const { return m_data != nullptr; }
+  unsigned char *data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  void swap(MappedFile &other) noexcept;
+
+  unsigned char *m_data = nullptr;
+  size_t m_size = 0;
+#if defined(_WIN32)
+  void *m_file = nullptr;
+  void *m_mapping = nullptr;
+#endif
+};
+
+} // namespace moiras
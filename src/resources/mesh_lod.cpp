@@ -0,0 +1,421 @@
+#include "mesh_lod.h"
+#include <raymath.h>
+#include <rlgl.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace moiras {
+
+// Frazione della meta' altezza vista sotto cui si passa al LOD successivo
+static const float LOD_SCREEN_SIZE[MAX_MESH_LODS - 1] = {0.2f, 0.08f, 0.03f};
+// Un LOD che non toglie almeno il 10% dei triangoli non vale la memoria
+static const float LOD_MIN_REDUCTION = 0.9f;
+// Peso dei piani di vincolo dei bordi aperti rispetto a quelli delle facce
+static const double BOUNDARY_WEIGHT = 10.0;
+
+namespace {
+
+// Quadrica simmetrica 4x4 (10 coefficienti), errore = v^T Q v
+struct Quadric {
+  double q[10] = {}; // aa ab ac ad bb bc bd cc cd dd
+
+  void addPlane(double a, double b, double c, double d, double w) {
+    q[0] += w * a * a; q[1] += w * a * b; q[2] += w * a * c; q[3] += w * a * d;
+    q[4] += w * b * b; q[5] += w * b * c; q[6] += w * b * d;
+    q[7] += w * c * c; q[8] += w * c * d;
+    q[9] += w * d * d;
+  }
+
+  void add(const Quadric &other) {
+    for (int i = 0; i < 10; i++)
+      q[i] += other.q[i];
+  }
+
+  double error(const Vector3 &v) const {
+    double x = v.x, y = v.y, z = v.z;
+    return q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z +
+           2.0 * q[3] * x + q[4] * y * y + 2.0 * q[5] * y * z +
+           2.0 * q[6] * y + q[7] * z * z + 2.0 * q[8] * z + q[9];
+  }
+};
+
+// Chiave di saldatura: posizione, normale, texcoord
+struct WeldKey {
+  float v[8];
+  bool operator==(const WeldKey &other) const {
+    return memcmp(v, other.v, sizeof(v)) == 0;
+  }
+};
+
+struct WeldKeyHash {
+  size_t operator()(const WeldKey &key) const {
+    uint32_t bits[8];
+    memcpy(bits, key.v, sizeof(bits));
+    uint64_t h = 1469598103934665603ull; // FNV-1a
+    for (uint32_t b : bits) {
+      h ^= b;
+      h *= 1099511628211ull;
+    }
+    return (size_t)h;
+  }
+};
+
+// Collasso di from su to; gli stamp invalidano le voci superate nel heap
+struct Collapse {
+  double cost;
+  int from, to;
+  uint32_t fromStamp, toStamp;
+  bool operator>(const Collapse &other) const { return cost > other.cost; }
+};
+
+} // namespace
+
+static void freeMeshData(Mesh &mesh) {
+  // Solo memoria CPU: la mesh non e' mai stata caricata e questa funzione
+  // puo' girare su un worker senza contesto GL
+  RL_FREE(mesh.vertices);
+  RL_FREE(mesh.normals);
+  RL_FREE(mesh.texcoords);
+  RL_FREE(mesh.indices);
+  mesh = {0};
+}
+
+Mesh simplifyMesh(const Mesh &source, float targetRatio) {
+  Mesh result = {0};
+  if (!source.vertices || source.vertexCount < 3)
+    return result;
+
+  const bool hasNormals = source.normals != nullptr;
+  const bool hasTexcoords = source.texcoords != nullptr;
+  const int cornerCount = source.indices
+                              ? source.triangleCount * 3
+                              : source.vertexCount - source.vertexCount % 3;
+
+  // Saldatura dei vertici identici (le mesh generate da raylib non sono
+  // indicizzate)
+  std::unordered_map<WeldKey, int, WeldKeyHash> weld;
+  weld.reserve(cornerCount);
+  std::vector<int> sourceIndex; // vertice saldato -> vertice sorgente
+  std::vector<int> tris(cornerCount);
+  for (int c = 0; c < cornerCount; c++) {
+    int s = source.indices ? source.indices[c] : c;
+    WeldKey key = {};
+    memcpy(key.v, &source.vertices[s * 3], 3 * sizeof(float));
+    if (hasNormals)
+      memcpy(key.v + 3, &source.normals[s * 3], 3 * sizeof(float));
+    if (hasTexcoords)
+      memcpy(key.v + 6, &source.texcoords[s * 2], 2 * sizeof(float));
+    auto it = weld.find(key);
+    if (it == weld.end()) {
+      it = weld.emplace(key, (int)sourceIndex.size()).first;
+      sourceIndex.push_back(s);
+    }
+    tris[c] = it->second;
+  }
+
+  const int n = (int)sourceIndex.size();
+  std::vector<Vector3> pos(n);
+  for (int i = 0; i < n; i++) {
+    const float *p = &source.vertices[sourceIndex[i] * 3];
+    pos[i] = {p[0], p[1], p[2]};
+  }
+
+  // Vertici di cucitura: piu' vertici saldati nella stessa posizione
+  std::vector<uint8_t> locked(n, 0);
+  {
+    std::unordered_map<WeldKey, int, WeldKeyHash> shared;
+    shared.reserve(n);
+    std::vector<WeldKey> keys(n);
+    for (int i = 0; i < n; i++) {
+      keys[i] = {};
+      memcpy(keys[i].v, &pos[i], 3 * sizeof(float));
+      shared[keys[i]]++;
+    }
+    for (int i = 0; i < n; i++)
+      locked[i] = shared[keys[i]] > 1;
+  }
+
+  // Quadriche delle facce, pesate per area
+  const int triCount = cornerCount / 3;
+  std::vector<uint8_t> triAlive(triCount, 0);
+  std::vector<Vector3> triNormal(triCount);
+  std::vector<Quadric> quadrics(n);
+  std::vector<std::vector<int>> vertTris(n);
+  std::unordered_map<uint64_t, int> edgeUse;
+  int liveTris = 0;
+  auto edgeKey = [](int a, int b) {
+    return ((uint64_t)(uint32_t)std::min(a, b) << 32) | (uint32_t)std::max(a, b);
+  };
+
+  for (int t = 0; t < triCount; t++) {
+    const int *v = &tris[t * 3];
+    if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2])
+      continue;
+    Vector3 normal = Vector3CrossProduct(Vector3Subtract(pos[v[1]], pos[v[0]]),
+                                         Vector3Subtract(pos[v[2]], pos[v[0]]));
+    float len = Vector3Length(normal);
+    if (len <= 0.0f)
+      continue;
+    normal = Vector3Scale(normal, 1.0f / len);
+    double d = -Vector3DotProduct(normal, pos[v[0]]);
+    for (int k = 0; k < 3; k++) {
+      quadrics[v[k]].addPlane(normal.x, normal.y, normal.z, d, 0.5 * len);
+      vertTris[v[k]].push_back(t);
+      edgeUse[edgeKey(v[k], v[(k + 1) % 3])]++;
+    }
+    triAlive[t] = 1;
+    triNormal[t] = normal;
+    liveTris++;
+  }
+
+  // Bordi aperti: piano che contiene il lato, ortogonale alla faccia
+  for (int t = 0; t < triCount; t++) {
+    if (!triAlive[t])
+      continue;
+    const int *v = &tris[t * 3];
+    for (int k = 0; k < 3; k++) {
+      int a = v[k], b = v[(k + 1) % 3];
+      if (edgeUse[edgeKey(a, b)] != 1)
+        continue;
+      Vector3 edge = Vector3Subtract(pos[b], pos[a]);
+      Vector3 normal = Vector3Normalize(Vector3CrossProduct(edge, triNormal[t]));
+      double d = -Vector3DotProduct(normal, pos[a]);
+      double w = BOUNDARY_WEIGHT * Vector3DotProduct(edge, edge);
+      quadrics[a].addPlane(normal.x, normal.y, normal.z, d, w);
+      quadrics[b].addPlane(normal.x, normal.y, normal.z, d, w);
+    }
+  }
+
+  std::vector<uint32_t> stamp(n, 0);
+  std::vector<uint8_t> vertAlive(n, 1);
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+  auto pushEdge = [&](int a, int b) {
+    if (locked[a] && locked[b])
+      return;
+    Quadric q = quadrics[a];
+    q.add(quadrics[b]);
+    double costAB = locked[a] ? DBL_MAX : q.error(pos[b]);
+    double costBA = locked[b] ? DBL_MAX : q.error(pos[a]);
+    if (costAB <= costBA)
+      heap.push({costAB, a, b, stamp[a], stamp[b]});
+    else
+      heap.push({costBA, b, a, stamp[b], stamp[a]});
+  };
+  for (const auto &edge : edgeUse)
+    pushEdge((int)(edge.first >> 32), (int)(edge.first & 0xFFFFFFFFu));
+
+  std::vector<int> fromNeighbors, toNeighbors, common;
+  auto collectNeighbors = [&](int v, std::vector<int> &out) {
+    out.clear();
+    for (int t : vertTris[v]) {
+      if (!triAlive[t])
+        continue;
+      for (int k = 0; k < 3; k++) {
+        if (tris[t * 3 + k] != v)
+          out.push_back(tris[t * 3 + k]);
+      }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+  };
+  auto triContains = [&](int t, int v) {
+    return tris[t * 3] == v || tris[t * 3 + 1] == v || tris[t * 3 + 2] == v;
+  };
+
+  const int target = std::max(1, (int)(liveTris * targetRatio));
+  while (liveTris > target && !heap.empty()) {
+    Collapse c = heap.top();
+    heap.pop();
+    if (!vertAlive[c.from] || !vertAlive[c.to] ||
+        stamp[c.from] != c.fromStamp || stamp[c.to] != c.toStamp)
+      continue;
+
+    // Link condition: i vicini comuni sono solo gli opposti del lato,
+    // altrimenti il collasso crea geometria non-manifold
+    collectNeighbors(c.from, fromNeighbors);
+    collectNeighbors(c.to, toNeighbors);
+    int edgeTris = 0;
+    for (int t : vertTris[c.from]) {
+      if (triAlive[t] && triContains(t, c.to))
+        edgeTris++;
+    }
+    common.clear();
+    std::set_intersection(fromNeighbors.begin(), fromNeighbors.end(),
+                          toNeighbors.begin(), toNeighbors.end(),
+                          std::back_inserter(common));
+    if (edgeTris == 0 || (int)common.size() != edgeTris)
+      continue;
+
+    // Le facce che restano non devono ribaltarsi ne' degenerare
+    bool flips = false;
+    for (int t : vertTris[c.from]) {
+      if (!triAlive[t] || triContains(t, c.to))
+        continue;
+      const int *v = &tris[t * 3];
+      Vector3 p[3];
+      for (int k = 0; k < 3; k++)
+        p[k] = v[k] == c.from ? pos[c.to] : pos[v[k]];
+      Vector3 before = Vector3CrossProduct(Vector3Subtract(pos[v[1]], pos[v[0]]),
+                                           Vector3Subtract(pos[v[2]], pos[v[0]]));
+      Vector3 after = Vector3CrossProduct(Vector3Subtract(p[1], p[0]),
+                                          Vector3Subtract(p[2], p[0]));
+      if (Vector3DotProduct(before, after) <= 0.0f) {
+        flips = true;
+        break;
+      }
+    }
+    if (flips)
+      continue;
+
+    quadrics[c.to].add(quadrics[c.from]);
+    vertAlive[c.from] = 0;
+    for (int t : vertTris[c.from]) {
+      if (!triAlive[t])
+        continue;
+      if (triContains(t, c.to)) {
+        triAlive[t] = 0;
+        liveTris--;
+        continue;
+      }
+      for (int k = 0; k < 3; k++) {
+        if (tris[t * 3 + k] == c.from)
+          tris[t * 3 + k] = c.to;
+      }
+      vertTris[c.to].push_back(t);
+    }
+    vertTris[c.from].clear();
+    auto &toTris = vertTris[c.to];
+    toTris.erase(std::remove_if(toTris.begin(), toTris.end(),
+                                [&](int t) { return !triAlive[t]; }),
+                 toTris.end());
+
+    stamp[c.to]++;
+    collectNeighbors(c.to, toNeighbors);
+    for (int u : toNeighbors)
+      pushEdge(c.to, u);
+  }
+
+  // Compattazione dei vertici usati
+  std::vector<int> remap(n, -1);
+  std::vector<int> outVertices;
+  std::vector<unsigned short> outIndices;
+  outIndices.reserve(liveTris * 3);
+  for (int t = 0; t < triCount; t++) {
+    if (!triAlive[t])
+      continue;
+    for (int k = 0; k < 3; k++) {
+      int v = tris[t * 3 + k];
+      if (remap[v] < 0) {
+        remap[v] = (int)outVertices.size();
+        outVertices.push_back(v);
+      }
+      outIndices.push_back((unsigned short)std::min(remap[v], 0xFFFF));
+    }
+  }
+  // Gli indici di raylib sono a 16 bit
+  if (outIndices.empty() || outVertices.size() > 65535)
+    return result;
+
+  result.vertexCount = (int)outVertices.size();
+  result.triangleCount = (int)(outIndices.size() / 3);
+  result.vertices = (float *)RL_MALLOC(result.vertexCount * 3 * sizeof(float));
+  if (hasNormals)
+    result.normals = (float *)RL_MALLOC(result.vertexCount * 3 * sizeof(float));
+  if (hasTexcoords)
+    result.texcoords = (float *)RL_MALLOC(result.vertexCount * 2 * sizeof(float));
+  for (int i = 0; i < result.vertexCount; i++) {
+    int s = sourceIndex[outVertices[i]];
+    memcpy(&result.vertices[i * 3], &source.vertices[s * 3], 3 * sizeof(float));
+    if (hasNormals)
+      memcpy(&result.normals[i * 3], &source.normals[s * 3], 3 * sizeof(float));
+    if (hasTexcoords)
+      memcpy(&result.texcoords[i * 2], &source.texcoords[s * 2], 2 * sizeof(float));
+  }
+  result.indices = (unsigned short *)RL_MALLOC(outIndices.size() * sizeof(unsigned short));
+  memcpy(result.indices, outIndices.data(), outIndices.size() * sizeof(unsigned short));
+  return result;
+}
+
+MeshLodChain generateMeshLods(const Mesh &source, int maxLods) {
+  MeshLodChain chain;
+  chain.lods[0] = source;
+  chain.count = 1;
+  // Lo skinning usa buffer per vertice che i LOD non hanno
+  if (!source.vertices || source.boneIds || source.animVertices)
+    return chain;
+
+  maxLods = std::min(maxLods, MAX_MESH_LODS);
+  for (int i = 1; i < maxLods; i++) {
+    const Mesh &previous = chain.lods[i - 1];
+    Mesh lod = simplifyMesh(previous, 0.5f);
+    if (lod.vertexCount == 0 ||
+        lod.triangleCount > previous.triangleCount * LOD_MIN_REDUCTION) {
+      freeMeshData(lod);
+      break;
+    }
+    chain.lods[chain.count++] = lod;
+  }
+  return chain;
+}
+
+void uploadMeshLods(MeshLodChain &chain) {
+  for (int i = 1; i < chain.count; i++) {
+    if (chain.lods[i].vaoId == 0)
+      UploadMesh(&chain.lods[i], false);
+  }
+}
+
+void unloadMeshLods(MeshLodChain &chain) {
+  for (int i = 1; i < chain.count; i++) {
+    if (chain.lods[i].vaoId != 0)
+      UnloadMesh(chain.lods[i]);
+    else
+      freeMeshData(chain.lods[i]);
+  }
+  chain = MeshLodChain();
+}
+
+LodView LodView::fromCurrentMatrices() {
+  Matrix view = rlGetMatrixModelview();
+  Matrix projection = rlGetMatrixProjection();
+
+  // Posizione della camera: -R^T * t della matrice vista
+  LodView result;
+  result.eye = {-(view.m0 * view.m12 + view.m1 * view.m13 + view.m2 * view.m14),
+                -(view.m4 * view.m12 + view.m5 * view.m13 + view.m6 * view.m14),
+                -(view.m8 * view.m12 + view.m9 * view.m13 + view.m10 * view.m14)};
+  result.projScale = projection.m5;
+  result.perspective = projection.m11 != 0.0f;
+  return result;
+}
+
+float LodView::screenSize(float distance, float radius) const {
+  if (!perspective)
+    return radius * projScale;
+  // Camera dentro la sfera: dettaglio pieno
+  if (distance <= radius)
+    return FLT_MAX;
+  return radius * projScale / distance;
+}
+
+float LodView::screenSize(Vector3 center, float radius) const {
+  return screenSize(Vector3Distance(eye, center), radius);
+}
+
+int selectMeshLod(float screenSize, int lodCount) {
+  int lod = 0;
+  while (lod < lodCount - 1 && lod < MAX_MESH_LODS - 1 &&
+         screenSize < LOD_SCREEN_SIZE[lod])
+    lod++;
+  return lod;
+}
+
+} // namespace moiras
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <raylib.h>
+
+namespace moiras {
+
+constexpr int MAX_MESH_LODS = 4;
+
+// Catena di LOD di una mesh: lods[0] e' la mesh sorgente (non posseduta),
+// lods[1..count-1] sono versioni semplificate possedute dalla catena
+// (liberate da unloadMeshLods).
+struct MeshLodChain {
+  Mesh lods[MAX_MESH_LODS] = {};
+  int count = 0;
+};
+
+// Semplificazione quadric edge-collapse (Garland-Heckbert) con collasso su
+// uno dei due estremi: i vertici superstiti conservano posizione, normale e
+// texcoord. I bordi aperti sono vincolati da piani ortogonali, le cuciture
+// (stessa posizione con normale o UV diverse) restano ferme per non aprire
+// crepe. Ritorna una mesh indicizzata solo su CPU, oppure una mesh vuota
+// (vertexCount 0) se non e' possibile ridurla sotto i 65535 vertici.
+Mesh simplifyMesh(const Mesh &source, float targetRatio);
+
+// Solo CPU (sicura fuori dal main thread): lods[0] = source, poi ogni LOD
+// dimezza i triangoli del precedente finche' la riduzione e' utile. Le mesh
+// skinnate restano con il solo LOD 0.
+MeshLodChain generateMeshLods(const Mesh &source, int maxLods = MAX_MESH_LODS);
+// Carica sulla GPU i LOD generati (main thread)
+void uploadMeshLods(MeshLodChain &chain);
+void unloadMeshLods(MeshLodChain &chain);
+
+// Dimensione a schermo di una sfera: raggio proiettato come frazione della
+// meta' altezza della vista
+struct LodView {
+  Vector3 eye;
+  float projScale;  // m5 della proiezione: 1 / tan(fovy / 2) in prospettiva
+  bool perspective;
+
+  // Camera attiva in rlgl (dentro BeginMode3D)
+  static LodView fromCurrentMatrices();
+
+  float screenSize(float distance, float radius) const;
+  float screenSize(Vector3 center, float radius) const;
+};
+
+// Sotto ogni soglia di screenSize si passa al LOD successivo
+int selectMeshLod(float screenSize, int lodCount);
+
+} // namespace moiras
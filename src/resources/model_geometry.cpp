@@ -0,0 +1,136 @@
+#include "model_geometry.h"
+#include <raymath.h>
+#include <vector>
+
+// Solo dichiarazioni: l'implementazione di cgltf e' gia' compilata in raylib
+// (rmodels.c), ridefinirla qui duplicherebbe i simboli
+#include "external/cgltf.h"
+
+namespace moiras {
+
+static void appendPrimitive(const cgltf_primitive &primitive,
+                            const Matrix &transform,
+                            std::vector<Mesh> &meshes) {
+  if (primitive.type != cgltf_primitive_type_triangles)
+    return;
+
+  const cgltf_accessor *positions = nullptr;
+  for (cgltf_size a = 0; a < primitive.attributes_count; a++) {
+    if (primitive.attributes[a].type == cgltf_attribute_type_position) {
+      positions = primitive.attributes[a].data;
+      break;
+    }
+  }
+  if (!positions || positions->count == 0)
+    return;
+
+  std::vector<Vector3> vertices(positions->count);
+  for (cgltf_size v = 0; v < positions->count; v++) {
+    float p[3] = {0.0f, 0.0f, 0.0f};
+    cgltf_accessor_read_float(positions, v, p, 3);
+    vertices[v] = Vector3Transform({p[0], p[1], p[2]}, transform);
+  }
+
+  std::vector<unsigned int> indices;
+  if (primitive.indices) {
+    indices.resize(primitive.indices->count);
+    for (cgltf_size i = 0; i < primitive.indices->count; i++) {
+      indices[i] = (unsigned int)cgltf_accessor_read_index(primitive.indices, i);
+    }
+  } else {
+    indices.resize(vertices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+      indices[i] = (unsigned int)i;
+    }
+  }
+  indices.resize(indices.size() - indices.size() % 3);
+  if (indices.empty())
+    return;
+
+  Mesh mesh = {0};
+  mesh.triangleCount = (int)(indices.size() / 3);
+  if (vertices.size() <= 65535) {
+    // Gli indici di raylib sono a 16 bit
+    mesh.vertexCount = (int)vertices.size();
+    mesh.vertices = (float *)RL_CALLOC(vertices.size() * 3, sizeof(float));
+    for (size_t v = 0; v < vertices.size(); v++) {
+      mesh.vertices[v * 3 + 0] = vertices[v].x;
+      mesh.vertices[v * 3 + 1] = vertices[v].y;
+      mesh.vertices[v * 3 + 2] = vertices[v].z;
+    }
+    mesh.indices = (unsigned short *)RL_CALLOC(indices.size(), sizeof(unsigned short));
+    for (size_t i = 0; i < indices.size(); i++) {
+      mesh.indices[i] = (unsigned short)indices[i];
+    }
+  } else {
+    // Troppi vertici per indici a 16 bit: mesh non indicizzata
+    mesh.vertexCount = (int)indices.size();
+    mesh.vertices = (float *)RL_CALLOC(indices.size() * 3, sizeof(float));
+    for (size_t i = 0; i < indices.size(); i++) {
+      const Vector3 &p = vertices[indices[i]];
+      mesh.vertices[i * 3 + 0] = p.x;
+      mesh.vertices[i * 3 + 1] = p.y;
+      mesh.vertices[i * 3 + 2] = p.z;
+    }
+  }
+  meshes.push_back(mesh);
+}
+
+Model loadModelGeometry(const std::string &path) {
+  Model model = {0};
+  model.transform = MatrixIdentity();
+
+  cgltf_options options = {};
+  cgltf_data *data = nullptr;
+  if (cgltf_parse_file(&options, path.c_str(), &data) != cgltf_result_success) {
+    TraceLog(LOG_ERROR, "ModelGeometry: Failed to parse %s", path.c_str());
+    return model;
+  }
+  if (cgltf_load_buffers(&options, data, path.c_str()) != cgltf_result_success) {
+    TraceLog(LOG_ERROR, "ModelGeometry: Failed to load buffers of %s",
+             path.c_str());
+    cgltf_free(data);
+    return model;
+  }
+
+  std::vector<Mesh> meshes;
+  for (cgltf_size n = 0; n < data->nodes_count; n++) {
+    const cgltf_node &node = data->nodes[n];
+    if (!node.mesh)
+      continue;
+
+    // cgltf restituisce la matrice column-major come raylib
+    float w[16];
+    cgltf_node_transform_world(&node, w);
+    Matrix transform = {w[0], w[4], w[8],  w[12], w[1], w[5], w[9],  w[13],
+                        w[2], w[6], w[10], w[14], w[3], w[7], w[11], w[15]};
+
+    for (cgltf_size p = 0; p < node.mesh->primitives_count; p++) {
+      appendPrimitive(node.mesh->primitives[p], transform, meshes);
+    }
+  }
+  cgltf_free(data);
+
+  if (meshes.empty()) {
+    TraceLog(LOG_WARNING, "ModelGeometry: No triangle meshes in %s",
+             path.c_str());
+    return model;
+  }
+
+  model.meshCount = (int)meshes.size();
+  model.meshes = (Mesh *)RL_CALLOC(meshes.size(), sizeof(Mesh));
+  for (size_t m = 0; m < meshes.size(); m++) {
+    model.meshes[m] = meshes[m];
+  }
+  // Materiale di default senza shader ne' texture reali (nessuna chiamata GL)
+  model.materialCount = 1;
+  model.materials = (Material *)RL_CALLOC(1, sizeof(Material));
+  model.materials[0] = LoadMaterialDefault();
+  model.meshMaterial = (int *)RL_CALLOC(meshes.size(), sizeof(int));
+
+  TraceLog(LOG_INFO, "ModelGeometry: Loaded %d meshes from %s (CPU only)",
+           model.meshCount, path.c_str());
+  return model;
+}
+
+} // namespace moiras
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <raylib.h>
+#include <string>
+
+namespace moiras {
+
+// Carica solo la geometria (posizioni + indici) di un file glTF/GLB in un
+// Model raylib senza caricare nulla sulla GPU: niente VAO/VBO, niente
+// texture, un unico materiale di default. Serve alla modalita' headless,
+// dove non esiste un contesto OpenGL, per costruire navmesh, BVH e
+// heightfield. Le trasformazioni dei nodi sono applicate ai vertici come fa
+// LoadModel. Il Model si libera normalmente con UnloadModel.
+Model loadModelGeometry(const std::string &path);
+
+} // namespace moiras
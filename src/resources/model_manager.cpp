@@ -1,6 +1,9 @@
 #include "model_manager.h"
+#include "../jobs/job_system.h"
+#include "../profiler/profiler.h"
 #include "imgui.h"
 #include <raylib.h>
+#include <raymath.h>
 #include <cstring>
 
 namespace moiras {
@@ -19,13 +22,14 @@ ModelInstance::ModelInstance()
 ModelInstance::ModelInstance(ModelManager* manager, const std::string& path,
                              Mesh* meshes, int meshCount,
                              int* meshMaterial, Material* sourceMaterials, int materialCount,
-                             BoneInfo* bones, int boneCount, Transform* bindPose)
+                             BoneInfo* bones, int boneCount, Transform* bindPose,
+                             const MeshLodChain* lods)
     : m_manager(manager), m_path(path),
       m_sharedMeshes(meshes), m_meshCount(meshCount), m_meshMaterial(meshMaterial),
       m_localMeshes(nullptr),
       m_bones(bones), m_boneCount(boneCount), m_bindPose(bindPose),
       m_currentPose(nullptr),
-      m_materials(nullptr), m_materialCount(materialCount) {
+      m_materials(nullptr), m_materialCount(materialCount), m_lods(lods) {
 
     // Clone materials array for per-instance shader support
     if (materialCount > 0 && sourceMaterials != nullptr) {
@@ -56,7 +60,8 @@ ModelInstance::ModelInstance(ModelInstance&& other) noexcept
       m_bones(other.m_bones), m_boneCount(other.m_boneCount),
       m_bindPose(other.m_bindPose), m_currentPose(other.m_currentPose),
       m_materials(other.m_materials), m_materialCount(other.m_materialCount),
-      m_animData(std::move(other.m_animData)) {
+      m_animData(std::move(other.m_animData)), m_lods(other.m_lods),
+      m_bounds(other.m_bounds), m_boundsValid(other.m_boundsValid) {
 
     // Clear other to prevent double-release
     other.m_manager = nullptr;
@@ -70,6 +75,8 @@ ModelInstance::ModelInstance(ModelInstance&& other) noexcept
     other.m_currentPose = nullptr;
     other.m_materials = nullptr;
     other.m_materialCount = 0;
+    other.m_lods = nullptr;
+    other.m_boundsValid = false;
 }
 
 ModelInstance& ModelInstance::operator=(ModelInstance&& other) noexcept {
@@ -89,6 +96,9 @@ ModelInstance& ModelInstance::operator=(ModelInstance&& other) noexcept {
         m_materials = other.m_materials;
         m_materialCount = other.m_materialCount;
         m_animData = std::move(other.m_animData);
+        m_lods = other.m_lods;
+        m_bounds = other.m_bounds;
+        m_boundsValid = other.m_boundsValid;
 
         other.m_manager = nullptr;
         other.m_sharedMeshes = nullptr;
@@ -101,6 +111,8 @@ ModelInstance& ModelInstance::operator=(ModelInstance&& other) noexcept {
         other.m_currentPose = nullptr;
         other.m_materials = nullptr;
         other.m_materialCount = 0;
+        other.m_lods = nullptr;
+        other.m_boundsValid = false;
     }
     return *this;
 }
@@ -156,6 +168,8 @@ void ModelInstance::release() {
     m_bones = nullptr;
     m_boneCount = 0;
     m_bindPose = nullptr;
+    m_lods = nullptr;
+    m_boundsValid = false;
     m_path.clear();
 }
 
@@ -232,6 +246,8 @@ void ModelInstance::applyShader(Shader shader) {
 }
 
 BoundingBox ModelInstance::getBoundingBox() const {
+    if (m_boundsValid) return m_bounds;
+
     BoundingBox bounds = {0};
 
     if (m_sharedMeshes != nullptr && m_meshCount > 0) {
@@ -248,11 +264,37 @@ BoundingBox ModelInstance::getBoundingBox() const {
             if (meshBounds.max.y > bounds.max.y) bounds.max.y = meshBounds.max.y;
             if (meshBounds.max.z > bounds.max.z) bounds.max.z = meshBounds.max.z;
         }
+        m_bounds = bounds;
+        m_boundsValid = true;
     }
 
     return bounds;
 }
 
+float ModelInstance::getBoundingRadius() const {
+    BoundingBox bounds = getBoundingBox();
+    return Vector3Length(Vector3Subtract(bounds.max, bounds.min)) * 0.5f;
+}
+
+int ModelInstance::lodCount() const {
+    if (m_lods == nullptr) return 1;
+    int count = 1;
+    for (int i = 0; i < m_meshCount; i++) {
+        if (m_lods[i].count > count) count = m_lods[i].count;
+    }
+    return count;
+}
+
+const Mesh& ModelInstance::lodMesh(int meshIndex, int lod) const {
+    // Animated instances draw their local meshes, which have no LODs
+    if (m_lods == nullptr || lod <= 0 || m_localMeshes != nullptr) {
+        return meshes()[meshIndex];
+    }
+    const MeshLodChain& chain = m_lods[meshIndex];
+    if (chain.count <= 1) return meshes()[meshIndex];
+    return chain.lods[lod < chain.count ? lod : chain.count - 1];
+}
+
 // ============================================================================
 // ModelManager implementation
 // ============================================================================
@@ -263,7 +305,39 @@ ModelManager::~ModelManager() {
     unloadAll();
 }
 
-ModelInstance ModelManager::acquire(const std::string& path) {
+void ModelManager::buildLods(CachedModel& cached) {
+    PROFILE_SCOPE("ModelManager::buildLods");
+    const Model& model = cached.model;
+    // Skinned models: LODs carry no bone weights or animation buffers
+    if (model.boneCount > 0 || model.meshCount == 0) return;
+
+    // Simplify on the worker threads, upload on the main thread
+    cached.lods.resize(model.meshCount);
+    JobSystem::getInstance().parallel_for(model.meshCount, 1, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            cached.lods[i] = generateMeshLods(model.meshes[i]);
+        }
+    });
+
+    int generated = 0;
+    for (auto& chain : cached.lods) {
+        uploadMeshLods(chain);
+        generated += chain.count - 1;
+    }
+    TraceLog(LOG_INFO, "ModelManager: Generated %d LOD meshes for %d meshes",
+             generated, model.meshCount);
+}
+
+void ModelManager::unloadCached(CachedModel& cached) {
+    for (auto& chain : cached.lods) {
+        unloadMeshLods(chain);
+    }
+    cached.lods.clear();
+    UnloadModel(cached.model);
+}
+
+ModelInstance ModelManager::acquire(const std::string& path, bool withLods) {
+    PROFILE_SCOPE("ModelManager::acquire");
     auto it = m_cache.find(path);
 
     if (it == m_cache.end()) {
@@ -287,15 +361,20 @@ ModelInstance ModelManager::acquire(const std::string& path) {
     }
 
     CachedModel& cached = it->second;
+    if (withLods && cached.lods.empty()) {
+        buildLods(cached);
+    }
     return ModelInstance(this, path,
                          cached.model.meshes, cached.model.meshCount,
                          cached.model.meshMaterial,
                          cached.model.materials, cached.model.materialCount,
                          cached.model.bones, cached.model.boneCount,
-                         cached.model.bindPose);
+                         cached.model.bindPose,
+                         cached.lods.empty() ? nullptr : cached.lods.data());
 }
 
 void ModelManager::preload(const std::string& path) {
+    PROFILE_SCOPE("ModelManager::preload");
     if (m_cache.find(path) != m_cache.end()) {
         return; // Already cached
     }
@@ -312,6 +391,7 @@ void ModelManager::preload(const std::string& path) {
 }
 
 void ModelManager::release(const std::string& path) {
+    PROFILE_SCOPE("ModelManager::release");
     auto it = m_cache.find(path);
 
     if (it == m_cache.end()) {
@@ -325,7 +405,7 @@ void ModelManager::release(const std::string& path) {
 
     if (it->second.refCount <= 0) {
         TraceLog(LOG_INFO, "ModelManager: Unloading unused model '%s'", path.c_str());
-        UnloadModel(it->second.model);
+        unloadCached(it->second);
         m_cache.erase(it);
     }
 }
@@ -341,11 +421,19 @@ int ModelManager::getRefCount(const std::string& path) const {
 void ModelManager::unloadAll() {
     for (auto& pair : m_cache) {
         TraceLog(LOG_INFO, "ModelManager: Unloading model '%s'", pair.first.c_str());
-        UnloadModel(pair.second.model);
+        unloadCached(pair.second);
     }
     m_cache.clear();
 }
 
+static int lodMeshCount(const std::vector<MeshLodChain>& lods) {
+    int count = 0;
+    for (const auto& chain : lods) {
+        count += chain.count > 1 ? chain.count - 1 : 0;
+    }
+    return count;
+}
+
 void ModelManager::gui() {
     if (ImGui::CollapsingHeader("Model Manager")) {
         ImGui::Text("Cached Models: %d", static_cast<int>(m_cache.size()));
@@ -354,9 +442,10 @@ void ModelManager::gui() {
         for (const auto& pair : m_cache) {
             ImGui::Text("%s", pair.first.c_str());
             ImGui::SameLine();
-            ImGui::TextDisabled("(refs: %d, meshes: %d)",
+            ImGui::TextDisabled("(refs: %d, meshes: %d, LOD meshes: %d)",
                                 pair.second.refCount,
-                                pair.second.model.meshCount);
+                                pair.second.model.meshCount,
+                                lodMeshCount(pair.second.lods));
         }
     }
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "mesh_lod.h"
 #include <raylib.h>
 #include <string>
 #include <unordered_map>
@@ -61,8 +62,15 @@ public:
   // Apply shader to all materials (per-instance)
   void applyShader(Shader shader);
 
-  // Get bounding box (calculated from meshes)
+  // Get bounding box (calculated from meshes on first call, then cached)
   BoundingBox getBoundingBox() const;
+  // Radius of the sphere enclosing the bounding box
+  float getBoundingRadius() const;
+
+  // Mesh LODs (only for models acquired with LODs): lod 0 is meshes()[i],
+  // higher levels are clamped to the LODs available for that mesh
+  int lodCount() const;
+  const Mesh &lodMesh(int meshIndex, int lod) const;
 
   // Get the model path
   const std::string &getPath() const { return m_path; }
@@ -88,7 +96,7 @@ private:
   ModelInstance(ModelManager *manager, const std::string &path, Mesh *meshes,
                 int meshCount, int *meshMaterial, Material *sourceMaterials,
                 int materialCount, BoneInfo *bones, int boneCount,
-                Transform *bindPose);
+                Transform *bindPose, const MeshLodChain *lods);
 
   void release();
   void releaseAnimationData();
@@ -105,13 +113,17 @@ private:
   Material *m_materials = nullptr;
   int m_materialCount = 0;
   std::vector<MeshAnimationData> m_animData;
+  const MeshLodChain *m_lods = nullptr; // one chain per mesh, owned by the manager
+  mutable BoundingBox m_bounds = {};
+  mutable bool m_boundsValid = false;
 };
 
 class ModelManager {
 public:
   ModelManager();
   ~ModelManager();
-  ModelInstance acquire(const std::string &path);
+  // withLods: generate (once per model) simplified LODs of static meshes
+  ModelInstance acquire(const std::string &path, bool withLods = false);
   void preload(const std::string &path);
   int getCachedModelCount() const { return static_cast<int>(m_cache.size()); }
   int getRefCount(const std::string &path) const;
@@ -124,7 +136,10 @@ private:
   struct CachedModel {
     Model model;
     int refCount;
+    std::vector<MeshLodChain> lods; // empty until requested
   };
+  void buildLods(CachedModel &cached);
+  static void unloadCached(CachedModel &cached);
   std::unordered_map<std::string, CachedModel> m_cache;
 };
 
@@ -1,6 +1,7 @@
 #include "ScriptComponent.hpp"
 #include "ScriptEngine.hpp"
 #include "../game/game_object.h"
+#include "../profiler/profiler.h"
 #include <raylib.h>
 
 namespace moiras
@@ -78,6 +79,7 @@ namespace moiras
 
   void ScriptComponent::onUpdate(float dt)
   {
+    PROFILE_SCOPE("ScriptComponent::onUpdate");
     if (!m_loaded || m_hasError)
       return;
 
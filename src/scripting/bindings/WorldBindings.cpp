@@ -1,6 +1,7 @@
 #include "WorldBindings.hpp"
 #include "../ScriptEngine.hpp"
 #include "../../game/game_object.h"
+#include "../../navigation/path_service.h"
 #include "../../time/time_manager.h"
 #include <algorithm>
 #include <raylib.h>
@@ -113,6 +114,37 @@ namespace moiras
       return results;
     };
 
+    // Path asincroni (PathService): request_path ritorna un id (0 = errore),
+    // poi path_status a ogni frame finche' non e' "ready" o "failed" e
+    // take_path per la lista dei punti. Niente callback Lua: lo script puo'
+    // essere ricaricato mentre la richiesta e' in coda.
+    world["request_path"] = [](Vector3 start, Vector3 end) -> unsigned int
+    { return PathService::getInstance().request(start, end); };
+    world["path_status"] = [](unsigned int id) -> std::string
+    {
+      switch (PathService::getInstance().getStatus(id))
+      {
+      case PathStatus::Pending:
+        return "pending";
+      case PathStatus::Ready:
+        return "ready";
+      case PathStatus::Failed:
+        return "failed";
+      default:
+        return "invalid";
+      }
+    };
+    // Lista vuota se il path non e' pronto o e' fallito (la richiesta
+    // completata viene liberata in entrambi i casi)
+    world["take_path"] = [](unsigned int id) -> std::vector<Vector3>
+    {
+      std::vector<Vector3> path;
+      PathService::getInstance().takePath(id, path);
+      return path;
+    };
+    world["cancel_path"] = [](unsigned int id)
+    { PathService::getInstance().cancel(id); };
+
     // Utility functions
     // Return scaled time so Lua scripts respect pause and speed
     world["get_frame_time"] = []()
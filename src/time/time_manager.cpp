@@ -10,8 +10,12 @@ TimeManager& TimeManager::getInstance() {
 }
 
 void TimeManager::update() {
+    update(GetFrameTime());
+}
+
+void TimeManager::update(float realDeltaTime) {
     // Cache real frame time
-    m_realDeltaTime = GetFrameTime();
+    m_realDeltaTime = realDeltaTime;
     
     // Calculate game delta time (0 if paused, scaled otherwise)
     m_gameDeltaTime = m_isPaused ? 0.0f : (m_realDeltaTime * m_timeScale);
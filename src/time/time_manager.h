@@ -18,6 +18,8 @@ public:
     
     // Must be called once per frame BEFORE game logic
     void update();
+    // Same, with an explicit real delta (headless fixed-step simulation)
+    void update(float realDeltaTime);
     
     // Get delta time values
     float getGameDeltaTime() const { return m_gameDeltaTime; }